@@ -0,0 +1,431 @@
+// -*- lsst-c++ -*-
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_CPPUTILS_BENCHMARKS_BENCHMARK_H
+#define LSST_CPPUTILS_BENCHMARKS_BENCHMARK_H
+
+/* A minimal micro-benchmark harness, modelled on Google Benchmark
+ *
+ * A benchmark is a function taking a State, which it iterates over to run the code being measured:
+ *
+ *     void benchSomething(State & state) {
+ *         Fixture fixture(state.range(0));  // not timed
+ *         for (auto _ : state) {
+ *             doNotOptimize(fixture.something());
+ *         }
+ *         state.setItemsProcessed(state.iterations());
+ *     }
+ *     LSST_BENCHMARK(benchSomething)->arg(16)->arg(1024)->threads(1)->threads(4);
+ *     LSST_BENCHMARK_MAIN();
+ *
+ * Each registered combination of arguments and thread count is run for
+ * enough iterations to take at least --benchmark_min_time seconds (default
+ * 0.2), and the results are written as JSON in the format of Google
+ * Benchmark (so its comparison tools can be used) to standard output, or to
+ * the file given by --benchmark_out.  --benchmark_filter selects benchmarks
+ * whose name matches a regular expression.
+ *
+ * With more than one thread, the function is run concurrently by all threads,
+ * which start and stop timing together; code before and after the loop may
+ * use state.threadIndex() to set up and tear down shared fixtures.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace lsst {
+namespace cpputils {
+namespace benchmarks {
+
+/// Prevent the compiler from optimizing away the computation of `value`
+template <typename T>
+inline void doNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+namespace detail {
+
+// Reusable barrier for the threads running one benchmark
+class Barrier {
+public:
+    explicit Barrier(int count) : _count(count) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        int const generation = _generation;
+        if (++_waiting == _count) {
+            _waiting = 0;
+            ++_generation;
+            _condition.notify_all();
+        } else {
+            _condition.wait(lock, [this, generation] { return _generation != generation; });
+        }
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    int const _count;
+    int _waiting = 0;
+    int _generation = 0;
+};
+
+}  // namespace detail
+
+/// Control of, and results from, one thread running a benchmark
+class State final {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Iterator {
+    public:
+        // The loop variable; its destructor is user-provided so that it is not reported as unused
+        struct Value {
+            ~Value() {}
+        };
+
+        Iterator(State * state, std::int64_t remaining) : _state(state), _remaining(remaining) {}
+        Value operator*() const noexcept { return Value(); }
+        Iterator & operator++() {
+            --_remaining;
+            return *this;
+        }
+        bool operator!=(Iterator const&) {
+            if (_remaining > 0) {
+                return true;
+            }
+            _state->_stopTiming();
+            return false;
+        }
+
+    private:
+        State * _state;
+        std::int64_t _remaining;
+    };
+
+    State(std::vector<std::int64_t> const& args, std::int64_t iterations, int threads, int threadIndex,
+          detail::Barrier & barrier)
+            : _args(args), _iterations(iterations), _threads(threads), _threadIndex(threadIndex),
+              _barrier(barrier) {}
+
+    /// Start timing and iterate `iterations()` times
+    Iterator begin() {
+        _barrier.wait();
+        _start = Clock::now();
+        return Iterator(this, _iterations);
+    }
+    Iterator end() { return Iterator(this, 0); }
+
+    /// The `i`th argument of this run
+    std::int64_t range(std::size_t i = 0) const { return _args.at(i); }
+
+    /// Number of iterations of this run
+    std::int64_t iterations() const noexcept { return _iterations; }
+
+    /// Number of threads running the benchmark
+    int threads() const noexcept { return _threads; }
+
+    /// Index of this thread, in [0, threads())
+    int threadIndex() const noexcept { return _threadIndex; }
+
+    /// Set the number of items processed by this thread, to be reported as items per second
+    void setItemsProcessed(std::int64_t items) noexcept { _items = items; }
+
+    /// Report an additional value; values from all threads are averaged
+    void setCounter(std::string const& name, double value) { _counters[name] = value; }
+
+    /// Report an error: the run is reported with the message and no timings
+    void skipWithError(std::string const& message) { _error = message; }
+
+private:
+    friend class Benchmark;
+
+    void _stopTiming() {
+        _stop = Clock::now();
+        _barrier.wait();
+    }
+
+    std::vector<std::int64_t> _args;
+    std::int64_t _iterations;
+    int _threads;
+    int _threadIndex;
+    detail::Barrier & _barrier;
+    Clock::time_point _start;
+    Clock::time_point _stop;
+    std::int64_t _items = 0;
+    std::map<std::string, double> _counters;
+    std::string _error;
+};
+
+/// A registered benchmark function, and the arguments and thread counts to run it with
+class Benchmark final {
+public:
+    using Function = std::function<void(State &)>;
+
+    Benchmark(std::string name, Function function) : _name(std::move(name)), _function(std::move(function)) {}
+
+    /// Add a run with a single argument
+    Benchmark * arg(std::int64_t value) { return args({value}); }
+
+    /// Add a run with several arguments
+    Benchmark * args(std::vector<std::int64_t> values) {
+        _args.push_back(std::move(values));
+        return this;
+    }
+
+    /// Add a thread count to run each set of arguments with
+    Benchmark * threads(int count) {
+        _threads.push_back(count);
+        return this;
+    }
+
+    /// Run all combinations whose name matches `filter`, writing one JSON object per run to `os`
+    void run(std::regex const& filter, double minTime, std::ostream & os, bool & first) const {
+        std::vector<std::vector<std::int64_t>> const argList = _args.empty() ? decltype(_args){{}} : _args;
+        std::vector<int> const threadList = _threads.empty() ? std::vector<int>{1} : _threads;
+        for (auto const& args : argList) {
+            for (int threads : threadList) {
+                std::ostringstream name;
+                name << _name;
+                for (auto value : args) {
+                    name << '/' << value;
+                }
+                if (!_threads.empty()) {
+                    name << "/threads:" << threads;
+                }
+                if (!std::regex_search(name.str(), filter)) {
+                    continue;
+                }
+                _runOne(name.str(), args, threads, minTime, os, first);
+            }
+        }
+    }
+
+private:
+    struct Result {
+        std::int64_t iterations = 0;
+        double realSeconds = 0;
+        double cpuSeconds = 0;
+        std::int64_t items = 0;
+        std::map<std::string, double> counters;
+        std::string error;
+    };
+
+    Result _measure(std::vector<std::int64_t> const& args, std::int64_t iterations, int threads) const {
+        detail::Barrier barrier(threads);
+        std::vector<std::unique_ptr<State>> states;
+        for (int i = 0; i < threads; ++i) {
+            states.push_back(std::make_unique<State>(args, iterations, threads, i, barrier));
+        }
+        std::clock_t const cpuStart = std::clock();
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; ++i) {
+            workers.emplace_back([this, &states, i] { _function(*states[i]); });
+        }
+        _function(*states[0]);
+        for (auto & worker : workers) {
+            worker.join();
+        }
+        std::clock_t const cpuStop = std::clock();
+
+        Result result;
+        result.iterations = iterations;
+        auto start = states[0]->_start;
+        auto stop = states[0]->_stop;
+        for (auto const& state : states) {
+            start = std::min(start, state->_start);
+            stop = std::max(stop, state->_stop);
+            result.items += state->_items;
+            for (auto const& counter : state->_counters) {
+                result.counters[counter.first] += counter.second/threads;
+            }
+            if (!state->_error.empty()) {
+                result.error = state->_error;
+            }
+        }
+        result.realSeconds = std::chrono::duration<double>(stop - start).count();
+        result.cpuSeconds = static_cast<double>(cpuStop - cpuStart)/CLOCKS_PER_SEC;
+        return result;
+    }
+
+    void _runOne(std::string const& name, std::vector<std::int64_t> const& args, int threads, double minTime,
+                 std::ostream & os, bool & first) const {
+        constexpr std::int64_t maxIterations = 1000000000;
+        std::int64_t iterations = 1;
+        Result result;
+        while (true) {
+            result = _measure(args, iterations, threads);
+            if (!result.error.empty() || result.realSeconds >= minTime || iterations >= maxIterations) {
+                break;
+            }
+            // Aim 40% past the minimum time, growing by at least a factor of 2 and at most 10
+            double const factor = result.realSeconds > 0 ? 1.4*minTime/result.realSeconds : 10.0;
+            iterations = std::min(maxIterations,
+                                  static_cast<std::int64_t>(iterations*std::clamp(factor, 2.0, 10.0)));
+        }
+
+        os << (first ? "" : ",\n") << "    {\n"
+           << "      \"name\": \"" << name << "\",\n"
+           << "      \"run_name\": \"" << name << "\",\n"
+           << "      \"run_type\": \"iteration\",\n"
+           << "      \"threads\": " << threads << ",\n";
+        first = false;
+        if (!result.error.empty()) {
+            os << "      \"error_occurred\": true,\n"
+               << "      \"error_message\": \"" << result.error << "\"\n    }";
+            std::cerr << std::left << std::setw(48) << name << " ERROR: " << result.error << std::endl;
+            return;
+        }
+        double const realTime = 1e9*result.realSeconds/result.iterations;
+        double const cpuTime = 1e9*result.cpuSeconds/(result.iterations*threads);
+        os << "      \"iterations\": " << result.iterations << ",\n"
+           << "      \"real_time\": " << realTime << ",\n"
+           << "      \"cpu_time\": " << cpuTime << ",\n"
+           << "      \"time_unit\": \"ns\"";
+        if (result.items > 0) {
+            os << ",\n      \"items_per_second\": " << result.items/result.realSeconds;
+        }
+        for (auto const& counter : result.counters) {
+            os << ",\n      \"" << counter.first << "\": " << counter.second;
+        }
+        os << "\n    }";
+
+        std::cerr << std::left << std::setw(48) << name << std::right << std::setw(14) << std::fixed
+                  << std::setprecision(1) << realTime << " ns" << std::setw(14) << result.iterations;
+        if (result.items > 0) {
+            std::cerr << std::setw(12) << std::setprecision(3) << result.items/result.realSeconds/1e6
+                      << " M/s";
+        }
+        std::cerr << std::defaultfloat << std::endl;
+    }
+
+    std::string _name;
+    Function _function;
+    std::vector<std::vector<std::int64_t>> _args;
+    std::vector<int> _threads;
+};
+
+/// All registered benchmarks, in order of registration
+inline std::vector<std::unique_ptr<Benchmark>> & getRegistry() {
+    static std::vector<std::unique_ptr<Benchmark>> registry;
+    return registry;
+}
+
+/// Register a benchmark; returns a handle to add arguments and thread counts
+inline Benchmark * registerBenchmark(std::string const& name, Benchmark::Function function) {
+    getRegistry().push_back(std::make_unique<Benchmark>(name, std::move(function)));
+    return getRegistry().back().get();
+}
+
+/// Run the registered benchmarks according to the command-line options; return the exit status
+inline int runBenchmarks(int argc, char ** argv) {
+    std::string filter = ".";
+    double minTime = 0.2;
+    std::string outName;
+    for (int i = 1; i < argc; ++i) {
+        std::string const option = argv[i];
+        auto const value = [&option](std::string const& prefix) { return option.substr(prefix.size()); };
+        if (option.rfind("--benchmark_filter=", 0) == 0) {
+            filter = value("--benchmark_filter=");
+        } else if (option.rfind("--benchmark_min_time=", 0) == 0) {
+            minTime = std::atof(value("--benchmark_min_time=").c_str());
+        } else if (option.rfind("--benchmark_out=", 0) == 0) {
+            outName = value("--benchmark_out=");
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>]"
+                      << " [--benchmark_out=<file.json>]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::ofstream outFile;
+    if (!outName.empty()) {
+        outFile.open(outName);
+        if (!outFile) {
+            std::cerr << "Cannot write " << outName << std::endl;
+            return 1;
+        }
+    }
+    std::ostream & os = outName.empty() ? std::cout : outFile;
+
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    std::time_t const now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    os << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << date << "\",\n"
+       << "    \"host_name\": \"" << host << "\",\n"
+       << "    \"executable\": \"" << argv[0] << "\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\"\n"
+#else
+       << "    \"library_build_type\": \"debug\"\n"
+#endif
+       << "  },\n  \"benchmarks\": [\n";
+    std::regex const pattern(filter);
+    bool first = true;
+    for (auto const& benchmark : getRegistry()) {
+        benchmark->run(pattern, minTime, os, first);
+    }
+    os << "\n  ]\n}\n";
+    return 0;
+}
+
+}  // namespace benchmarks
+}  // namespace cpputils
+}  // namespace lsst
+
+#define LSST_BENCHMARK_CONCAT2(a, b) a##b
+#define LSST_BENCHMARK_CONCAT(a, b) LSST_BENCHMARK_CONCAT2(a, b)
+
+/// Register a benchmark function; arguments and thread counts may be chained, e.g. `->arg(16)`
+#define LSST_BENCHMARK(function)                                               \
+    static ::lsst::cpputils::benchmarks::Benchmark * LSST_BENCHMARK_CONCAT(    \
+            lsstBenchmark_, __LINE__) [[maybe_unused]] =                       \
+            ::lsst::cpputils::benchmarks::registerBenchmark(#function, function)
+
+/// Define a main function that runs all benchmarks registered in the program
+#define LSST_BENCHMARK_MAIN()                                                  \
+    int main(int argc, char ** argv) { return ::lsst::cpputils::benchmarks::runBenchmarks(argc, argv); }
+
+#endif  // LSST_CPPUTILS_BENCHMARKS_BENCHMARK_H
@@ -0,0 +1,125 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+
+"""Benchmarks of the overhead of pybind11 calls and of fixGamutOK, as
+seen from Python.
+
+Results are written in the JSON format of Google Benchmark, like those of
+the C++ benchmarks in this directory.
+"""
+
+import argparse
+import json
+import os
+import platform
+import re
+import sys
+import time
+import timeit
+
+from _bindingBenchmarks import cppIndex, loopCppIndex, noop
+
+
+def measure(name, stmt, setup="pass", globals=None, minTime=0.2, items=1):
+    """Time a statement for at least ``minTime`` seconds, returning a
+    benchmark result in the Google Benchmark JSON format.
+    """
+    timer = timeit.Timer(stmt, setup, globals=globals)
+    iterations, seconds = timer.autorange()
+    while seconds < minTime:
+        iterations = int(iterations*max(2.0, min(10.0, 1.4*minTime/seconds)))
+        seconds = timer.timeit(iterations)
+    realTime = 1e9*seconds/iterations
+    print(f"{name:48s}{realTime:14.1f} ns{iterations:14d}", file=sys.stderr)
+    return {
+        "name": name,
+        "run_name": name,
+        "run_type": "iteration",
+        "threads": 1,
+        "iterations": iterations,
+        "real_time": realTime,
+        "cpu_time": realTime,
+        "time_unit": "ns",
+        "items_per_second": items*iterations/seconds,
+    }
+
+
+def benchmarks(minTime):
+    """Generate the benchmark results."""
+    def pyIndex(size, i):
+        return i + size if i < 0 else i
+
+    namespace = dict(cppIndex=cppIndex, loopCppIndex=loopCppIndex, noop=noop, pyIndex=pyIndex)
+    yield measure("bindingNoop", "noop()", globals=namespace, minTime=minTime)
+    yield measure("bindingPythonIndex", "pyIndex(10, -3)", globals=namespace, minTime=minTime)
+    yield measure("bindingCppIndex", "cppIndex(10, -3)", globals=namespace, minTime=minTime)
+    yield measure("bindingCppIndexKeywords", "cppIndex(size=10, i=-3)", globals=namespace, minTime=minTime)
+    # The four-argument overload is only found after the two-argument one fails to match
+    yield measure("bindingCppIndex2", "cppIndex(10, 20, -3, 4)", globals=namespace, minTime=minTime)
+    count = 100000
+    yield measure("cppIndexInCpp", f"loopCppIndex(10, -3, {count})", globals=namespace, minTime=minTime,
+                  items=count)
+
+    try:
+        import numpy as np
+        from lsst.cpputils import fixGamutOK
+    except ImportError as error:
+        print(f"Skipping fixGamutOK: {error}", file=sys.stderr)
+        return
+    rng = np.random.default_rng(12345)
+    num = 1 << 20
+    namespace = dict(fixGamutOK=fixGamutOK, out=np.empty((num, 3)),
+                     Lab=np.column_stack([rng.uniform(0.0, 1.0, num), rng.uniform(-0.4, 0.4, num),
+                                          rng.uniform(-0.4, 0.4, num)]))
+    yield measure("fixGamutOK", "fixGamutOK(Lab, out=out)", globals=namespace, minTime=minTime, items=num)
+    yield measure("fixGamutOKCuspTable", "fixGamutOK(Lab, useCuspTable=True, out=out)", globals=namespace,
+                  minTime=minTime, items=num)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--benchmark_filter", default=".", help="Regular expression of benchmarks to run")
+    parser.add_argument("--benchmark_min_time", type=float, default=0.2, help="Minimum time per benchmark")
+    parser.add_argument("--benchmark_out", help="Output JSON file (default: standard output)")
+    args = parser.parse_args()
+
+    pattern = re.compile(args.benchmark_filter)
+    results = [result for result in benchmarks(args.benchmark_min_time) if pattern.search(result["name"])]
+    output = {
+        "context": {
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "host_name": platform.node(),
+            "executable": sys.argv[0],
+            "num_cpus": os.cpu_count(),
+            "python_version": platform.python_version(),
+        },
+        "benchmarks": results,
+    }
+    if args.benchmark_out:
+        with open(args.benchmark_out, "w") as stream:
+            json.dump(output, stream, indent=2)
+    else:
+        json.dump(output, sys.stdout, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,145 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Throughput of Cache and ConcurrentCache lookups
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "lsst/cpputils/Cache.h"
+#include "lsst/cpputils/ConcurrentCache.h"
+#include "lsst/cpputils/NodePool.h"
+
+#include "benchmark.h"
+
+using namespace lsst::cpputils;
+using namespace lsst::cpputils::benchmarks;
+
+namespace {
+
+std::vector<std::int64_t> const CAPACITIES = {16, 1024, 65536};
+std::vector<int> const THREADS = {1, 2, 4, 8};
+
+// Keys drawn uniformly from [0, range), in a fixed order
+std::vector<std::int64_t> makeKeys(std::int64_t range) {
+    std::mt19937_64 random(12345);
+    std::uniform_int_distribution<std::int64_t> distribution(0, range - 1);
+    std::vector<std::int64_t> keys(1 << 16);
+    for (auto & key : keys) {
+        key = distribution(random);
+    }
+    return keys;
+}
+
+auto const generator = [](std::int64_t key) { return 2*key; };
+
+// Lookups of keys that are all present
+void benchCacheHit(State & state) {
+    std::int64_t const capacity = state.range(0);
+    Cache<std::int64_t, std::int64_t> cache(capacity);
+    for (std::int64_t key = 0; key < capacity; ++key) {
+        cache.add(key, generator(key));
+    }
+    auto const keys = makeKeys(capacity);
+    std::size_t index = 0;
+    for (auto _ : state) {
+        doNotOptimize(cache(keys[index++ & (keys.size() - 1)], generator));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+LSST_BENCHMARK(benchCacheHit)->arg(16)->arg(1024)->arg(65536);
+
+// Lookups of keys that are all absent, without adding them
+void benchCacheMiss(State & state) {
+    std::int64_t const capacity = state.range(0);
+    Cache<std::int64_t, std::int64_t> cache(capacity);
+    for (std::int64_t key = 0; key < capacity; ++key) {
+        cache.add(key, generator(key));
+    }
+    std::int64_t key = capacity;
+    for (auto _ : state) {
+        doNotOptimize(cache.contains(key++));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+LSST_BENCHMARK(benchCacheMiss)->arg(16)->arg(1024)->arg(65536);
+
+// Lookups of new keys, each of which is generated and evicts the least recently used value
+template <typename CacheType>
+void runCacheEviction(State & state) {
+    std::int64_t const capacity = state.range(0);
+    CacheType cache(capacity);
+    for (std::int64_t key = 0; key < capacity; ++key) {
+        cache.add(key, generator(key));
+    }
+    std::int64_t key = capacity;
+    for (auto _ : state) {
+        doNotOptimize(cache(key++, generator));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+void benchCacheEviction(State & state) { runCacheEviction<Cache<std::int64_t, std::int64_t>>(state); }
+LSST_BENCHMARK(benchCacheEviction)->arg(16)->arg(1024)->arg(65536);
+
+// As above, with the nodes drawn from a pool
+void benchPooledCacheEviction(State & state) {
+    runCacheEviction<Cache<std::int64_t, std::int64_t, std::hash<std::int64_t>, std::equal_to<std::int64_t>,
+                           LruPolicy, NodePoolAllocator<void>>>(state);
+}
+LSST_BENCHMARK(benchPooledCacheEviction)->arg(16)->arg(1024)->arg(65536);
+
+// Lookups from several threads of keys drawn from twice the capacity, so about half are misses
+std::unique_ptr<ConcurrentCache<std::int64_t, std::int64_t>> sharedCache;
+
+void benchConcurrentCacheMixed(State & state) {
+    std::int64_t const capacity = state.range(0);
+    if (state.threadIndex() == 0) {
+        sharedCache = std::make_unique<ConcurrentCache<std::int64_t, std::int64_t>>(capacity);
+    }
+    auto const keys = makeKeys(2*capacity);
+    std::size_t index = 997*state.threadIndex();  // Threads start at different keys
+    for (auto _ : state) {
+        doNotOptimize((*sharedCache)(keys[index++ & (keys.size() - 1)], generator));
+    }
+    state.setItemsProcessed(state.iterations());
+    if (state.threadIndex() == 0) {
+        state.setCounter("hit_rate", sharedCache->stats().hitRate());
+        sharedCache.reset();
+    }
+}
+
+[[maybe_unused]] auto const registerConcurrent = [] {
+    auto * benchmark = registerBenchmark("benchConcurrentCacheMixed", benchConcurrentCacheMixed);
+    for (auto capacity : CAPACITIES) {
+        benchmark->arg(capacity);
+    }
+    for (auto threads : THREADS) {
+        benchmark->threads(threads);
+    }
+    return benchmark;
+}();
+
+}  // namespace
+
+LSST_BENCHMARK_MAIN();
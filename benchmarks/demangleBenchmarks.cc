@@ -0,0 +1,63 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Throughput of demangleType
+
+#include <string>
+#include <vector>
+
+#include "lsst/cpputils/Demangle.h"
+
+#include "benchmark.h"
+
+using namespace lsst::cpputils;
+using namespace lsst::cpputils::benchmarks;
+
+namespace {
+
+// Mangled names of `count` distinct types, of the form lsst::cpputils::Cache<int, lsst::TypeN>
+std::vector<std::string> makeNames(std::size_t count) {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string const type = "Type" + std::to_string(i);
+        names.push_back("N4lsst8cpputils5CacheIiN4lsst" + std::to_string(type.size()) + type + "EEE");
+    }
+    return names;
+}
+
+// Calls with the given number of distinct names; demangleType caches its results, so a working set
+// larger than the cache measures demangling itself
+void benchDemangleType(State & state) {
+    std::vector<std::string> const names = makeNames(state.range(0));
+    std::size_t index = 0;
+    for (auto _ : state) {
+        doNotOptimize(demangleType(names[index]));
+        if (++index == names.size()) {
+            index = 0;
+        }
+    }
+    state.setItemsProcessed(state.iterations());
+}
+LSST_BENCHMARK(benchDemangleType)->arg(1)->arg(100)->arg(100000);
+
+}  // namespace
+
+LSST_BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Throughput of the OKLab gamut clipping kernels behind fixGamutOK and linearToDisplayP3
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "lsst/cpputils/_oklabTools.h"
+
+#include "benchmark.h"
+
+using namespace lsst::cpputils;
+using namespace lsst::cpputils::benchmarks;
+
+namespace {
+
+constexpr std::size_t NUM_PIXELS = 1 << 16;
+
+// Interleaved colors with components drawn uniformly from the given ranges
+std::vector<float> makePixels(float min0, float max0, float min12, float max12) {
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> first(min0, max0);
+    std::uniform_real_distribution<float> others(min12, max12);
+    std::vector<float> pixels(3*NUM_PIXELS);
+    for (std::size_t i = 0; i < NUM_PIXELS; ++i) {
+        pixels[3*i] = first(random);
+        pixels[3*i + 1] = others(random);
+        pixels[3*i + 2] = others(random);
+    }
+    return pixels;
+}
+
+// Clipping of Lab points, as done by fixGamutOK; items are pixels
+template <typename CuspProvider>
+void clipLab(State & state, CuspProvider const& cuspProvider) {
+    std::vector<float> const input = makePixels(0.0f, 1.0f, -0.4f, 0.4f);
+    std::vector<float> output(input.size());
+    for (auto _ : state) {
+        details::gamut_clip_lab_adaptive_L0_L_cusp<float, details::DisplayP3Gamut>(
+                NUM_PIXELS, &input[0], &input[1], &input[2], 3, &output[0], &output[1], &output[2], 3, 0.05f,
+                cuspProvider);
+        doNotOptimize(output.data());
+    }
+    state.setItemsProcessed(state.iterations()*NUM_PIXELS);
+}
+
+void benchFixGamutExact(State & state) { clipLab(state, details::ExactCusp<>()); }
+LSST_BENCHMARK(benchFixGamutExact);
+
+void benchFixGamutCuspTable(State & state) { clipLab(state, details::CuspTable::displayP3()); }
+LSST_BENCHMARK(benchFixGamutCuspTable);
+
+// Conversion of linear Display P3 (partly out of gamut) to 8-bit display values; items are pixels
+void benchLinearToDisplayP3(State & state) {
+    std::vector<float> const input = makePixels(-0.1f, 1.2f, -0.1f, 1.2f);
+    std::vector<std::uint8_t> output(input.size());
+    auto const& cuspTable = details::CuspTable::displayP3();
+    for (auto _ : state) {
+        details::linear_displayP3_to_display(NUM_PIXELS, &input[0], &input[1], &input[2], 3, &output[0],
+                                             &output[1], &output[2], 3, 0.05f, cuspTable);
+        doNotOptimize(output.data());
+    }
+    state.setItemsProcessed(state.iterations()*NUM_PIXELS);
+}
+LSST_BENCHMARK(benchLinearToDisplayP3);
+
+}  // namespace
+
+LSST_BENCHMARK_MAIN();
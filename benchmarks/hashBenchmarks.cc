@@ -0,0 +1,121 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Cost and quality of hashCombine and FastHash; items are keys
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "lsst/cpputils/hashCombine.h"
+
+#include "benchmark.h"
+
+using namespace lsst::cpputils;
+using namespace lsst::cpputils::benchmarks;
+
+namespace {
+
+// A (tract, patch, visit, detector) key
+using DataId = std::tuple<int, int, long, int>;
+
+std::vector<DataId> makeDataIds() {
+    std::vector<DataId> ids;
+    for (int tract = 9813; tract < 9817; ++tract) {
+        for (int patch = 0; patch < 16; ++patch) {
+            for (long visit = 1000; visit < 1032; ++visit) {
+                for (int detector = 0; detector < 32; ++detector) {
+                    ids.emplace_back(tract, patch, visit, detector);
+                }
+            }
+        }
+    }
+    return ids;
+}
+
+std::vector<std::string> makeStrings() {
+    std::vector<std::string> strings;
+    for (int i = 0; i < (1 << 16); ++i) {
+        strings.push_back("calexp_HSC_i2_" + std::to_string(9813 + i % 4) + "_" + std::to_string(i));
+    }
+    return strings;
+}
+
+// Time hashing every key, and report the fraction of keys that collide in a table as large as the keys
+template <typename Key, typename Hash>
+void hashKeys(State & state, std::vector<Key> const& keys, Hash const& hash) {
+    std::size_t const mask = keys.size() - 1;  // keys.size() is a power of 2
+    std::vector<bool> occupied(keys.size(), false);
+    std::size_t collisions = 0;
+    for (auto const& key : keys) {
+        std::size_t const bucket = hash(key) & mask;
+        collisions += occupied[bucket];
+        occupied[bucket] = true;
+    }
+    for (auto _ : state) {
+        for (auto const& key : keys) {
+            doNotOptimize(hash(key));
+        }
+    }
+    state.setItemsProcessed(state.iterations()*keys.size());
+    state.setCounter("collision_rate", static_cast<double>(collisions)/keys.size());
+}
+
+void benchHashCombineDataId(State & state) {
+    hashKeys(state, makeDataIds(), [](DataId const& id) {
+        return hashCombine(0, std::get<0>(id), std::get<1>(id), std::get<2>(id), std::get<3>(id));
+    });
+}
+LSST_BENCHMARK(benchHashCombineDataId);
+
+void benchFastHashDataId(State & state) { hashKeys(state, makeDataIds(), FastHash<DataId>()); }
+LSST_BENCHMARK(benchFastHashDataId);
+
+void benchStdHashString(State & state) { hashKeys(state, makeStrings(), std::hash<std::string>()); }
+LSST_BENCHMARK(benchStdHashString);
+
+void benchFastHashString(State & state) { hashKeys(state, makeStrings(), FastHash<std::string>()); }
+LSST_BENCHMARK(benchFastHashString);
+
+// Hashing a contiguous array of state.range(0) integers
+void benchHashIterable(State & state) {
+    std::vector<int> const values(state.range(0), 42);
+    for (auto _ : state) {
+        doNotOptimize(hashIterable(0, values.begin(), values.end()));
+    }
+    state.setItemsProcessed(state.iterations()*values.size());
+}
+LSST_BENCHMARK(benchHashIterable)->arg(4)->arg(64)->arg(4096);
+
+void benchFastHashRange(State & state) {
+    std::vector<int> const values(state.range(0), 42);
+    for (auto _ : state) {
+        doNotOptimize(fastHashRange(0, values.data(), values.size()));
+    }
+    state.setItemsProcessed(state.iterations()*values.size());
+}
+LSST_BENCHMARK(benchFastHashRange)->arg(4)->arg(64)->arg(4096);
+
+}  // namespace
+
+LSST_BENCHMARK_MAIN();
@@ -0,0 +1,62 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+
+"""Run all cpputils benchmarks, and merge their results into a single JSON
+file in the format of Google Benchmark.
+
+The benchmarks must have been built first, with ``scons benchmarks``.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+PROGRAMS = ["cacheBenchmarks", "demangleBenchmarks", "gamutBenchmarks", "hashBenchmarks"]
+
+
+def main():
+    directory = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--output", default="benchmarks.json", help="Output JSON file")
+    parser.add_argument("--benchmark_filter", default=".", help="Regular expression of benchmarks to run")
+    parser.add_argument("--benchmark_min_time", default="0.2", help="Minimum time per benchmark")
+    args = parser.parse_args()
+    options = [f"--benchmark_filter={args.benchmark_filter}",
+               f"--benchmark_min_time={args.benchmark_min_time}"]
+
+    commands = [[os.path.join(directory, program)] + options for program in PROGRAMS]
+    commands.append([sys.executable, os.path.join(directory, "bindingBenchmarks.py")] + options)
+    merged = None
+    for command in commands:
+        result = json.loads(subprocess.run(command, check=True, stdout=subprocess.PIPE, cwd=directory).stdout)
+        if merged is None:
+            merged = result
+        else:
+            merged["benchmarks"].extend(result["benchmarks"])
+    with open(args.output, "w") as stream:
+        json.dump(merged, stream, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -35,9 +35,13 @@ namespace cpputils {
  *  - SIGSEGV
  *  - SIGILL
  *  - SIGFPE
+ *  - SIGBUS
  *
- *  @note Uses low level malloc and fprintf since higher level constructs
- *  may not be available when a signal is received.
+ *  @note The signal handler only uses async-signal-safe functions and
+ *  memory allocated in advance, since the heap may be corrupt when a signal
+ *  is received. The backtrace is written to stderr with mangled symbols
+ *  (use `c++filt` to demangle), and the process is then terminated by the
+ *  original signal.
  */
 class Backtrace final {
 public:
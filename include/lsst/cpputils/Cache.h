@@ -22,8 +22,13 @@
 #ifndef LSST_CPPUTILS_CACHE_H
 #define LSST_CPPUTILS_CACHE_H
 
+#include <chrono>
 #include <vector>
 #include <optional>
+#include <functional>  // std::function
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>  // std::pair
 
 #include "boost/multi_index_container.hpp"
@@ -35,8 +40,14 @@
 
 #include "lsst/pex/exceptions.h"
 #include "lsst/cpputils/CacheFwd.h"
+#include "lsst/cpputils/CachePolicy.h"
+#include "lsst/cpputils/CacheSpill.h"
+#include "lsst/cpputils/CacheStatistics.h"
+#include "lsst/cpputils/Instrumentation.h"
 
 //#define LSST_CACHE_DEBUG 1  // Define this variable to instrument for debugging
+// The requests are then written to a text file on destruction, which may be replayed with CacheTrace.h
+// (or the cacheTraceReplay.py script) to choose the capacity of the cache.
 
 
 #ifdef LSST_CACHE_DEBUG
@@ -49,6 +60,18 @@
 namespace lsst {
 namespace cpputils {
 
+namespace detail {
+
+// Does an allocator have a reserve(std::size_t) method, like NodePoolAllocator?
+template <typename Allocator, typename=void>
+struct HasReserve : std::false_type {};
+
+template <typename Allocator>
+struct HasReserve<Allocator, std::void_t<decltype(std::declval<Allocator&>().reserve(std::size_t()))>>
+    : std::true_type {};
+
+}  // namespace detail
+
 /** Cache of most recently used values
  *
  * This object stores the most recent `maxElements` values, where `maxElements`
@@ -60,6 +83,49 @@ namespace cpputils {
  * key, and if the key is not present, generate it with a function provided by
  * the user.
  *
+ * By default, the cache is limited only by the number of elements. A
+ * `Weigher` function may also be provided, together with a maximum total
+ * weight (e.g., the total number of bytes), in which case the least recently
+ * used values are also evicted until the total weight of the cached values
+ * fits within that budget.
+ *
+ * The order in which values are evicted is determined by the `Policy`
+ * (see `CachePolicy.h`). The default, `LruPolicy`, evicts the least recently
+ * used value; `SlruPolicy` and `TinyLfuPolicy` resist being flushed by
+ * one-pass sweeps over many keys.
+ *
+ * Values may also be given a time to live, either by default (with
+ * `setTimeToLive`) or individually (with `add`). Expired values are removed
+ * lazily: they are discarded when next looked up, and until then count
+ * towards the size of the cache and are included in `keys()`.
+ *
+ * Values evicted to respect the capacity may be kept in a secondary tier
+ * (e.g., a `DirectorySpillStore` on local disk), set with `setSpillStore`.
+ * On a miss, `operator()` and `computeMany` take the value from that tier,
+ * if it is there, instead of calling the generator. Expired values are not
+ * spilled, and promoted values are given the default time to live. Errors in
+ * the secondary tier are not propagated: a value that cannot be spilled is
+ * discarded, and one that cannot be read back is regenerated.
+ *
+ * Statistics of the use of the cache (hits, misses, etc.) are always
+ * collected, and are available through `stats()`. A fixed-size sample of the
+ * requested keys may also be collected, by calling `enableSampling()`.
+ *
+ * Values are returned by copy from `operator()`, `operator[]` and `get`. To
+ * avoid the copy for large values, use `getRef` or `visit`, which provide
+ * access to the cached value itself, and `add` with an rvalue or `emplace`,
+ * which move or construct the value into the cache. A reference to a cached
+ * value is invalidated if the value is evicted; if values need to outlive
+ * their time in the cache, use a `std::shared_ptr<T const>` as the `Value`,
+ * so that a hit costs only a reference count increment.
+ *
+ * The nodes of the container are allocated with the `Allocator` (rebound to
+ * the type of the node). To avoid going through the global allocator for
+ * every insertion and eviction, use a `NodePoolAllocator` (see
+ * `NodePool.h`): the cache reserves room in its pool for `maxElements` nodes,
+ * so that once it is full it does no allocation beyond any done by the `Key`
+ * and `Value` themselves.
+ *
  * @note `Value` and `Key` must be copyable.
  *
  * @note This header (`Cache.h`) should generally only be included in source
@@ -71,9 +137,24 @@ namespace cpputils {
  * @note Python bindings (for pybind11) are available in
  * `lsst/cpputils/python/Cache.h`.
  */
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
 class Cache {
   public:
+    /** Function returning the weight of a cached value
+     *
+     * The weight is measured when the value is added to the cache, and may be
+     * in any units (e.g., bytes) so long as they match those of the maximum
+     * weight.
+     */
+    typedef std::function<std::size_t(Key const&, Value const&)> Weigher;
+
+    /// Clock used for expiring values
+    typedef std::chrono::steady_clock Clock;
+
+    /// Time interval, e.g., for the time to live of cached values
+    typedef Clock::duration Duration;
+
     /** Ctor
      *
      * The maximum number of elements may be zero (default), in which
@@ -82,8 +163,32 @@ class Cache {
      * @exceptsafe Strong exception safety: exceptions will return the
      * system to previous state.
      */
-    Cache(std::size_t maxElements=0) : _maxElements(maxElements) {
+    Cache(std::size_t maxElements=0) : Cache(maxElements, Weigher(), 0) {}
+
+    /** Ctor with cost-aware eviction
+     *
+     * Either maximum may be zero, in which case the corresponding quantity
+     * is permitted to grow without limit.
+     *
+     * @param maxElements  Maximum number of elements.
+     * @param weigher  Function returning the weight of a value. If empty,
+     *                 each value has unit weight.
+     * @param maxWeight  Maximum total weight of the cached values.
+     * @param policy  Eviction policy.
+     * @param allocator  Allocator for the nodes of the container.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    Cache(std::size_t maxElements, Weigher weigher, std::size_t maxWeight, Policy policy=Policy(),
+          Allocator const& allocator=Allocator())
+      : _maxElements(maxElements), _maxWeight(maxWeight), _weight(0), _weigher(std::move(weigher)),
+        _timeToLive(Duration::zero()), _container(typename Container::ctor_args_list(), allocator),
+        _policy(std::move(policy)) {
         _container.template get<Hash>().reserve(maxElements);
+        _reserveNodes(maxElements);
+        _policy.reserve(maxElements);
+        _policy.rebuild(_container.template get<Sequence>());
 #ifdef LSST_CACHE_DEBUG
         _debuggingEnabled = false;
         _hits = 0;
@@ -92,11 +197,12 @@ class Cache {
 #endif
     }
 
-    // Defaulted stuff
-    Cache(Cache const &) = default;
-    Cache(Cache &&) = default;
-    Cache & operator=(Cache const &) = default;
-    Cache & operator=(Cache &&) = default;
+    // The policy may refer to elements of the container, so must be rebuilt
+    // whenever the container is copied or moved.
+    Cache(Cache const & other);
+    Cache(Cache && other);
+    Cache & operator=(Cache const & other);
+    Cache & operator=(Cache && other);
 
     /// Dtor
 #ifdef LSST_CACHE_DEBUG
@@ -153,6 +259,55 @@ class Cache {
      */
     void add(Key const& key, Value const& value);
 
+    /** Add a value to the cache, moving it into place
+     *
+     * If the key is already in the cache, the existing value will be
+     * promoted to the most recently used value, and `value` is unchanged.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void add(Key const& key, Value && value);
+
+    /** Add a value to the cache, constructed from the provided arguments
+     *
+     * The value is only constructed if the key is not already in the cache;
+     * otherwise, the existing value will be promoted to the most recently
+     * used value.
+     *
+     * @returns Whether a new value was constructed.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename... Args>
+    bool emplace(Key const& key, Args &&... args);
+
+    /** Add a value to the cache, with its own time to live
+     *
+     * This overrides the default time to live (`setTimeToLive`) for this
+     * value. If the key is already in the cache (and not expired), the
+     * existing value and its expiry are unchanged.
+     *
+     * @param key  Key for the value.
+     * @param value  Value to cache.
+     * @param timeToLive  Time after which the value expires; zero means it
+     *                    never expires.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void add(Key const& key, Value const& value, Duration timeToLive);
+
+    /** Remove a value from the cache, and from its spill tier
+     *
+     * @returns Whether the key was in the cache or its spill tier.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    bool erase(Key const& key);
+
     /** Return the number of values in the cache
      *
      * @exceptsafe Strong exception safety: exceptions will return the
@@ -161,6 +316,9 @@ class Cache {
     std::size_t size() const { return _container.size(); }
 
     /** Return all keys in the cache, most recent first
+     *
+     * For policies other than `LruPolicy`, the keys are in order of
+     * eviction priority, with the next to be evicted last.
      *
      * @exceptsafe Strong exception safety: exceptions will return the
      * system to previous state.
@@ -177,6 +335,20 @@ class Cache {
      */
     bool contains(Key const& key) { return _lookup(key).second; }
 
+    /** Is the key in the cache, without counting as a request?
+     *
+     * Unlike `contains`, this does not promote the value or update the
+     * statistics. An expired value counts as absent.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    bool peek(Key const& key) const {
+        auto const& hashContainer = _container.template get<Hash>();
+        auto it = hashContainer.find(key);
+        return it != hashContainer.end() && !it->isExpired();
+    }
+
     /** Return the cached value if it exists.
      *
      * If the key is in the cache, it will be promoted to the
@@ -194,6 +366,93 @@ class Cache {
         }
     }
 
+    /** Return the cached values for multiple keys
+     *
+     * Equivalent to calling `get` for each key in turn.
+     *
+     * @returns The cached value for each key, or an empty optional for keys
+     * that are not in the cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    std::vector<std::optional<Value>> getMany(std::vector<Key> const& keys);
+
+    /** Add multiple values to the cache
+     *
+     * Equivalent to calling `add` for each key-value pair in turn.
+     *
+     * @throws lsst::pex::exceptions::LengthError  If the numbers of keys and
+     * values differ.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void addMany(std::vector<Key> const& keys, std::vector<Value> const& values);
+
+    /** Lookup or generate multiple values
+     *
+     * This is the batch equivalent of `operator()`: the values of keys that
+     * are in the cache are returned directly, and the values of the rest are
+     * generated by a single call to the provided function, so that the
+     * function can amortize any work common to the keys. The `Generator`
+     * function signature should be:
+     *
+     *     std::vector<Value> func(std::vector<Key> const& missing);
+     *
+     * where `missing` contains the keys not in the cache (each only once),
+     * and the result contains the corresponding values in the same order.
+     * The generator is not called if all keys are in the cache.
+     *
+     * @returns The value for each key.
+     *
+     * @throws lsst::pex::exceptions::LengthError  If the generator does not
+     * return one value for each missing key.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Generator>
+    std::vector<Value> computeMany(std::vector<Key> const& keys, Generator func);
+
+    /** Return a reference to a cached value
+     *
+     * If the key is in the cache, it will be promoted to the
+     * most recently used value.
+     *
+     * The reference remains valid until the value is evicted, so should not
+     * be held across any subsequent call that modifies the cache.
+     *
+     * @throws lsst::pex::exceptions::NotFoundError  If key is not in the
+     * cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    Value const& getRef(Key const& key);
+
+    /** Apply a function to a cached value, if it exists
+     *
+     * If the key is in the cache, it will be promoted to the
+     * most recently used value, and the `Visitor` is called with the cached
+     * value. The `Visitor` function signature should be:
+     *
+     *     void func(Value const& value);
+     *
+     * @returns Whether the key was in the cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Visitor>
+    bool visit(Key const& key, Visitor func) {
+        auto result = _lookup(key);
+        if (result.second) {
+            func(result.first->second);
+        }
+        return result.second;
+    }
+
     /** Return the capacity of the cache
      *
      * @exceptsafe No exceptions can be thrown.
@@ -205,7 +464,69 @@ class Cache {
      * @exceptsafe Basic exception safety: exceptions will leave the
      * system in a valid but unpredictable state.
      */
-    void reserve(std::size_t maxElements) { _maxElements = maxElements; _trim(); }
+    void reserve(std::size_t maxElements) {
+        _maxElements = maxElements;
+        _policy.reserve(maxElements);
+        _trim();
+        _reserveNodes(maxElements);
+    }
+
+    /** Return the total weight of the values in the cache
+     *
+     * Without a `Weigher`, each value has unit weight, so this is the
+     * same as `size()`.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::size_t weight() const { return _weight; }
+
+    /** Return the maximum total weight of the cache
+     *
+     * Zero means the total weight is not limited.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::size_t maxWeight() const { return _maxWeight; }
+
+    /** Change the maximum total weight of the cache
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void reserveWeight(std::size_t maxWeight) { _maxWeight = maxWeight; _trim(); }
+
+    /** Return the default time to live of cached values
+     *
+     * Zero means values do not expire.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    Duration timeToLive() const { return _timeToLive; }
+
+    /** Change the default time to live of cached values
+     *
+     * This applies to values added subsequently; values already cached keep
+     * their expiry.
+     *
+     * @param timeToLive  Time after which values expire; zero means values
+     *                    do not expire.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    void setTimeToLive(Duration timeToLive) { _timeToLive = timeToLive; }
+
+    /** Return the time remaining before a cached value expires
+     *
+     * This does not count as a request, and does not promote the value.
+     *
+     * @returns The time remaining (which is negative if the value has
+     * expired but not yet been removed), or an empty optional if the key is
+     * not in the cache or its value does not expire.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::optional<Duration> timeRemaining(Key const& key) const;
 
     /** Empty the cache
      *
@@ -214,27 +535,102 @@ class Cache {
      */
     void flush();
 
+    /** Return statistics of the use of the cache
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    CacheStatistics stats() const { return _counters.get(); }
+
+    /** Reset the statistics of the use of the cache
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    void resetStats() { _counters.reset(); }
+
+    /** Start recording a sample of the requested keys
+     *
+     * The most recent samples are retained in a ring buffer of fixed size.
+     * Any previous samples are discarded.
+     *
+     * @param capacity  Maximum number of samples to retain; zero disables
+     *                  sampling.
+     * @param interval  Record every `interval`-th requested key.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void enableSampling(std::size_t capacity, std::size_t interval=1) { _sampler.enable(capacity, interval); }
+
+    /** Return the sampled keys, oldest first
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::vector<Key> sampledKeys() const { return _sampler.get(); }
+
+    /** Set the secondary tier that receives values evicted to respect the capacity
+     *
+     * The tier may be shared between caches. Values already in the tier are
+     * not affected by `flush`; values replaced in the cache (by `add`, or
+     * a generator, after expiry) or erased from it are removed from the tier.
+     *
+     * @param store  Secondary tier; null disables spilling.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    void setSpillStore(std::shared_ptr<SpillStore<Key, Value>> store) { _spillStore = std::move(store); }
+
+    /** Return the secondary tier, or null if there is none
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::shared_ptr<SpillStore<Key, Value>> getSpillStore() const { return _spillStore; }
+
 #ifdef LSST_CACHE_DEBUG
     void enableDebugging() { _debuggingEnabled = true; }
 #endif
 
   private:
 
+    // Would the cache be larger than permitted with an additional element of the given weight?
+    bool _isOverfull(std::size_t extraElements=0, std::size_t extraWeight=0) const {
+        return (capacity() > 0 && size() + extraElements > capacity()) ||
+            (maxWeight() > 0 && weight() + extraWeight > maxWeight());
+    }
+
     // Trim the cache to size
     void _trim() {
-        if (capacity() == 0) return;  // Allowed to grow without limit
-        while (size() > capacity()) {
-            _container.template get<Sequence>().pop_back();
+        while (size() > 0 && _isOverfull()) {
+            _spillLast();
+            _evictLast();
+            _counters.eviction();
         }
     }
 
     // Element in the multi_index container
-    typedef std::pair<Key, Value> Element;
+    //
+    // The key and value are stored as `first` and `second`, as in a std::pair.
+    // Any state required by the policy is inherited.
+    struct Element : public Policy::EntryState {
+        template <typename V>
+        Element(Key const& key, V && value, std::size_t weight_, Clock::time_point expiry_)
+          : first(key), second(std::forward<V>(value)), weight(weight_), expiry(expiry_) {}
+
+        // Has the value expired?
+        bool isExpired() const { return expiry != Clock::time_point::max() && Clock::now() >= expiry; }
+
+        Key first;
+        Value second;
+        std::size_t weight;  // Weight of value, as measured on insertion
+        Clock::time_point expiry;  // When the value expires; max() means never
+    };
 
     // Tags for multi_index container
     struct Sequence {};
     struct Hash {};
 
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Element> ElementAllocator;
+
     // The multi_index container
     typedef boost::multi_index_container<
                 Element,
@@ -243,20 +639,104 @@ class Cache {
                     boost::multi_index::hashed_unique<
                         boost::multi_index::tag<Hash>,
                         boost::multi_index::member<Element, Key, &Element::first>,
-                            KeyHash>>> Container;
+                            KeyHash>>,
+                ElementAllocator> Container;
+
+    // Make room for the nodes of a full cache, if the allocator supports it
+    //
+    // The container's header is also a node, and an insertion into a full cache precedes the eviction,
+    // so a full cache needs two nodes more than the capacity.
+    void _reserveNodes(std::size_t maxElements) {
+        if constexpr (detail::HasReserve<ElementAllocator>::value) {
+            if (maxElements > 0) {
+                _container.get_allocator().reserve(maxElements + 2);
+            }
+        }
+    }
+
+    // Remove an element
+    void _erase(typename Container::template index<Sequence>::type::iterator it) {
+        auto & sequence = _container.template get<Sequence>();
+        _policy.onErase(sequence, it);
+        _weight -= it->weight;
+        sequence.erase(it);
+    }
+
+    // Remove the element at the back of the sequence (least recently used, for LRU)
+    void _evictLast() {
+        auto & sequence = _container.template get<Sequence>();
+        _erase(std::prev(sequence.end()));
+    }
+
+    // Write the element at the back of the sequence to the spill tier, if any, before it is evicted
+    //
+    // A value that cannot be spilled is simply evicted, so the cache keeps to its capacity.
+    void _spillLast() {
+        Element const& last = _container.template get<Sequence>().back();
+        if (_spillStore && !last.isExpired()) {
+            try {
+                _spillStore->put(last.first, last.second);
+            } catch (...) {
+                return;
+            }
+            _counters.spill();
+        }
+    }
+
+    // Move a value from the spill tier into the cache, if it is there
+    //
+    // Returns the value, or an empty optional if it was not spilled or cannot be read back (in which case
+    // the caller falls back to the generator).
+    std::optional<Value> _unspill(Key const& key) {
+        if (!_spillStore) {
+            return std::nullopt;
+        }
+        std::optional<Value> value;
+        try {
+            value = _spillStore->take(key);
+        } catch (...) {
+            return std::nullopt;
+        }
+        if (value) {
+            _counters.spillHit();
+            Element const* element = _addNew(key, std::move(*value));
+            if (element) {
+                return element->second;
+            }
+        }
+        return value;
+    }
 
     // Lookup key in the container
     //
     // Returns the iterator and whether there's anything there.
     //
     // If the key exists, updates the cache to make that key the most recent.
-    std::pair<typename Container::template index<Hash>::type::iterator, bool> _lookup(Key const& key) {
+    // An expired value is removed, and treated as absent.
+    // If this is a request for the value, the statistics are updated.
+    std::pair<typename Container::template index<Hash>::type::iterator, bool> _lookup(
+        Key const& key,
+        bool isRequest=true
+    ) {
         auto const& hashContainer = _container.template get<Hash>();
+        _policy.recordAccess(key, hashContainer.hash_function());
         auto it = hashContainer.find(key);
+        if (it != hashContainer.end() && it->isExpired()) {
+            _erase(_container.template project<Sequence>(it));
+            _counters.expiration();
+            it = hashContainer.end();
+        }
         bool found = (it != hashContainer.end());
         if (found) {
-            _container.relocate(_container.template get<Sequence>().begin(),
-                                _container.template project<Sequence>(it));
+            _policy.onHit(_container.template get<Sequence>(), _container.template project<Sequence>(it));
+        }
+        if (isRequest) {
+            if (found) {
+                _counters.hit();
+            } else {
+                _counters.miss();
+            }
+            _sampler.offer(key);
         }
 #ifdef LSST_CACHE_DEBUG
         if (_debuggingEnabled) {
@@ -269,13 +749,62 @@ class Cache {
     }
 
     // Add a key-value pair that are not already present
-    void _addNew(Key const& key, Value const& value) {
-        _container.template get<Sequence>().emplace_front(key, value);
-        _trim();
+    //
+    // If adding the pair requires an eviction, the policy may decline to admit it.
+    // An rvalue is moved into the container; if it is not retained (because it
+    // was not admitted, or was itself evicted to make room), it is left in (or
+    // moved back into) `value`.
+    //
+    // The value expires after the time to live, or the default if not provided.
+    //
+    // Returns the new element, or nullptr if the value was not retained.
+    template <typename V>
+    Element const* _addNew(Key const& key, V && value, std::optional<Duration> timeToLive=std::nullopt) {
+        if (_spillStore) {
+            _spillStore->erase(key);  // Any spilled value is stale
+        }
+        std::size_t const weight = _weigher ? _weigher(key, value) : 1;
+        auto & sequence = _container.template get<Sequence>();
+        if (size() > 0 && _isOverfull(1, weight) &&
+            !_policy.admit(key, sequence.back().first, _container.template get<Hash>().hash_function())) {
+            return nullptr;
+        }
+        Duration const ttl = timeToLive ? *timeToLive : _timeToLive;
+        Clock::time_point const expiry = (ttl > Duration::zero()) ? Clock::now() + ttl :
+            Clock::time_point::max();
+        auto it = sequence.emplace(_policy.insertPosition(sequence), key, std::forward<V>(value), weight,
+                                   expiry).first;
+        _policy.onInsert(sequence, it);
+        _weight += weight;
+        _counters.insertion();
+
+        Element const* element = &*it;
+        while (size() > 0 && _isOverfull()) {
+            if (&sequence.back() == element) {
+                if constexpr (std::is_rvalue_reference<V &&>::value) {
+                    sequence.modify(std::prev(sequence.end()),
+                                    [&value](Element & evicted) { value = std::move(evicted.second); });
+                }
+                element = nullptr;
+            } else {
+                _spillLast();
+            }
+            _evictLast();
+            _counters.eviction();
+        }
+        return element;
     }
 
     std::size_t _maxElements;  // Maximum number of elements; 0 means infinite
+    std::size_t _maxWeight;  // Maximum total weight; 0 means infinite
+    std::size_t _weight;  // Total weight of cached values
+    Weigher _weigher;  // Function providing the weight of a value; may be empty
+    Duration _timeToLive;  // Default time to live of values; 0 means infinite
     Container _container;  // Container of key,value pairs
+    Policy _policy;  // Eviction policy
+    detail::CacheCounters _counters;  // Statistics of use
+    detail::KeySampler<Key> _sampler;  // Sample of requested keys
+    std::shared_ptr<SpillStore<Key, Value>> _spillStore;  // Secondary tier for evicted values; may be null
 #ifdef LSST_CACHE_DEBUG
     bool _debuggingEnabled;
     mutable std::size_t _hits, _total;  // Statistics of cache hits
@@ -289,9 +818,89 @@ class Cache {
 
 // Definitions
 
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::Cache(Cache const & other)
+  : _maxElements(other._maxElements), _maxWeight(other._maxWeight), _weight(other._weight),
+    _weigher(other._weigher), _timeToLive(other._timeToLive), _container(other._container),
+    _policy(other._policy),
+    _counters(other._counters), _sampler(other._sampler), _spillStore(other._spillStore)
+#ifdef LSST_CACHE_DEBUG
+    , _debuggingEnabled(other._debuggingEnabled), _hits(other._hits), _total(other._total),
+    _requests(other._requests)
+#endif
+{
+    _policy.rebuild(_container.template get<Sequence>());
+    _reserveNodes(_maxElements);
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::Cache(Cache && other)
+  : _maxElements(other._maxElements), _maxWeight(other._maxWeight), _weight(other._weight),
+    _weigher(std::move(other._weigher)), _timeToLive(other._timeToLive),
+    _container(std::move(other._container)),
+    _policy(std::move(other._policy)), _counters(other._counters), _sampler(std::move(other._sampler)),
+    _spillStore(std::move(other._spillStore))
+#ifdef LSST_CACHE_DEBUG
+    , _debuggingEnabled(other._debuggingEnabled), _hits(other._hits), _total(other._total),
+    _requests(std::move(other._requests))
+#endif
+{
+    _policy.rebuild(_container.template get<Sequence>());
+    other._weight = 0;
+    other._container.clear();
+    other._policy.rebuild(other._container.template get<Sequence>());
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator> &
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::operator=(
+    Cache const & other
+) {
+    if (this != &other) {
+        Cache copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator> &
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::operator=(
+    Cache && other
+) {
+    if (this != &other) {
+        _maxElements = other._maxElements;
+        _maxWeight = other._maxWeight;
+        _weight = other._weight;
+        _weigher = std::move(other._weigher);
+        _timeToLive = other._timeToLive;
+        _container = std::move(other._container);
+        _policy = std::move(other._policy);
+        _counters = other._counters;
+        _sampler = std::move(other._sampler);
+        _spillStore = std::move(other._spillStore);
+#ifdef LSST_CACHE_DEBUG
+        _debuggingEnabled = other._debuggingEnabled;
+        _hits = other._hits;
+        _total = other._total;
+        _requests = std::move(other._requests);
+#endif
+        _policy.rebuild(_container.template get<Sequence>());
+        other._weight = 0;
+        other._container.clear();
+        other._policy.rebuild(other._container.template get<Sequence>());
+    }
+    return *this;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
 template <typename Generator>
-Value Cache<Key, Value, KeyHash, KeyPred>::operator()(
+Value Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::operator()(
     Key const& key,
     Generator func
 ) {
@@ -299,13 +908,27 @@ Value Cache<Key, Value, KeyHash, KeyPred>::operator()(
     if (result.second) {
         return result.first->second;
     }
+    if (std::optional<Value> spilled = _unspill(key)) {
+        return *std::move(spilled);
+    }
+    auto const start = std::chrono::steady_clock::now();
     Value value = func(key);
-    _addNew(key, value);
-    return value;
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    _counters.generation(elapsed);
+    LSST_COUNTER_ADD("cpputils.Cache.generate", 1, elapsed);
+    Element const* element = _addNew(key, std::move(value));
+    return element ? element->second : value;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Value Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::operator[](Key const& key) {
+    return getRef(key);
 }
 
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
-Value Cache<Key, Value, KeyHash, KeyPred>::operator[](Key const& key) {
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Value const& Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::getRef(Key const& key) {
     auto result = _lookup(key);
     if (result.second) {
         return result.first->second;
@@ -314,16 +937,153 @@ Value Cache<Key, Value, KeyHash, KeyPred>::operator[](Key const& key) {
                       (boost::format("Unable to find key: %s") % key).str());
 }
 
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
-void Cache<Key, Value, KeyHash, KeyPred>::add(Key const& key, Value const& value) {
-    auto result = _lookup(key);
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+void Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::add(Key const& key, Value const& value) {
+    auto result = _lookup(key, false);
     if (!result.second) {
         _addNew(key, value);
     }
 }
 
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
-std::vector<Key> Cache<Key, Value, KeyHash, KeyPred>::keys() const {
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+void Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::add(Key const& key, Value && value) {
+    auto result = _lookup(key, false);
+    if (!result.second) {
+        _addNew(key, std::move(value));
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+void Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::add(
+    Key const& key,
+    Value const& value,
+    Duration timeToLive
+) {
+    auto result = _lookup(key, false);
+    if (!result.second) {
+        _addNew(key, value, timeToLive);
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+bool Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::erase(Key const& key) {
+    auto const& hashContainer = _container.template get<Hash>();
+    auto it = hashContainer.find(key);
+    bool const spilled = _spillStore && _spillStore->erase(key);
+    if (it == hashContainer.end()) {
+        return spilled;
+    }
+    _erase(_container.template project<Sequence>(it));
+    return true;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+std::optional<typename Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::Duration>
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::timeRemaining(Key const& key) const {
+    auto const& hashContainer = _container.template get<Hash>();
+    auto it = hashContainer.find(key);
+    if (it == hashContainer.end() || it->expiry == Clock::time_point::max()) {
+        return std::nullopt;
+    }
+    return it->expiry - Clock::now();
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+template <typename... Args>
+bool Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::emplace(Key const& key, Args &&... args) {
+    auto result = _lookup(key, false);
+    if (result.second) {
+        return false;
+    }
+    _addNew(key, Value(std::forward<Args>(args)...));
+    return true;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+std::vector<std::optional<Value>> Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::getMany(
+    std::vector<Key> const& keys
+) {
+    std::vector<std::optional<Value>> result;
+    result.reserve(keys.size());
+    for (auto const& key : keys) {
+        result.push_back(get(key));
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+void Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::addMany(
+    std::vector<Key> const& keys,
+    std::vector<Value> const& values
+) {
+    if (keys.size() != values.size()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Number of keys (%d) and values (%d) differ") %
+                           keys.size() % values.size()).str());
+    }
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        add(keys[ii], values[ii]);
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+template <typename Generator>
+std::vector<Value> Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::computeMany(
+    std::vector<Key> const& keys,
+    Generator func
+) {
+    std::vector<std::optional<Value>> found = getMany(keys);
+    std::vector<Key> missing;
+    std::unordered_map<Key, std::size_t, KeyHash, KeyPred> missingIndex;  // Index of key in missing
+    std::unordered_map<Key, std::size_t, KeyHash, KeyPred> unspilledIndex;  // Index of key in keys
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        if (found[ii] || missingIndex.count(keys[ii]) > 0) {
+            continue;
+        }
+        auto const unspilled = unspilledIndex.find(keys[ii]);
+        if (unspilled != unspilledIndex.end()) {
+            found[ii] = found[unspilled->second];
+        } else if ((found[ii] = _unspill(keys[ii]))) {
+            unspilledIndex.emplace(keys[ii], ii);
+        } else {
+            missingIndex.emplace(keys[ii], missing.size());
+            missing.push_back(keys[ii]);
+        }
+    }
+    std::vector<Value> generated;
+    if (!missing.empty()) {
+        auto const start = std::chrono::steady_clock::now();
+        generated = func(missing);
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        _counters.generation(elapsed);
+        LSST_COUNTER_ADD("cpputils.Cache.generate", missing.size(), elapsed);
+        addMany(missing, generated);
+    }
+
+    std::vector<Value> result;
+    result.reserve(keys.size());
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        if (found[ii]) {
+            result.push_back(*std::move(found[ii]));
+        } else {
+            result.push_back(generated[missingIndex.find(keys[ii])->second]);
+        }
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+std::vector<Key> Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::keys() const {
     std::vector<Key> result;
     result.reserve(size());
     for (auto & keyValue : _container.template get<Sequence>()) {
@@ -332,16 +1092,18 @@ std::vector<Key> Cache<Key, Value, KeyHash, KeyPred>::keys() const {
     return result;
 }
 
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
-void Cache<Key, Value, KeyHash, KeyPred>::flush() {
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+void Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::flush() {
     while (size() > 0) {
-        _container.template get<Sequence>().pop_back();
+        _evictLast();
     }
 }
 
 #ifdef LSST_CACHE_DEBUG
-template <typename Key, typename Value, typename KeyHash, typename KeyPred>
-Cache<Key, Value, KeyHash, KeyPred>::~Cache() {
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy,
+          typename Allocator>
+Cache<Key, Value, KeyHash, KeyPred, Policy, Allocator>::~Cache() {
     if (!_debuggingEnabled) {
         return;
     }
@@ -24,18 +24,34 @@
 
 /* Forward declarations for lsst::cpputils::Cache
  *
- * For details on the Cache class, see the Cache.h file.
+ * For details on the Cache class, see the Cache.h file; for the
+ * ConcurrentCache class, see the ConcurrentCache.h file; and for the
+ * eviction policies, see the CachePolicy.h file.
  */
 
 #include <functional>  // std::equal_to, std::hash
+#include <memory>  // std::allocator
+#include <utility>  // std::pair
 
 namespace lsst {
 namespace cpputils {
 
+class LruPolicy;
+class SlruPolicy;
+class TinyLfuPolicy;
+
+template <typename Key, typename Value>
+class SpillStore;
+
 template <typename Key, typename Value, typename KeyHash=std::hash<Key>,
-          typename KeyPred=std::equal_to<Key>>
+          typename KeyPred=std::equal_to<Key>, typename Policy=LruPolicy,
+          typename Allocator=std::allocator<std::pair<Key const, Value>>>
 class Cache;
 
+template <typename Key, typename Value, typename KeyHash=std::hash<Key>,
+          typename KeyPred=std::equal_to<Key>, typename Policy=LruPolicy>
+class ConcurrentCache;
+
 }
 } // namespace lsst::cpputils
 
@@ -0,0 +1,353 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_CPPUTILS_CACHE_POLICY_H
+#define LSST_CPPUTILS_CACHE_POLICY_H
+
+/* Eviction policies for lsst::cpputils::Cache
+ *
+ * A policy controls where elements are placed in the cache's sequence of
+ * elements; the cache always evicts from the back of that sequence. A policy
+ * must provide:
+ *
+ *     // Per-element state, inherited by each element (members must be mutable)
+ *     struct EntryState;
+ *     // Recompute any state referring to the sequence (e.g., after a copy)
+ *     template <typename Sequence> void rebuild(Sequence & sequence);
+ *     // Notification of a change to the capacity of the cache
+ *     void reserve(std::size_t maxElements);
+ *     // Position at which to insert a new element
+ *     template <typename Sequence> typename Sequence::iterator insertPosition(Sequence & sequence);
+ *     // Notification that an element was inserted
+ *     template <typename Sequence> void onInsert(Sequence & sequence, typename Sequence::iterator it);
+ *     // Notification that an element was requested, which may be relocated
+ *     template <typename Sequence> void onHit(Sequence & sequence, typename Sequence::iterator it);
+ *     // Notification that an element is about to be erased
+ *     template <typename Sequence> void onErase(Sequence & sequence, typename Sequence::iterator it);
+ *     // Notification that a key was requested (whether or not it is present)
+ *     template <typename Key, typename Hash> void recordAccess(Key const& key, Hash const& hash);
+ *     // Should a new key be admitted at the expense of evicting the victim?
+ *     template <typename Key, typename Hash>
+ *     bool admit(Key const& candidate, Key const& victim, Hash const& hash);
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "lsst/pex/exceptions.h"
+
+namespace lsst {
+namespace cpputils {
+
+/** Least recently used eviction policy
+ *
+ * Requested elements are moved to the front of the sequence, so the least
+ * recently used element is evicted. This is the default policy for `Cache`.
+ */
+class LruPolicy {
+  public:
+    /// No per-element state is required
+    struct EntryState {};
+
+    template <typename Sequence>
+    void rebuild(Sequence & sequence) {}
+
+    void reserve(std::size_t maxElements) {}
+
+    template <typename Sequence>
+    typename Sequence::iterator insertPosition(Sequence & sequence) { return sequence.begin(); }
+
+    template <typename Sequence>
+    void onInsert(Sequence & sequence, typename Sequence::iterator it) {}
+
+    template <typename Sequence>
+    void onHit(Sequence & sequence, typename Sequence::iterator it) {
+        sequence.relocate(sequence.begin(), it);
+    }
+
+    template <typename Sequence>
+    void onErase(Sequence & sequence, typename Sequence::iterator it) {}
+
+    template <typename Key, typename Hash>
+    void recordAccess(Key const& key, Hash const& hash) {}
+
+    template <typename Key, typename Hash>
+    bool admit(Key const& candidate, Key const& victim, Hash const& hash) { return true; }
+};
+
+/** Segmented least recently used eviction policy
+ *
+ * New elements enter a probationary segment, and are promoted to a protected
+ * segment when they are requested again. Elements are evicted from the
+ * probationary segment, so a single pass over many keys (each requested only
+ * once) cannot flush the protected working set. When the protected segment
+ * exceeds its share of the capacity, its least recently used element is
+ * demoted to the front of the probationary segment.
+ *
+ * The sequence holds the protected segment in front of the probationary
+ * segment, each ordered from most to least recently used.
+ */
+class SlruPolicy {
+  public:
+    /// Whether an element is in the protected segment
+    struct EntryState {
+        mutable bool isProtected = false;
+    };
+
+    /** Ctor
+     *
+     * @param protectedFraction  Fraction of the capacity reserved for the
+     *                           protected segment; must be in [0, 1).
+     *
+     * @throws lsst::pex::exceptions::InvalidParameterError  If the fraction
+     * is out of range.
+     */
+    explicit SlruPolicy(double protectedFraction=0.8)
+      : _protectedFraction(protectedFraction), _maxElements(0), _numProtected(0), _probation(nullptr) {
+        if (!(protectedFraction >= 0.0 && protectedFraction < 1.0)) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              "Protected fraction must be in [0, 1)");
+        }
+    }
+
+    template <typename Sequence>
+    void rebuild(Sequence & sequence) {
+        _numProtected = 0;
+        auto it = sequence.begin();
+        for (; it != sequence.end() && it->isProtected; ++it) {
+            ++_numProtected;
+        }
+        _setProbation(sequence, it);
+    }
+
+    void reserve(std::size_t maxElements) { _maxElements = maxElements; }
+
+    template <typename Sequence>
+    typename Sequence::iterator insertPosition(Sequence & sequence) { return _getProbation(sequence); }
+
+    template <typename Sequence>
+    void onInsert(Sequence & sequence, typename Sequence::iterator it) {
+        it->isProtected = false;
+        _setProbation(sequence, it);
+    }
+
+    template <typename Sequence>
+    void onHit(Sequence & sequence, typename Sequence::iterator it) {
+        if (!it->isProtected) {
+            if (it == _getProbation(sequence)) {
+                _setProbation(sequence, std::next(it));
+            }
+            it->isProtected = true;
+            ++_numProtected;
+        }
+        sequence.relocate(sequence.begin(), it);
+
+        // Demote the least recently used protected elements to the head of probation
+        std::size_t const limit = _protectedLimit(sequence.size());
+        while (_numProtected > limit) {
+            auto demoted = std::prev(_getProbation(sequence));
+            demoted->isProtected = false;
+            --_numProtected;
+            _setProbation(sequence, demoted);
+        }
+    }
+
+    template <typename Sequence>
+    void onErase(Sequence & sequence, typename Sequence::iterator it) {
+        if (it->isProtected) {
+            --_numProtected;
+        } else if (it == _getProbation(sequence)) {
+            _setProbation(sequence, std::next(it));
+        }
+    }
+
+    template <typename Key, typename Hash>
+    void recordAccess(Key const& key, Hash const& hash) {}
+
+    template <typename Key, typename Hash>
+    bool admit(Key const& candidate, Key const& victim, Hash const& hash) { return true; }
+
+  private:
+
+    // Maximum number of protected elements
+    //
+    // Without a limit on the number of elements, the limit scales with the
+    // number of elements present. This always leaves room in probation for
+    // a new element, so it is never evicted on insertion.
+    std::size_t _protectedLimit(std::size_t size) const {
+        return static_cast<std::size_t>(_protectedFraction*(_maxElements > 0 ? _maxElements : size));
+    }
+
+    // The head of the probationary segment is held as a pointer to its
+    // element (null for the end of the sequence) rather than an iterator,
+    // because the type of the sequence isn't known to the policy.
+    template <typename Sequence>
+    typename Sequence::iterator _getProbation(Sequence & sequence) const {
+        if (!_probation) return sequence.end();
+        return sequence.iterator_to(*static_cast<typename Sequence::value_type const*>(_probation));
+    }
+
+    template <typename Sequence>
+    void _setProbation(Sequence & sequence, typename Sequence::iterator it) {
+        _probation = (it == sequence.end()) ? nullptr : &*it;
+    }
+
+    double _protectedFraction;  // Fraction of the capacity reserved for protected elements
+    std::size_t _maxElements;  // Capacity of the cache; 0 means infinite
+    std::size_t _numProtected;  // Number of protected elements
+    void const* _probation;  // Element at the head of probation, or null if probation is empty
+};
+
+/** Frequency sketch for estimating how often keys are requested
+ *
+ * This is a count-min sketch with four rows of saturating 4-bit counters.
+ * All counters are halved periodically, so that the estimates reflect
+ * recent popularity rather than all history.
+ */
+class FrequencySketch {
+  public:
+    /// Maximum frequency that can be recorded
+    static constexpr unsigned MAX_FREQUENCY = 15;
+
+    /** Ctor
+     *
+     * @param maxElements  Expected number of distinct keys to track.
+     */
+    explicit FrequencySketch(std::size_t maxElements=0) { reserve(maxElements); }
+
+    /** Resize the sketch to track the given number of keys
+     *
+     * All recorded frequencies are forgotten.
+     */
+    void reserve(std::size_t maxElements) {
+        std::size_t width = MIN_WIDTH;
+        while (width < maxElements) {
+            width <<= 1;
+        }
+        _mask = width - 1;
+        _counters.assign(NUM_ROWS*width, 0);
+        _sampleSize = 10*width;
+        _additions = 0;
+    }
+
+    /// Record a request for a key with the given hash
+    void increment(std::size_t hash) {
+        bool added = false;
+        for (std::size_t row = 0; row < NUM_ROWS; ++row) {
+            std::uint8_t & counter = _counters[_index(hash, row)];
+            if (counter < MAX_FREQUENCY) {
+                ++counter;
+                added = true;
+            }
+        }
+        if (added && ++_additions >= _sampleSize) {
+            _age();
+        }
+    }
+
+    /// Return the estimated frequency of requests for a key with the given hash
+    unsigned frequency(std::size_t hash) const {
+        unsigned result = MAX_FREQUENCY;
+        for (std::size_t row = 0; row < NUM_ROWS; ++row) {
+            result = std::min<unsigned>(result, _counters[_index(hash, row)]);
+        }
+        return result;
+    }
+
+    /// Forget all recorded frequencies
+    void clear() {
+        std::fill(_counters.begin(), _counters.end(), 0);
+        _additions = 0;
+    }
+
+  private:
+    static constexpr std::size_t NUM_ROWS = 4;
+    static constexpr std::size_t MIN_WIDTH = 64;
+
+    // Index of the counter for a hash in a row
+    //
+    // The hash is remixed with a different seed for each row, because many
+    // std::hash specializations are the identity function.
+    std::size_t _index(std::size_t hash, std::size_t row) const {
+        static constexpr std::uint64_t seeds[NUM_ROWS] = {
+            0x97cb3127c3e01d2fULL, 0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL
+        };
+        std::uint64_t mixed = (static_cast<std::uint64_t>(hash) + seeds[row])*0xff51afd7ed558ccdULL;
+        mixed ^= mixed >> 32;
+        return (row*(_mask + 1)) + (mixed & _mask);
+    }
+
+    // Halve all counters, so that old requests decay
+    void _age() {
+        for (auto & counter : _counters) {
+            counter >>= 1;
+        }
+        _additions /= 2;
+    }
+
+    std::vector<std::uint8_t> _counters;  // Counters for each row, concatenated
+    std::size_t _mask;  // Width of each row, less one
+    std::size_t _sampleSize;  // Number of additions before ageing
+    std::size_t _additions;  // Number of additions since last ageing
+};
+
+/** TinyLFU admission policy over segmented LRU eviction
+ *
+ * Eviction is as for `SlruPolicy`, but when the cache is full a new element
+ * is only admitted if its key has been requested more frequently than the
+ * key that would be evicted to make room for it, according to a
+ * `FrequencySketch` of recent requests. This keeps rarely requested keys
+ * (e.g., from a one-pass sweep) from displacing popular ones at all.
+ *
+ * Rejected values are still returned by `Cache::operator()`; they simply
+ * aren't retained.
+ */
+class TinyLfuPolicy : public SlruPolicy {
+  public:
+    /** Ctor
+     *
+     * @param protectedFraction  Fraction of the capacity reserved for the
+     *                           protected segment; must be in [0, 1).
+     */
+    explicit TinyLfuPolicy(double protectedFraction=0.8) : SlruPolicy(protectedFraction) {}
+
+    void reserve(std::size_t maxElements) {
+        SlruPolicy::reserve(maxElements);
+        _sketch.reserve(maxElements);
+    }
+
+    template <typename Key, typename Hash>
+    void recordAccess(Key const& key, Hash const& hash) { _sketch.increment(hash(key)); }
+
+    template <typename Key, typename Hash>
+    bool admit(Key const& candidate, Key const& victim, Hash const& hash) {
+        return _sketch.frequency(hash(candidate)) > _sketch.frequency(hash(victim));
+    }
+
+  private:
+    FrequencySketch _sketch;  // Frequency of recent requests
+};
+
+}
+} // namespace lsst::cpputils
+
+#endif // ifndef LSST_CPPUTILS_CACHE_POLICY_H
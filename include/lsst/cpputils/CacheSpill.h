@@ -0,0 +1,288 @@
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_CACHE_SPILL_H
+#define LSST_CPPUTILS_CACHE_SPILL_H
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "lsst/pex/exceptions.h"
+
+namespace lsst {
+namespace cpputils {
+
+/** Read-only memory map of an entire file
+ *
+ * The mapping remains valid after the file is removed, for as long as the
+ * object exists, so values deserialized from a spill tier may refer to the
+ * mapped bytes (by holding a `std::shared_ptr` to the mapping) instead of
+ * copying them.
+ */
+class MappedFile final {
+  public:
+    /** Map a file
+     *
+     * @throws lsst::pex::exceptions::IoError if the file cannot be mapped.
+     */
+    static std::shared_ptr<MappedFile const> open(std::string const& filename);
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    ~MappedFile() noexcept;
+
+    /// Start of the mapped bytes; null for an empty file
+    void const* data() const noexcept { return _data; }
+
+    /// Number of mapped bytes
+    std::size_t size() const noexcept { return _size; }
+
+  private:
+    MappedFile(void* data, std::size_t size) noexcept : _data(data), _size(size) {}
+
+    void* _data;
+    std::size_t _size;
+};
+
+/** Secondary tier of a `Cache`, which receives values evicted to respect the capacity of the cache
+ *
+ * On a miss, `Cache::operator()` and `Cache::computeMany` take the value
+ * from the spill tier, if it is there, before calling the generator.
+ * Implementations must be thread-safe if they are shared between caches.
+ *
+ * The tier is a best effort: the cache discards a value that cannot be
+ * spilled (`put` throws), and regenerates one that cannot be read back
+ * (`take` throws).
+ */
+template <typename Key, typename Value>
+class SpillStore {
+  public:
+    virtual ~SpillStore() = default;
+
+    /// Store a value evicted from the cache, replacing any value with the same key
+    virtual void put(Key const& key, Value const& value) = 0;
+
+    /// Remove and return the value for a key, if it is present
+    virtual std::optional<Value> take(Key const& key) = 0;
+
+    /// Remove the value for a key, returning whether it was present
+    virtual bool erase(Key const& key) = 0;
+};
+
+namespace detail {
+
+/** Create a new, empty file with a unique name in a directory
+ *
+ * @returns the name of the file.
+ *
+ * @throws lsst::pex::exceptions::IoError if the file cannot be created.
+ */
+std::string makeUniqueFile(std::string const& directory, std::string const& prefix);
+
+}  // namespace detail
+
+/** Spill tier that stores each value in its own file in a directory
+ *
+ * Values are written by a user-supplied serializer, and read back through a
+ * memory map of their file, which is passed to the deserializer; values
+ * that can refer to the mapped bytes (e.g., `std::shared_ptr<T const>`
+ * constructed with the aliasing constructor from the mapping) are thus
+ * promoted without copying. Files are removed when their value is taken,
+ * erased, or evicted to respect the byte budget of the store (oldest spilled
+ * first), and when the store is destroyed. The index of the files is held
+ * in memory, so a store cannot be reopened by another process, but the
+ * files have unique names, so several stores (in one process or many) may
+ * share a directory.
+ *
+ * All methods are thread-safe. Values are serialized and deserialized
+ * without holding the lock.
+ */
+template <typename Key, typename Value, typename KeyHash=std::hash<Key>, typename KeyPred=std::equal_to<Key>>
+class DirectorySpillStore final : public SpillStore<Key, Value> {
+  public:
+    /// Function writing a value as bytes
+    using Serializer = std::function<void(Value const&, std::ostream&)>;
+
+    /// Function reading a value from the bytes written by the Serializer
+    using Deserializer = std::function<Value(std::shared_ptr<MappedFile const> const&)>;
+
+    /** Ctor
+     *
+     * @param directory  Existing directory in which to store the files.
+     * @param maxBytes  Maximum total size of the files; zero means the size
+     *                  is not limited.
+     * @param serializer  Function writing a value.
+     * @param deserializer  Function reading a value.
+     */
+    DirectorySpillStore(std::string directory, std::size_t maxBytes, Serializer serializer,
+                        Deserializer deserializer)
+      : _directory(std::move(directory)), _maxBytes(maxBytes), _serializer(std::move(serializer)),
+        _deserializer(std::move(deserializer)), _bytes(0) {}
+
+    DirectorySpillStore(DirectorySpillStore const&) = delete;
+    DirectorySpillStore& operator=(DirectorySpillStore const&) = delete;
+
+    ~DirectorySpillStore() override {
+        for (auto const& entry : _entries) {
+            std::remove(entry.filename.c_str());
+        }
+    }
+
+    /** Write a value to a new file
+     *
+     * A value larger than the byte budget is not stored.
+     *
+     * @throws lsst::pex::exceptions::IoError if the file cannot be written.
+     */
+    void put(Key const& key, Value const& value) override {
+        std::string const filename = detail::makeUniqueFile(_directory, "spill-");
+        std::size_t size;
+        try {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            _serializer(value, file);
+            size = static_cast<std::size_t>(file.tellp());
+            file.close();
+            if (!file) {
+                throw LSST_EXCEPT(pex::exceptions::IoError, "Cannot write spilled value to " + filename);
+            }
+        } catch (...) {
+            std::remove(filename.c_str());
+            throw;
+        }
+        if (_maxBytes > 0 && size > _maxBytes) {
+            std::remove(filename.c_str());
+            return;
+        }
+        std::list<Entry> removed;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto const found = _index.find(key);
+            if (found != _index.end()) {
+                _unlink(found->second, removed);
+            }
+            _entries.push_front(Entry{key, filename, size});
+            _index.emplace(key, _entries.begin());
+            _bytes += size;
+            while (_maxBytes > 0 && _bytes > _maxBytes) {
+                _unlink(std::prev(_entries.end()), removed);
+            }
+        }
+        for (auto const& entry : removed) {
+            std::remove(entry.filename.c_str());
+        }
+    }
+
+    /** Read the value for a key, and remove its file
+     *
+     * The file is removed even if the value cannot be read.
+     *
+     * @throws lsst::pex::exceptions::IoError if the file cannot be mapped.
+     */
+    std::optional<Value> take(Key const& key) override {
+        std::list<Entry> removed;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto const found = _index.find(key);
+            if (found == _index.end()) {
+                return std::nullopt;
+            }
+            _unlink(found->second, removed);
+        }
+        std::string const& filename = removed.front().filename;
+        std::shared_ptr<MappedFile const> mapping;
+        try {
+            mapping = MappedFile::open(filename);
+        } catch (...) {
+            std::remove(filename.c_str());
+            throw;
+        }
+        std::remove(filename.c_str());  // The mapping survives the removal
+        return _deserializer(mapping);
+    }
+
+    bool erase(Key const& key) override {
+        std::list<Entry> removed;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto const found = _index.find(key);
+            if (found == _index.end()) {
+                return false;
+            }
+            _unlink(found->second, removed);
+        }
+        std::remove(removed.front().filename.c_str());
+        return true;
+    }
+
+    /// Number of values stored
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+
+    /// Total size of the stored values, in bytes
+    std::size_t bytes() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bytes;
+    }
+
+    /// Maximum total size of the stored values, in bytes; zero means the size is not limited
+    std::size_t maxBytes() const noexcept { return _maxBytes; }
+
+  private:
+    struct Entry {
+        Key key;
+        std::string filename;
+        std::size_t size;  // Bytes in file
+    };
+    using Iterator = typename std::list<Entry>::iterator;
+
+    // Move an entry out of the index, so its file can be removed without the lock
+    void _unlink(Iterator it, std::list<Entry> & removed) {
+        _bytes -= it->size;
+        _index.erase(it->key);
+        removed.splice(removed.end(), _entries, it);
+    }
+
+    std::string const _directory;
+    std::size_t const _maxBytes;
+    Serializer const _serializer;
+    Deserializer const _deserializer;
+    mutable std::mutex _mutex;  // Protects the members below
+    std::list<Entry> _entries;  // Most recently spilled first
+    std::unordered_map<Key, Iterator, KeyHash, KeyPred> _index;  // Entry for each key
+    std::size_t _bytes;  // Total size of the files
+};
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#endif  // LSST_CPPUTILS_CACHE_SPILL_H
@@ -0,0 +1,192 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_CPPUTILS_CACHE_STATISTICS_H
+#define LSST_CPPUTILS_CACHE_STATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace lsst {
+namespace cpputils {
+
+/** Statistics of the use of a `Cache`
+ *
+ * Hits and misses count requests for values (`operator()`, `operator[]`,
+ * `get` and `contains`); adding a value with `add` is not a request.
+ */
+struct CacheStatistics {
+    std::uint64_t hits = 0;  ///< Number of requests for values that were present
+    std::uint64_t misses = 0;  ///< Number of requests for values that were absent
+    std::uint64_t insertions = 0;  ///< Number of values added
+    std::uint64_t evictions = 0;  ///< Number of values evicted to respect the capacity
+    std::uint64_t expirations = 0;  ///< Number of expired values removed
+    std::uint64_t generations = 0;  ///< Number of calls to a generator
+    std::chrono::nanoseconds generatorTime{0};  ///< Total time spent in generators
+    std::uint64_t spills = 0;  ///< Number of evicted values written to the spill tier
+    std::uint64_t spillHits = 0;  ///< Number of misses satisfied by the spill tier
+
+    /// Fraction of requests that were hits, or zero if there were no requests
+    double hitRate() const {
+        return (hits + misses > 0) ? static_cast<double>(hits)/(hits + misses) : 0.0;
+    }
+
+    /// Accumulate statistics from another source (e.g., another shard)
+    CacheStatistics & operator+=(CacheStatistics const& other) {
+        hits += other.hits;
+        misses += other.misses;
+        insertions += other.insertions;
+        evictions += other.evictions;
+        expirations += other.expirations;
+        generations += other.generations;
+        generatorTime += other.generatorTime;
+        spills += other.spills;
+        spillHits += other.spillHits;
+        return *this;
+    }
+};
+
+namespace detail {
+
+/* Counters underlying CacheStatistics
+ *
+ * The counters are relaxed atomics, so they may be read (and, in the case of
+ * the generator counters, updated) from multiple threads without a lock, at
+ * negligible cost.
+ */
+class CacheCounters {
+  public:
+    CacheCounters() = default;
+    CacheCounters(CacheCounters const& other) { *this = other; }
+    CacheCounters & operator=(CacheCounters const& other) {
+        _store(other.get());
+        return *this;
+    }
+
+    void hit() { _hits.fetch_add(1, std::memory_order_relaxed); }
+    void miss() { _misses.fetch_add(1, std::memory_order_relaxed); }
+    void insertion() { _insertions.fetch_add(1, std::memory_order_relaxed); }
+    void eviction() { _evictions.fetch_add(1, std::memory_order_relaxed); }
+    void expiration() { _expirations.fetch_add(1, std::memory_order_relaxed); }
+    void generation(std::chrono::nanoseconds duration) {
+        _generations.fetch_add(1, std::memory_order_relaxed);
+        _generatorTime.fetch_add(duration.count(), std::memory_order_relaxed);
+    }
+    void spill() { _spills.fetch_add(1, std::memory_order_relaxed); }
+    void spillHit() { _spillHits.fetch_add(1, std::memory_order_relaxed); }
+
+    CacheStatistics get() const {
+        CacheStatistics stats;
+        stats.hits = _hits.load(std::memory_order_relaxed);
+        stats.misses = _misses.load(std::memory_order_relaxed);
+        stats.insertions = _insertions.load(std::memory_order_relaxed);
+        stats.evictions = _evictions.load(std::memory_order_relaxed);
+        stats.expirations = _expirations.load(std::memory_order_relaxed);
+        stats.generations = _generations.load(std::memory_order_relaxed);
+        stats.generatorTime = std::chrono::nanoseconds(_generatorTime.load(std::memory_order_relaxed));
+        stats.spills = _spills.load(std::memory_order_relaxed);
+        stats.spillHits = _spillHits.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void reset() { _store(CacheStatistics()); }
+
+  private:
+    void _store(CacheStatistics const& stats) {
+        _hits.store(stats.hits, std::memory_order_relaxed);
+        _misses.store(stats.misses, std::memory_order_relaxed);
+        _insertions.store(stats.insertions, std::memory_order_relaxed);
+        _evictions.store(stats.evictions, std::memory_order_relaxed);
+        _expirations.store(stats.expirations, std::memory_order_relaxed);
+        _generations.store(stats.generations, std::memory_order_relaxed);
+        _generatorTime.store(stats.generatorTime.count(), std::memory_order_relaxed);
+        _spills.store(stats.spills, std::memory_order_relaxed);
+        _spillHits.store(stats.spillHits, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint64_t> _hits{0};
+    std::atomic<std::uint64_t> _misses{0};
+    std::atomic<std::uint64_t> _insertions{0};
+    std::atomic<std::uint64_t> _evictions{0};
+    std::atomic<std::uint64_t> _expirations{0};
+    std::atomic<std::uint64_t> _generations{0};
+    std::atomic<std::chrono::nanoseconds::rep> _generatorTime{0};
+    std::atomic<std::uint64_t> _spills{0};
+    std::atomic<std::uint64_t> _spillHits{0};
+};
+
+/* Fixed-size ring buffer of sampled keys
+ *
+ * Every `interval`-th key offered is recorded; once full, the oldest sample
+ * is overwritten. Not thread-safe: the owner must serialize access.
+ */
+template <typename Key>
+class KeySampler {
+  public:
+    /// Start sampling; a capacity of zero disables sampling
+    void enable(std::size_t capacity, std::size_t interval) {
+        _samples.clear();
+        _samples.reserve(capacity);
+        _capacity = capacity;
+        _interval = interval > 0 ? interval : 1;
+        _count = 0;
+        _next = 0;
+    }
+
+    bool isEnabled() const { return _capacity > 0; }
+
+    void offer(Key const& key) {
+        if (_capacity == 0 || (_count++ % _interval) != 0) return;
+        if (_samples.size() < _capacity) {
+            _samples.push_back(key);
+        } else {
+            _samples[_next] = key;
+        }
+        _next = (_next + 1) % _capacity;
+    }
+
+    /// Return the samples, oldest first
+    std::vector<Key> get() const {
+        if (_samples.size() < _capacity) {
+            return _samples;
+        }
+        std::vector<Key> result;
+        result.reserve(_samples.size());
+        result.insert(result.end(), _samples.begin() + _next, _samples.end());
+        result.insert(result.end(), _samples.begin(), _samples.begin() + _next);
+        return result;
+    }
+
+  private:
+    std::vector<Key> _samples;  // Sampled keys
+    std::size_t _capacity = 0;  // Maximum number of samples; 0 means disabled
+    std::size_t _interval = 1;  // Sample every this many keys
+    std::size_t _count = 0;  // Number of keys offered
+    std::size_t _next = 0;  // Index of next sample to overwrite
+};
+
+}  // namespace detail
+
+}
+} // namespace lsst::cpputils
+
+#endif // ifndef LSST_CPPUTILS_CACHE_STATISTICS_H
@@ -0,0 +1,211 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_CACHETRACE_H
+#define LSST_CPPUTILS_CACHETRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsst {
+namespace cpputils {
+
+/**
+ * Sequence of requests made of a `Cache`, for offline capacity planning.
+ *
+ * Keys are replaced by dense integer identifiers, assigned in order of first
+ * request, so a trace is independent of the type of the key and costs four
+ * bytes per request in memory.
+ *
+ * Traces may be read from the text files written by a `Cache` compiled with
+ * `LSST_CACHE_DEBUG` (`lsst-cache-<type>-<id>.dat`, with one key per line, as
+ * written by `operator<<`), and read from or written to a compact binary
+ * format: the magic string "LSSTCTR1", the number of distinct keys and the
+ * number of requests, followed by the identifier of each request, all as
+ * unsigned LEB128 varints. As identifiers are assigned in order of first
+ * request, the most popular keys usually occupy a single byte.
+ *
+ * @see CacheTraceRecorder, StackDistances, simulateHitRates
+ */
+class CacheTrace final {
+public:
+    /// Identifier of a key
+    using KeyId = std::uint32_t;
+
+    /// Magic string at the start of a binary trace
+    static constexpr char const* MAGIC = "LSSTCTR1";
+
+    /// Construct an empty trace
+    CacheTrace() = default;
+
+    /**
+     * Construct from a sequence of identifiers.
+     *
+     * @param requests  Identifier of the key of each request.
+     * @param numKeys  Number of distinct keys; all identifiers must be less.
+     *
+     * @throws lsst::pex::exceptions::InvalidParameterError if an identifier
+     *         is not less than `numKeys`.
+     */
+    CacheTrace(std::vector<KeyId> requests, std::size_t numKeys);
+
+    /// Read a trace from a file, in either the text or the binary format
+    static CacheTrace read(std::string const& filename);
+
+    /**
+     * Read a trace in the text format, with one key per line.
+     *
+     * @throws lsst::pex::exceptions::IoError if the file cannot be read.
+     */
+    static CacheTrace readText(std::string const& filename);
+    static CacheTrace readText(std::istream& input);
+
+    /**
+     * Read a trace in the binary format.
+     *
+     * @throws lsst::pex::exceptions::IoError if the file cannot be read, or
+     *         is not a valid trace.
+     */
+    static CacheTrace readBinary(std::string const& filename);
+    static CacheTrace readBinary(std::istream& input);
+
+    /**
+     * Write the trace in the binary format.
+     *
+     * @throws lsst::pex::exceptions::IoError if the file cannot be written.
+     */
+    void writeBinary(std::string const& filename) const;
+    void writeBinary(std::ostream& output) const;
+
+    /// Append a request for a key that may not have been requested before
+    void append(KeyId key);
+
+    /// Identifier of the key of each request, in order
+    std::vector<KeyId> const& getRequests() const noexcept { return _requests; }
+
+    /// Number of requests
+    std::size_t size() const noexcept { return _requests.size(); }
+
+    /// Number of distinct keys
+    std::size_t getNumKeys() const noexcept { return _numKeys; }
+
+private:
+    std::vector<KeyId> _requests;  // Identifier of each request
+    std::size_t _numKeys = 0;  // Number of distinct keys
+};
+
+/**
+ * Build a CacheTrace from keys as they are requested.
+ *
+ * Keep one of these next to a cache to record its requests, e.g. when the
+ * text dump written with `LSST_CACHE_DEBUG` would be too large.
+ */
+template <typename Key, typename KeyHash=std::hash<Key>, typename KeyPred=std::equal_to<Key>>
+class CacheTraceRecorder final {
+public:
+    /// Record a request for a key
+    void record(Key const& key) {
+        auto const result = _ids.emplace(key, static_cast<CacheTrace::KeyId>(_ids.size()));
+        _trace.append(result.first->second);
+    }
+
+    /// Trace of the requests recorded so far
+    CacheTrace const& getTrace() const noexcept { return _trace; }
+
+private:
+    std::unordered_map<Key, CacheTrace::KeyId, KeyHash, KeyPred> _ids;  // Identifier of each key
+    CacheTrace _trace;
+};
+
+/**
+ * LRU stack distances of the requests in a trace (Mattson et al. 1970).
+ *
+ * The stack distance of a request is the number of distinct keys requested
+ * since the previous request for the same key. A request is a hit in an LRU
+ * cache of capacity `n` if and only if its stack distance is less than `n`,
+ * so a single pass over the trace gives the hit rate of `Cache` with
+ * `LruPolicy` at every capacity. The distances are counted with a Fenwick
+ * tree over the time of the latest request for each key, which takes
+ * O(log N) time per request.
+ *
+ * Requests for keys that were not requested before are compulsory misses at
+ * every capacity.
+ */
+class StackDistances final {
+public:
+    /// Compute the stack distances of the requests in a trace
+    explicit StackDistances(CacheTrace const& trace);
+
+    /// Number of requests
+    std::size_t getNumRequests() const noexcept { return _numRequests; }
+
+    /// Number of requests for keys that were not requested before
+    std::size_t getNumCompulsoryMisses() const noexcept { return _numCompulsory; }
+
+    /// Number of requests with each stack distance
+    std::vector<std::uint64_t> const& getHistogram() const noexcept { return _histogram; }
+
+    /// Hit rate of an LRU cache with the given capacity, or zero if there were no requests
+    double getHitRate(std::size_t capacity) const;
+
+    /// Hit rate of an LRU cache with each of the given capacities
+    std::vector<double> getHitRates(std::vector<std::size_t> const& capacities) const;
+
+private:
+    std::size_t _numRequests;
+    std::size_t _numCompulsory;
+    std::vector<std::uint64_t> _histogram;  // Number of requests with each stack distance
+    std::vector<std::uint64_t> _cumulative;  // Number of requests with at most each stack distance
+};
+
+/// Eviction policies that may be simulated by `simulateHitRates`
+enum class CacheTracePolicy { LRU, SLRU, TINY_LFU };
+
+/**
+ * Hit rates of `Cache` with the given policy at each of the given capacities.
+ *
+ * Policies other than LRU are not stack algorithms (a larger cache need not
+ * hold a superset of the keys of a smaller one), so a cache of each capacity
+ * is simulated, with the default parameters of the policy. The simulated
+ * caches are all fed in the same pass over the trace. For LRU, prefer
+ * `StackDistances`, which gives identical results faster.
+ *
+ * @param trace  Requests to replay.
+ * @param capacities  Maximum number of elements of each simulated cache.
+ * @param policy  Eviction policy of the simulated caches.
+ * @returns Hit rate at each capacity.
+ *
+ * @throws lsst::pex::exceptions::InvalidParameterError if a capacity is zero.
+ */
+std::vector<double> simulateHitRates(CacheTrace const& trace, std::vector<std::size_t> const& capacities,
+                                     CacheTracePolicy policy);
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#endif  // LSST_CPPUTILS_CACHETRACE_H
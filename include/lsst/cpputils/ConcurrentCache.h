@@ -0,0 +1,1168 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_CPPUTILS_CONCURRENT_CACHE_H
+#define LSST_CPPUTILS_CONCURRENT_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/cpputils/Cache.h"
+#include "lsst/cpputils/CacheFwd.h"
+#include "lsst/cpputils/CacheStatistics.h"
+#include "lsst/cpputils/Instrumentation.h"
+
+namespace lsst {
+namespace cpputils {
+
+/** Thread-safe cache of most recently used values
+ *
+ * This presents the same interface as `Cache`, but may be shared between
+ * threads. The key space is split into a number of shards (selected by
+ * `KeyHash`), each of which is an independent `Cache` protected by its own
+ * mutex, so that threads looking up different keys rarely contend for the
+ * same lock.
+ *
+ * The capacity is divided between the shards, so the least recently used
+ * value is evicted on a per-shard rather than a global basis. With a single
+ * shard, the behaviour is identical to that of `Cache`. Each shard applies
+ * the eviction `Policy` independently.
+ *
+ * The `Generator` function passed to `operator()` is called without any
+ * lock held, so it may safely use the cache itself.
+ *
+ * In single-flight mode, threads that miss on the same key concurrently
+ * share a single call to the `Generator`: the first thread to miss stores a
+ * placeholder for the pending value, and subsequent threads wait on it
+ * rather than generating the value again.
+ *
+ * Values that will be needed soon may be generated in the background with
+ * `prefetch`. A request through `operator()` for a key that is being
+ * prefetched waits for the prefetched value, in either mode.
+ *
+ * Values may be given a time to live, as for `Cache`. In refresh-ahead mode
+ * (see `setTimeToLive`), a request through `operator()` for a value that is
+ * about to expire returns the cached value but also regenerates it in the
+ * background, so that popular values are replaced before they expire rather
+ * than all missing at once.
+ *
+ * @note Python bindings (for pybind11) are available in
+ * `lsst/cpputils/python/Cache.h`.
+ */
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+class ConcurrentCache {
+  public:
+    /// Function returning the weight of a cached value
+    typedef typename Cache<Key, Value, KeyHash, KeyPred, Policy>::Weigher Weigher;
+
+    /// Time interval, e.g., for the time to live of cached values
+    typedef typename Cache<Key, Value, KeyHash, KeyPred, Policy>::Duration Duration;
+
+    /// Default number of shards
+    static constexpr std::size_t DEFAULT_NUM_SHARDS = 64;
+
+    /** Ctor
+     *
+     * The maximum number of elements may be zero (default), in which
+     * case the cache is permitted to grow without limit.
+     *
+     * @param maxElements  Maximum number of elements in the cache.
+     * @param numShards  Number of independently locked shards. Zero selects
+     *                   `DEFAULT_NUM_SHARDS`. The number of shards never
+     *                   exceeds a non-zero `maxElements`.
+     * @param singleFlight  Should concurrent misses on the same key wait for
+     *                      a single call to the generator?
+     * @param policy  Eviction policy, of which each shard gets a copy.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    explicit ConcurrentCache(std::size_t maxElements=0, std::size_t numShards=0,
+                             bool singleFlight=false, Policy const& policy=Policy())
+      : ConcurrentCache(maxElements, Weigher(), 0, numShards, singleFlight, policy) {}
+
+    /** Ctor with cost-aware eviction
+     *
+     * The maximum weight is divided between the shards in the same way as
+     * the maximum number of elements.
+     *
+     * @param maxElements  Maximum number of elements in the cache.
+     * @param weigher  Function returning the weight of a value; see `Cache`.
+     *                 It may be called concurrently from multiple threads.
+     * @param maxWeight  Maximum total weight of the cached values.
+     * @param numShards  Number of independently locked shards (see above).
+     * @param singleFlight  Should concurrent misses on the same key wait for
+     *                      a single call to the generator?
+     * @param policy  Eviction policy, of which each shard gets a copy.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    ConcurrentCache(std::size_t maxElements, Weigher weigher, std::size_t maxWeight,
+                    std::size_t numShards=0, bool singleFlight=false, Policy const& policy=Policy());
+
+    // Shards hold mutexes, so neither copyable nor movable
+    ConcurrentCache(ConcurrentCache const &) = delete;
+    ConcurrentCache(ConcurrentCache &&) = delete;
+    ConcurrentCache & operator=(ConcurrentCache const &) = delete;
+    ConcurrentCache & operator=(ConcurrentCache &&) = delete;
+
+    /// Dtor
+    ///
+    /// Waits for any prefetches and background refreshes to complete.
+    ~ConcurrentCache();
+
+    /** Lookup or generate a value
+     *
+     * If the key is in the cache, the corresponding value is returned.
+     * Otherwise, a value is generated by the provided function which is
+     * cached and returned.
+     *
+     * The `Generator` function signature should be:
+     *
+     *     Value func(Key const& key);
+     *
+     * The generator is called without holding any lock. In single-flight
+     * mode, a thread that misses on a key for which a value is already being
+     * generated waits for that value instead of calling its own generator;
+     * if the generator throws, the exception is rethrown in every waiting
+     * thread and nothing is cached. A generator must therefore not request
+     * its own key from the cache in single-flight mode.
+     *
+     * In refresh-ahead mode, the generator may also be called from a
+     * background thread to refresh a value that is about to expire, so it
+     * must be copyable and safe to call from another thread. If a background
+     * refresh throws, the exception is discarded and the existing value
+     * continues to be served until it expires.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Generator>
+    Value operator()(Key const& key, Generator func);
+
+    /** Lookup a value
+     *
+     * @throws lsst::pex::exceptions::NotFoundError  If key is not in the
+     * cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    Value operator[](Key const& key);
+
+    /** Add a value to the cache
+     *
+     * If the key is already in the cache, the existing value will be
+     * promoted to the most recently used value.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void add(Key const& key, Value const& value);
+
+    /** Add a value to the cache, moving it into place
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void add(Key const& key, Value && value);
+
+    /** Add a value to the cache, constructed from the provided arguments
+     *
+     * The value is only constructed if the key is not already in the cache.
+     * It is constructed with the shard lock held.
+     *
+     * @returns Whether a new value was constructed.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename... Args>
+    bool emplace(Key const& key, Args &&... args) {
+        LockedShard & shard = _getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.emplace(key, std::forward<Args>(args)...);
+    }
+
+    /** Return the number of values in the cache
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::size_t size() const;
+
+    /** Return all keys in the cache
+     *
+     * Keys are grouped by shard, and are most recent first within each
+     * shard.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::vector<Key> keys() const;
+
+    /** Does the cache contain the key?
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    bool contains(Key const& key);
+
+    /** Return the cached value if it exists.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    std::optional<Value> get(Key const& key);
+
+    /** Return the cached values for multiple keys
+     *
+     * Each shard is locked only once for all of its keys.
+     *
+     * @returns The cached value for each key, or an empty optional for keys
+     * that are not in the cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    std::vector<std::optional<Value>> getMany(std::vector<Key> const& keys);
+
+    /** Add multiple values to the cache
+     *
+     * Each shard is locked only once for all of its keys.
+     *
+     * @throws lsst::pex::exceptions::LengthError  If the numbers of keys and
+     * values differ.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void addMany(std::vector<Key> const& keys, std::vector<Value> const& values);
+
+    /** Lookup or generate multiple values
+     *
+     * The values of keys that are not in the cache are generated by a single
+     * call to the provided function; see `Cache::computeMany`. The generator
+     * is called without holding any lock. It does not take part in
+     * single-flight generation: keys being generated by `operator()` in
+     * another thread may be generated again.
+     *
+     * @throws lsst::pex::exceptions::LengthError  If the generator does not
+     * return one value for each missing key.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Generator>
+    std::vector<Value> computeMany(std::vector<Key> const& keys, Generator func);
+
+    /** Generate values for multiple keys in the background
+     *
+     * For each key that is neither in the cache nor already being generated,
+     * a task that generates the value and adds it to the cache is passed to
+     * the `executor`, whose signature should be:
+     *
+     *     void executor(std::function<void()> task);
+     *
+     * e.g., a lambda that submits the task to a thread pool. Until its value
+     * is added, the key is pending: `operator()` on the key waits for the
+     * prefetched value instead of generating it again, and rethrows the
+     * exception if the generator throws (the exception is otherwise
+     * discarded). Other lookups (`get`, `contains`, etc.) do not wait.
+     *
+     * The generator signature is as for `operator()`; it must be copyable,
+     * and is called on the executor's threads without any lock held. Checking
+     * whether the keys are in the cache does not count as a request.
+     *
+     * The executor must eventually run every task it accepts, because the
+     * destructor waits for all prefetches to complete. If the executor
+     * throws, the keys not yet submitted are not generated (requests waiting
+     * on them receive the exception), and the exception is rethrown.
+     *
+     * @returns The number of keys for which generation was scheduled.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Generator, typename Executor>
+    std::size_t prefetch(std::vector<Key> const& keys, Generator func, Executor executor);
+
+    /** Generate values for multiple keys in a single background thread
+     *
+     * This is `prefetch` without an executor: the missing keys are generated
+     * one after another by a single task, run with `std::async` like the
+     * background refreshes. Pass an executor (such as a `ThreadPool`) to
+     * generate them in parallel.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Generator>
+    std::size_t prefetch(std::vector<Key> const& keys, Generator func);
+
+    /** Return the number of prefetches that are scheduled or running
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::size_t numPrefetching() const {
+        std::lock_guard<std::mutex> lock(_prefetchMutex);
+        return _numPrefetching;
+    }
+
+    /** Add a value to the cache, with its own time to live
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void add(Key const& key, Value const& value, Duration timeToLive);
+
+    /** Remove a value from the cache
+     *
+     * @returns Whether the key was in the cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    bool erase(Key const& key);
+
+    /** Return the default time to live of cached values
+     *
+     * Zero means values do not expire.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    Duration timeToLive() const noexcept { return Duration(_timeToLive.load(std::memory_order_relaxed)); }
+
+    /** Return the refresh-ahead interval
+     *
+     * Zero means values are not refreshed in the background.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    Duration refreshAhead() const noexcept { return Duration(_refreshAhead.load(std::memory_order_relaxed)); }
+
+    /** Change the default time to live of cached values
+     *
+     * This applies to values added subsequently; values already cached keep
+     * their expiry.
+     *
+     * @param timeToLive  Time after which values expire; zero means values
+     *                    do not expire.
+     * @param refreshAhead  Values requested through `operator()` within this
+     *                      interval of expiring are regenerated in the
+     *                      background. Zero disables refresh-ahead.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void setTimeToLive(Duration timeToLive, Duration refreshAhead=Duration::zero());
+
+    /** Return the time remaining before a cached value expires
+     *
+     * @returns The time remaining, or an empty optional if the key is not in
+     * the cache or its value does not expire; see `Cache::timeRemaining`.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::optional<Duration> timeRemaining(Key const& key) const {
+        LockedShard & shard = _getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.timeRemaining(key);
+    }
+
+    /** Apply a function to a cached value, if it exists
+     *
+     * This provides access to the cached value without copying it. The
+     * `Visitor` function signature should be:
+     *
+     *     void func(Value const& value);
+     *
+     * The `Visitor` is called with the shard lock held, so it should be
+     * brief, and must not use the cache itself.
+     *
+     * @returns Whether the key was in the cache.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    template <typename Visitor>
+    bool visit(Key const& key, Visitor func) {
+        LockedShard & shard = _getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.visit(key, func);
+    }
+
+    /** Return the capacity of the cache
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::size_t capacity() const { return _maxElements; }
+
+    /** Change the capacity of the cache
+     *
+     * The number of shards is fixed at construction, so reducing the
+     * capacity below the number of shards leaves one element per shard.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void reserve(std::size_t maxElements);
+
+    /** Return the total weight of the values in the cache
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::size_t weight() const;
+
+    /** Return the maximum total weight of the cache
+     *
+     * Zero means the total weight is not limited.
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::size_t maxWeight() const { return _maxWeight; }
+
+    /** Change the maximum total weight of the cache
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void reserveWeight(std::size_t maxWeight);
+
+    /** Empty the cache
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void flush();
+
+    /** Return the number of shards
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    std::size_t numShards() const noexcept { return _numShards; }
+
+    /** Are concurrent misses on the same key served by a single generation?
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    bool isSingleFlight() const noexcept { return _singleFlight; }
+
+    /** Return statistics of the use of the cache, summed over all shards
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    CacheStatistics stats() const;
+
+    /** Reset the statistics of the use of the cache
+     *
+     * @exceptsafe No exceptions can be thrown.
+     */
+    void resetStats();
+
+    /** Start recording a sample of the requested keys
+     *
+     * The sample capacity is divided between the shards.
+     *
+     * @param capacity  Maximum number of samples to retain; zero disables
+     *                  sampling.
+     * @param interval  Record every `interval`-th key requested from each
+     *                  shard.
+     *
+     * @exceptsafe Basic exception safety: exceptions will leave the
+     * system in a valid but unpredictable state.
+     */
+    void enableSampling(std::size_t capacity, std::size_t interval=1);
+
+    /** Return the sampled keys
+     *
+     * Keys are grouped by shard, and are oldest first within each shard.
+     *
+     * @exceptsafe Strong exception safety: exceptions will return the
+     * system to previous state.
+     */
+    std::vector<Key> sampledKeys() const;
+
+  private:
+
+    typedef Cache<Key, Value, KeyHash, KeyPred, Policy> Shard;
+
+    // Placeholders for values being generated
+    typedef std::unordered_map<Key, std::shared_future<Value>, KeyHash, KeyPred> Pending;
+
+    // A shard and its lock, padded to a cache line to avoid false sharing
+    struct alignas(64) LockedShard {
+        std::mutex mutex;
+        Shard cache;
+        Pending pending;  // Values being generated, in single-flight mode, or prefetched
+        std::unordered_set<Key, KeyHash, KeyPred> refreshing;  // Values being refreshed in the background
+    };
+
+    // Should a value be refreshed in the background, because it is about to expire?
+    //
+    // If so, the value is marked as being refreshed, and _startRefresh must be called.
+    // Must be called with the shard lock held.
+    bool _claimRefresh(LockedShard & shard, Key const& key);
+
+    // Refresh a value claimed by _claimRefresh in the background
+    //
+    // Must be called without the shard lock: copying and destroying the generator may need other locks
+    // (e.g., the GIL, for a Python callable).
+    template <typename Generator>
+    void _startRefresh(LockedShard & shard, Key const& key, Generator const& func);
+
+    // Generate a value, recording the time taken
+    template <typename Generator>
+    Value _generate(Key const& key, Generator & func) {
+        auto const start = std::chrono::steady_clock::now();
+        Value value = func(key);
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        _counters.generation(elapsed);
+        LSST_COUNTER_ADD("cpputils.ConcurrentCache.generate", 1, elapsed);
+        return value;
+    }
+
+    // Run a task on a new thread, which the destructor waits for
+    //
+    // Must not be called with _refreshMutex or a shard lock held.
+    void _runInBackground(std::function<void()> task) {
+        std::vector<std::future<void>> finished;  // Destroyed (with their tasks) after unlocking
+        std::lock_guard<std::mutex> lock(_refreshMutex);
+        auto const running = std::partition(_refreshes.begin(), _refreshes.end(),
+                                            [](std::future<void> const& ff) {
+                                                return ff.wait_for(std::chrono::seconds(0)) ==
+                                                    std::future_status::ready;
+                                            });
+        std::move(_refreshes.begin(), running, std::back_inserter(finished));
+        _refreshes.erase(_refreshes.begin(), running);
+        _refreshes.push_back(std::async(std::launch::async, std::move(task)));
+    }
+
+    // Keys whose prefetch has been scheduled, with the promises of their values
+    using PrefetchList = std::vector<std::pair<Key, std::shared_ptr<std::promise<Value>>>>;
+
+    // Make the keys that are neither cached nor pending pending, and return them
+    PrefetchList _startPrefetch(std::vector<Key> const& keys);
+
+    // Generate and add the value of a prefetched key, and record the end of its prefetch
+    //
+    // Must not be called with a shard lock held.
+    template <typename Generator>
+    void _prefetchOne(Key const& key, std::promise<Value> & promise, Generator & func);
+
+    // Release prefetched keys that will not be generated, passing them the current exception
+    //
+    // Must be called from a catch block, without a shard lock held.
+    void _abandonPrefetch(PrefetchList const& scheduled, std::size_t begin);
+
+    // Record the end of some prefetches
+    void _finishPrefetch(std::size_t num = 1) {
+        std::lock_guard<std::mutex> lock(_prefetchMutex);
+        _numPrefetching -= num;
+        _prefetchDone.notify_all();
+    }
+
+    // Generate a value in single-flight mode, for a key that is not pending
+    //
+    // Must be called with the shard lock held (by `lock`), which is released.
+    template <typename Generator>
+    Value _generateOnce(LockedShard & shard, std::unique_lock<std::mutex> & lock,
+                        Key const& key, Generator & func);
+
+    // Share of a limit for an individual shard, distributing the remainder over the first shards
+    //
+    // A limit of zero (no limit) is preserved.
+    std::size_t _shardShare(std::size_t limit, std::size_t index) const {
+        if (limit == 0) return 0;
+        std::size_t const share = limit/_numShards + (index < limit % _numShards ? 1 : 0);
+        return std::max(share, std::size_t(1));
+    }
+
+    // Select the index of the shard responsible for a key
+    //
+    // The hash is mixed before use because many std::hash specializations
+    // are the identity function.
+    std::size_t _getShardIndex(Key const& key) const {
+        std::uint64_t hash = _hasher(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash % _numShards;
+    }
+
+    // Select the shard responsible for a key
+    LockedShard & _getShard(Key const& key) const { return _shards[_getShardIndex(key)]; }
+
+    // Call a function for each key, with the key's shard locked
+    //
+    // Keys are grouped by shard, so each shard is locked only once. The
+    // function is called with the shard and the index of the key.
+    template <typename Function>
+    void _forEachByShard(std::vector<Key> const& keys, Function func);
+
+    std::size_t _maxElements;  // Maximum number of elements; 0 means infinite
+    std::size_t _maxWeight;  // Maximum total weight; 0 means infinite
+    std::size_t _numShards;  // Number of shards
+    bool _singleFlight;  // Share generation between concurrent misses?
+    detail::CacheCounters _counters;  // Statistics of generation, which happens outside the shards
+    std::atomic<typename Duration::rep> _timeToLive{0};  // Default time to live; 0 means infinite
+    std::atomic<typename Duration::rep> _refreshAhead{0};  // Refresh-ahead interval; 0 means disabled
+    KeyHash _hasher;  // Hash function for selecting shards
+    std::unique_ptr<LockedShard[]> _shards;  // Independently locked shards
+    std::mutex _refreshMutex;  // Protects _refreshes; never held while acquiring a shard lock
+    std::vector<std::future<void>> _refreshes;  // Background refreshes, and prefetches run by std::async
+    mutable std::mutex _prefetchMutex;  // Protects _numPrefetching
+    std::condition_variable _prefetchDone;  // Notified when a prefetch completes
+    std::size_t _numPrefetching = 0;  // Number of prefetches scheduled or running
+};
+
+// Definitions
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::ConcurrentCache(
+    std::size_t maxElements,
+    Weigher weigher,
+    std::size_t maxWeight,
+    std::size_t numShards,
+    bool singleFlight,
+    Policy const& policy
+) : _maxElements(maxElements),
+    _maxWeight(maxWeight),
+    _numShards(numShards == 0 ? DEFAULT_NUM_SHARDS : numShards),
+    _singleFlight(singleFlight),
+    _hasher()
+{
+    if (_maxElements > 0 && _numShards > _maxElements) {
+        _numShards = _maxElements;
+    }
+    _shards.reset(new LockedShard[_numShards]);
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        _shards[ii].cache = Shard(_shardShare(_maxElements, ii), weigher, _shardShare(_maxWeight, ii),
+                                  policy);
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::~ConcurrentCache() {
+    {
+        std::unique_lock<std::mutex> lock(_prefetchMutex);
+        _prefetchDone.wait(lock, [this] { return _numPrefetching == 0; });
+    }
+    std::lock_guard<std::mutex> lock(_refreshMutex);
+    for (auto & refresh : _refreshes) {
+        refresh.wait();
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator>
+Value ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::operator()(
+    Key const& key,
+    Generator func
+) {
+    LockedShard & shard = _getShard(key);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto result = shard.cache.get(key);
+    if (result) {
+        if (_claimRefresh(shard, key)) {
+            lock.unlock();
+            _startRefresh(shard, key, func);
+        }
+        return *std::move(result);
+    }
+    auto const pending = shard.pending.find(key);
+    if (pending != shard.pending.end()) {
+        // Someone else is generating this value: wait for them
+        std::shared_future<Value> future = pending->second;
+        lock.unlock();
+        return future.get();
+    }
+    if (_singleFlight) {
+        return _generateOnce(shard, lock, key, func);
+    }
+    lock.unlock();
+    Value value = _generate(key, func);
+    lock.lock();
+    shard.cache.add(key, value);
+    return value;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator>
+Value ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_generateOnce(
+    LockedShard & shard,
+    std::unique_lock<std::mutex> & lock,
+    Key const& key,
+    Generator & func
+) {
+    std::promise<Value> promise;
+    shard.pending.emplace(key, promise.get_future().share());
+    lock.unlock();
+    try {
+        Value value = _generate(key, func);
+        lock.lock();
+        shard.pending.erase(key);
+        shard.cache.add(key, value);
+        lock.unlock();
+        promise.set_value(value);
+        return value;
+    } catch (...) {
+        if (!lock.owns_lock()) {
+            lock.lock();
+        }
+        shard.pending.erase(key);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+bool ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_claimRefresh(
+    LockedShard & shard,
+    Key const& key
+) {
+    Duration const refreshAhead = this->refreshAhead();
+    if (refreshAhead <= Duration::zero()) {
+        return false;
+    }
+    auto const remaining = shard.cache.timeRemaining(key);
+    return remaining && *remaining <= refreshAhead && shard.refreshing.insert(key).second;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_startRefresh(
+    LockedShard & shard,
+    Key const& key,
+    Generator const& func
+) {
+    // The generator is released by the background thread, before it takes the shard lock
+    auto refresh = [this, &shard, key, generator=std::optional<Generator>(func)]() mutable {
+        std::optional<Value> value;
+        try {
+            value = _generate(key, *generator);
+        } catch (...) {
+            // Keep serving the existing value until it expires
+        }
+        generator.reset();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.refreshing.erase(key);
+        if (value && shard.cache.erase(key)) {  // Don't resurrect a value removed in the meantime
+            shard.cache.add(key, *std::move(value));
+        }
+    };
+    try {
+        _runInBackground(std::move(refresh));
+    } catch (...) {
+        // Unable to start a thread: the value will be regenerated when it expires
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.refreshing.erase(key);
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+Value ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::operator[](Key const& key) {
+    auto result = get(key);
+    if (result) {
+        return *std::move(result);
+    }
+    throw LSST_EXCEPT(pex::exceptions::NotFoundError,
+                      (boost::format("Unable to find key: %s") % key).str());
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::add(Key const& key, Value const& value) {
+    LockedShard & shard = _getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.add(key, value);
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Function>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_forEachByShard(
+    std::vector<Key> const& keys,
+    Function func
+) {
+    std::vector<std::pair<std::size_t, std::size_t>> order;  // shard index, key index
+    order.reserve(keys.size());
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        order.emplace_back(_getShardIndex(keys[ii]), ii);
+    }
+    std::sort(order.begin(), order.end());  // Preserves order of keys within each shard
+    for (auto begin = order.begin(); begin != order.end(); ) {
+        LockedShard & shard = _shards[begin->first];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto end = begin;
+        for (; end != order.end() && end->first == begin->first; ++end) {
+            func(shard, end->second);
+        }
+        begin = end;
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+std::vector<std::optional<Value>> ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::getMany(
+    std::vector<Key> const& keys
+) {
+    std::vector<std::optional<Value>> result(keys.size());
+    _forEachByShard(keys, [&keys, &result](LockedShard & shard, std::size_t index) {
+        result[index] = shard.cache.get(keys[index]);
+    });
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::addMany(
+    std::vector<Key> const& keys,
+    std::vector<Value> const& values
+) {
+    if (keys.size() != values.size()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Number of keys (%d) and values (%d) differ") %
+                           keys.size() % values.size()).str());
+    }
+    _forEachByShard(keys, [&keys, &values](LockedShard & shard, std::size_t index) {
+        shard.cache.add(keys[index], values[index]);
+    });
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator>
+std::vector<Value> ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::computeMany(
+    std::vector<Key> const& keys,
+    Generator func
+) {
+    std::vector<std::optional<Value>> found = getMany(keys);
+    std::vector<Key> missing;
+    std::unordered_map<Key, std::size_t, KeyHash, KeyPred> missingIndex;  // Index of key in missing
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        if (!found[ii] && missingIndex.emplace(keys[ii], missing.size()).second) {
+            missing.push_back(keys[ii]);
+        }
+    }
+    std::vector<Value> generated;
+    if (!missing.empty()) {
+        auto const start = std::chrono::steady_clock::now();
+        generated = func(missing);
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        _counters.generation(elapsed);
+        LSST_COUNTER_ADD("cpputils.ConcurrentCache.generate", missing.size(), elapsed);
+        addMany(missing, generated);
+    }
+
+    std::vector<Value> result;
+    result.reserve(keys.size());
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        if (found[ii]) {
+            result.push_back(*std::move(found[ii]));
+        } else {
+            result.push_back(generated[missingIndex.find(keys[ii])->second]);
+        }
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+typename ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::PrefetchList
+ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_startPrefetch(std::vector<Key> const& keys) {
+    PrefetchList scheduled;
+    _forEachByShard(keys, [&keys, &scheduled](LockedShard & shard, std::size_t index) {
+        Key const& key = keys[index];
+        if (shard.cache.peek(key) || shard.pending.count(key) > 0) {
+            return;
+        }
+        auto promise = std::make_shared<std::promise<Value>>();
+        shard.pending.emplace(key, promise->get_future().share());
+        scheduled.emplace_back(key, std::move(promise));
+    });
+    return scheduled;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_prefetchOne(
+    Key const& key,
+    std::promise<Value> & promise,
+    Generator & func
+) {
+    LockedShard & shard = _getShard(key);
+    try {
+        Value value = _generate(key, func);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.pending.erase(key);
+            shard.cache.add(key, value);
+        }
+        promise.set_value(std::move(value));
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.pending.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+    }
+    _finishPrefetch();
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::_abandonPrefetch(
+    PrefetchList const& scheduled,
+    std::size_t begin
+) {
+    for (std::size_t ii = begin; ii < scheduled.size(); ++ii) {
+        LockedShard & shard = _getShard(scheduled[ii].first);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.pending.erase(scheduled[ii].first);
+        }
+        scheduled[ii].second->set_exception(std::current_exception());
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator, typename Executor>
+std::size_t ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::prefetch(
+    std::vector<Key> const& keys,
+    Generator func,
+    Executor executor
+) {
+    PrefetchList const scheduled = _startPrefetch(keys);
+    for (std::size_t ii = 0; ii < scheduled.size(); ++ii) {
+        Key const& key = scheduled[ii].first;
+        auto promise = scheduled[ii].second;
+        std::function<void()> task = [this, key, promise, func]() mutable {
+            _prefetchOne(key, *promise, func);
+        };
+        {
+            std::lock_guard<std::mutex> lock(_prefetchMutex);
+            ++_numPrefetching;
+        }
+        try {
+            executor(std::move(task));
+        } catch (...) {
+            _abandonPrefetch(scheduled, ii);  // Including this key
+            _finishPrefetch();
+            throw;
+        }
+    }
+    return scheduled.size();
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+template <typename Generator>
+std::size_t ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::prefetch(
+    std::vector<Key> const& keys,
+    Generator func
+) {
+    PrefetchList const scheduled = _startPrefetch(keys);
+    if (scheduled.empty()) {
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_prefetchMutex);
+        _numPrefetching += scheduled.size();
+    }
+    try {
+        _runInBackground([this, scheduled, func]() mutable {
+            for (auto const& pair : scheduled) {
+                _prefetchOne(pair.first, *pair.second, func);
+            }
+        });
+    } catch (...) {
+        _abandonPrefetch(scheduled, 0);
+        _finishPrefetch(scheduled.size());
+        throw;
+    }
+    return scheduled.size();
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::add(Key const& key, Value && value) {
+    LockedShard & shard = _getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.add(key, std::move(value));
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::add(
+    Key const& key,
+    Value const& value,
+    Duration timeToLive
+) {
+    LockedShard & shard = _getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.add(key, value, timeToLive);
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+bool ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::erase(Key const& key) {
+    LockedShard & shard = _getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.cache.erase(key);
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::setTimeToLive(
+    Duration timeToLive,
+    Duration refreshAhead
+) {
+    _timeToLive.store(timeToLive.count(), std::memory_order_relaxed);
+    _refreshAhead.store(refreshAhead.count(), std::memory_order_relaxed);
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        _shards[ii].cache.setTimeToLive(timeToLive);
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+std::size_t ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::size() const {
+    std::size_t result = 0;
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        result += _shards[ii].cache.size();
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+std::vector<Key> ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::keys() const {
+    std::vector<Key> result;
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        auto const shardKeys = _shards[ii].cache.keys();
+        result.insert(result.end(), shardKeys.begin(), shardKeys.end());
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+bool ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::contains(Key const& key) {
+    LockedShard & shard = _getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.cache.contains(key);
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+std::optional<Value> ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::get(Key const& key) {
+    LockedShard & shard = _getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.cache.get(key);
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::reserve(std::size_t maxElements) {
+    _maxElements = maxElements;
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        _shards[ii].cache.reserve(_shardShare(_maxElements, ii));
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+std::size_t ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::weight() const {
+    std::size_t result = 0;
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        result += _shards[ii].cache.weight();
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::reserveWeight(std::size_t maxWeight) {
+    _maxWeight = maxWeight;
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        _shards[ii].cache.reserveWeight(_shardShare(_maxWeight, ii));
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::flush() {
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        _shards[ii].cache.flush();
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+CacheStatistics ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::stats() const {
+    CacheStatistics result = _counters.get();
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        result += _shards[ii].cache.stats();
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::resetStats() {
+    _counters.reset();
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        _shards[ii].cache.resetStats();
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+void ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::enableSampling(
+    std::size_t capacity,
+    std::size_t interval
+) {
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        _shards[ii].cache.enableSampling(_shardShare(capacity, ii), interval);
+    }
+}
+
+template <typename Key, typename Value, typename KeyHash, typename KeyPred, typename Policy>
+std::vector<Key> ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy>::sampledKeys() const {
+    std::vector<Key> result;
+    for (std::size_t ii = 0; ii < _numShards; ++ii) {
+        std::lock_guard<std::mutex> lock(_shards[ii].mutex);
+        auto const shardKeys = _shards[ii].cache.sampledKeys();
+        result.insert(result.end(), shardKeys.begin(), shardKeys.end());
+    }
+    return result;
+}
+
+}
+} // namespace lsst::cpputils
+
+
+#endif // ifndef LSST_CPPUTILS_CONCURRENT_CACHE_H
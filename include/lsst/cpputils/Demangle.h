@@ -30,7 +30,13 @@
 namespace lsst {
 namespace cpputils {
 
-std::string demangleType(std::string const _typeName);
+/**
+ * Demangle a type name (e.g., from `typeid(...).name()`).
+ *
+ * This is thread-safe. Each thread remembers the names it has most recently
+ * demangled, so repeated calls with the same name are cheap.
+ */
+std::string demangleType(std::string const& _typeName);
 
 }
 } // namespace lsst::cpputils
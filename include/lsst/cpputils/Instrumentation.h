@@ -0,0 +1,261 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_INSTRUMENTATION_H
+#define LSST_CPPUTILS_INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lsst {
+namespace cpputils {
+
+/// Number of events recorded by a Counter, and their total duration, summed over all threads
+struct CounterSnapshot {
+    std::string name;
+    std::uint64_t count;
+    std::chrono::nanoseconds time;
+};
+
+namespace detail {
+
+// Accumulators of one counter for one thread; only that thread writes them
+struct CounterSlot {
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> nanoseconds{0};
+};
+
+// The counters of one thread, in pages allocated by that thread as needed.
+// Blocks are never freed: when a thread exits, its block is adopted by the next new thread, keeping the
+// values recorded so far.
+struct ThreadCounters {
+    static constexpr std::size_t PAGE_SIZE = 256;
+    static constexpr std::size_t MAX_PAGES = 256;
+
+    ThreadCounters() noexcept {
+        for (auto & page : pages) {
+            page.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ThreadCounters(ThreadCounters const&) = delete;
+    ThreadCounters& operator=(ThreadCounters const&) = delete;
+
+    // Slot for a counter; may only be called by the thread owning the block
+    CounterSlot & getSlot(std::size_t id) {
+        std::atomic<CounterSlot*> & entry = pages[id/PAGE_SIZE];
+        CounterSlot * page = entry.load(std::memory_order_relaxed);
+        if (!page) {
+            page = new CounterSlot[PAGE_SIZE];
+            entry.store(page, std::memory_order_release);  // Publish the zeroed slots to readers
+        }
+        return page[id % PAGE_SIZE];
+    }
+
+    std::array<std::atomic<CounterSlot*>, MAX_PAGES> pages;
+    std::atomic<bool> inUse{true};  // Is a thread writing to this block?
+    ThreadCounters * next = nullptr;  // Next block in the registry's list; set before publication
+};
+
+}  // namespace detail
+
+/**
+ * Registry of all Counters in the process.
+ *
+ * Each thread accumulates its own copy of every counter it uses, so that
+ * recording an event is a pair of uncontended relaxed stores. A snapshot
+ * sums the copies of all threads, without locking them; it may therefore
+ * miss events recorded while it is being taken.
+ *
+ * The registry is a singleton shared by all libraries and Python modules
+ * that use it. Counter names are conventionally dotted, starting with the
+ * package (e.g. "cpputils.Cache.generate").
+ */
+class CounterRegistry final {
+public:
+    /// Maximum number of distinct counters
+    static constexpr std::size_t MAX_COUNTERS = detail::ThreadCounters::PAGE_SIZE*
+                                                detail::ThreadCounters::MAX_PAGES;
+
+    CounterRegistry(CounterRegistry const&) = delete;
+    CounterRegistry& operator=(CounterRegistry const&) = delete;
+
+    /// Get a reference to the singleton
+    static CounterRegistry & get() noexcept;
+
+    /**
+     * Identifier of the counter with the given name, registering it if necessary.
+     *
+     * @throws lsst::pex::exceptions::LengthError if there are already
+     *         MAX_COUNTERS counters.
+     */
+    std::size_t getId(std::string const& name);
+
+    /// Values of all counters since the last reset, in order of name
+    std::vector<CounterSnapshot> getSnapshot() const;
+
+    /// Start counting all counters from zero
+    void reset();
+
+    // Block of counters for a new thread
+    detail::ThreadCounters * _acquireThreadCounters();
+
+private:
+    CounterRegistry() = default;
+
+    // Sum of the values of each counter over all threads
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> _sum(std::size_t numCounters) const;
+
+    mutable std::mutex _mutex;  // Protects _names, _ids and _baseline
+    std::vector<std::string> _names;  // Name of each counter, by identifier
+    std::unordered_map<std::string, std::size_t> _ids;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> _baseline;  // Sums at the last reset
+    std::atomic<detail::ThreadCounters*> _threads{nullptr};  // List of blocks of counters
+};
+
+namespace detail {
+
+// Release the block of counters of a thread when it exits
+struct ThreadCountersHolder {
+    ThreadCountersHolder() : counters(CounterRegistry::get()._acquireThreadCounters()) {}
+    ~ThreadCountersHolder() { counters->inUse.store(false, std::memory_order_release); }
+
+    ThreadCounters * counters;
+};
+
+inline ThreadCounters & getThreadCounters() {
+    thread_local ThreadCountersHolder holder;
+    return *holder.counters;
+}
+
+}  // namespace detail
+
+/**
+ * A named count of events, and of their total duration.
+ *
+ * Counters with the same name share their values. Counters are usually
+ * function-local statics, created through the macros LSST_COUNTER_ADD and
+ * LSST_SCOPED_TIMER rather than directly.
+ */
+class Counter final {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Counter with the given name; see CounterRegistry::getId
+    explicit Counter(std::string const& name) : _id(CounterRegistry::get().getId(name)) {}
+
+    /// Record `count` events
+    void add(std::uint64_t count = 1) { add(count, std::chrono::nanoseconds(0)); }
+
+    /// Record `count` events, which took `time` in total
+    template <typename Rep, typename Period>
+    void add(std::uint64_t count, std::chrono::duration<Rep, Period> time) {
+        detail::CounterSlot & slot = detail::getThreadCounters().getSlot(_id);
+        auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+        // This thread is the only writer of the slot
+        slot.count.store(slot.count.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        slot.nanoseconds.store(slot.nanoseconds.load(std::memory_order_relaxed) + ns,
+                               std::memory_order_relaxed);
+    }
+
+    /// Identifier of the counter in the CounterRegistry
+    std::size_t getId() const noexcept { return _id; }
+
+private:
+    std::size_t _id;
+};
+
+/**
+ * Record the lifetime of the timer as one event of a Counter.
+ */
+class ScopedTimer final {
+public:
+    explicit ScopedTimer(Counter & counter) noexcept : _counter(counter), _start(Counter::Clock::now()) {}
+
+    ScopedTimer(ScopedTimer const&) = delete;
+    ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+    ~ScopedTimer() noexcept {
+        try {
+            _counter.add(1, getElapsed());
+        } catch (...) {
+            // Out of memory for the counters; the event is not recorded
+        }
+    }
+
+    /// Time since the timer was created
+    std::chrono::nanoseconds getElapsed() const noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Counter::Clock::now() - _start);
+    }
+
+private:
+    Counter & _counter;
+    Counter::Clock::time_point _start;
+};
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#define LSST_CPPUTILS_CONCAT_IMPL(a, b) a##b
+#define LSST_CPPUTILS_CONCAT(a, b) LSST_CPPUTILS_CONCAT_IMPL(a, b)
+
+/*
+ * Macros for instrumenting code.
+ *
+ * LSST_COUNTER_ADD(name, count[, time]) records `count` events (taking `time`
+ * in total) in the counter named `name`, and LSST_SCOPED_TIMER(name) records
+ * the rest of the enclosing scope as an event. The name is only used the
+ * first time the macro is executed.
+ *
+ * Define LSST_CPPUTILS_INSTRUMENTATION_DISABLE to compile them to nothing
+ * (without evaluating their arguments).
+ */
+#ifndef LSST_CPPUTILS_INSTRUMENTATION_DISABLE
+
+#define LSST_COUNTER_ADD(name, ...)                                  \
+    do {                                                             \
+        static ::lsst::cpputils::Counter lsstCounterAdd_(name);      \
+        lsstCounterAdd_.add(__VA_ARGS__);                            \
+    } while (false)
+
+#define LSST_SCOPED_TIMER(name)                                                              \
+    static ::lsst::cpputils::Counter LSST_CPPUTILS_CONCAT(lsstTimerCounter_, __LINE__)(name); \
+    ::lsst::cpputils::ScopedTimer LSST_CPPUTILS_CONCAT(lsstTimer_, __LINE__)(                 \
+            LSST_CPPUTILS_CONCAT(lsstTimerCounter_, __LINE__))
+
+#else
+
+#define LSST_COUNTER_ADD(name, ...) static_cast<void>(0)
+#define LSST_SCOPED_TIMER(name) static_cast<void>(0)
+
+#endif
+
+#endif  // LSST_CPPUTILS_INSTRUMENTATION_H
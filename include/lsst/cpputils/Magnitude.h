@@ -38,6 +38,7 @@
 #define LSST_CPPUTILS_MAGNITUDE_H
 
 #include <cmath>
+#include <cstddef>
 
 namespace lsst {
 namespace cpputils {
@@ -51,6 +52,46 @@ double nanojanskyToABMagnitude(double flux);
 /// Convert an AB magnitude to a flux in nanojansky.
 double ABMagnitudeToNanojansky(double magnitude);
 
+/// Convert a flux error in nanojansky to an AB magnitude error.
+double nanojanskyErrToABMagnitudeErr(double flux, double fluxErr);
+
+/// Convert an AB magnitude error to a flux error in nanojansky.
+double ABMagnitudeErrToNanojanskyErr(double magnitude, double magnitudeErr);
+
+/**
+ * Convert `n` fluxes in nanojansky to AB magnitudes.
+ *
+ * The results are identical to those of the scalar overload; `magnitude` may
+ * be the same array as `flux`.
+ */
+void nanojanskyToABMagnitude(double const* flux, double* magnitude, std::size_t n);
+
+/**
+ * Convert `n` AB magnitudes to fluxes in nanojansky.
+ *
+ * The results are identical to those of the scalar overload; `flux` may be
+ * the same array as `magnitude`.
+ */
+void ABMagnitudeToNanojansky(double const* magnitude, double* flux, std::size_t n);
+
+/**
+ * Convert `n` flux errors in nanojansky to AB magnitude errors.
+ *
+ * The results are identical to those of the scalar overload; `magnitudeErr`
+ * may be the same array as `fluxErr`.
+ */
+void nanojanskyErrToABMagnitudeErr(double const* flux, double const* fluxErr, double* magnitudeErr,
+                                   std::size_t n);
+
+/**
+ * Convert `n` AB magnitude errors to flux errors in nanojansky.
+ *
+ * The results are identical to those of the scalar overload; `fluxErr` may
+ * be the same array as `magnitudeErr`.
+ */
+void ABMagnitudeErrToNanojanskyErr(double const* magnitude, double const* magnitudeErr, double* fluxErr,
+                                   std::size_t n);
+
 }  // namespace cpputils
 }  // namespace lsst
 
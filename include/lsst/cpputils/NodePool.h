@@ -0,0 +1,237 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_NODEPOOL_H
+#define LSST_CPPUTILS_NODEPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace lsst {
+namespace cpputils {
+
+/**
+ * Pool of fixed-size memory blocks, for the nodes of a node-based container.
+ *
+ * The size of the blocks is set by the first allocation of a single object;
+ * allocations of other sizes (e.g., the bucket array of a hash table) are
+ * passed to the global `operator new`. Blocks are carved from slabs, which
+ * are only returned to the system when the pool is destroyed, and freed
+ * blocks are kept on a free list for reuse. Once the pool holds as many
+ * blocks as the container has nodes at its largest, the container's
+ * insertions and removals do not allocate.
+ *
+ * The pool is thread-safe: it is protected by a mutex, which is uncontended
+ * if (as for a `Cache`) the container is only used by one thread at a time.
+ */
+class NodePool final {
+public:
+    /// Minimum number of blocks in a slab
+    static constexpr std::size_t MIN_SLAB_BLOCKS = 16;
+
+    NodePool() = default;
+    NodePool(NodePool const&) = delete;
+    NodePool& operator=(NodePool const&) = delete;
+
+    ~NodePool() noexcept {
+        for (void* slab : _slabs) {
+            ::operator delete(slab);
+        }
+    }
+
+    /**
+     * Allocate a block, if the size matches the pool's block size.
+     *
+     * @returns The block, or null if it must be allocated elsewhere.
+     */
+    void* allocate(std::size_t size, std::size_t alignment) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_blockSize == 0 && alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            _blockSize = _roundUp(std::max(size, sizeof(FreeBlock)), std::max(alignment, alignof(FreeBlock)));
+            _requestSize = size;
+            _grow(std::max(_reserved, MIN_SLAB_BLOCKS));
+        }
+        if (size != _requestSize || alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return nullptr;
+        }
+        if (!_free) {
+            _grow(std::max(_numBlocks, MIN_SLAB_BLOCKS));
+        }
+        FreeBlock* block = _free;
+        _free = block->next;
+        ++_numUsed;
+        return block;
+    }
+
+    /**
+     * Return a block obtained from `allocate`.
+     *
+     * @returns Whether the block belonged to the pool; if not, it must be
+     *          freed elsewhere.
+     */
+    bool deallocate(void* pointer, std::size_t size) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (size != _requestSize || _blockSize == 0) {
+            return false;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(pointer);
+        block->next = _free;
+        _free = block;
+        --_numUsed;
+        return true;
+    }
+
+    /// Ensure that the pool holds at least `numBlocks` blocks
+    void reserve(std::size_t numBlocks) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reserved = std::max(_reserved, numBlocks);
+        if (_blockSize > 0 && _numBlocks < numBlocks) {
+            _grow(numBlocks - _numBlocks);
+        }
+    }
+
+    /// Number of blocks held by the pool, in use or free
+    std::size_t getNumBlocks() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _numBlocks;
+    }
+
+    /// Number of blocks in use
+    std::size_t getNumUsed() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _numUsed;
+    }
+
+    /// Number of slabs allocated from the system
+    std::size_t getNumSlabs() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _slabs.size();
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static std::size_t _roundUp(std::size_t size, std::size_t alignment) {
+        return (size + alignment - 1)/alignment*alignment;
+    }
+
+    // Add a slab of `numBlocks` blocks to the free list
+    void _grow(std::size_t numBlocks) {
+        _slabs.reserve(_slabs.size() + 1);
+        auto* slab = static_cast<unsigned char*>(::operator new(numBlocks*_blockSize));
+        _slabs.push_back(slab);
+        for (std::size_t ii = numBlocks; ii > 0; --ii) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + (ii - 1)*_blockSize);
+            block->next = _free;
+            _free = block;
+        }
+        _numBlocks += numBlocks;
+    }
+
+    mutable std::mutex _mutex;  // Protects the members below
+    std::size_t _requestSize = 0;  // Size of the objects allocated from the pool
+    std::size_t _blockSize = 0;  // Size of each block; zero until the first allocation
+    std::size_t _reserved = 0;  // Minimum number of blocks requested by reserve
+    std::size_t _numBlocks = 0;  // Number of blocks in all slabs
+    std::size_t _numUsed = 0;  // Number of blocks in use
+    FreeBlock* _free = nullptr;  // Head of the free list
+    std::vector<void*> _slabs;  // Memory from which the blocks are carved
+};
+
+/**
+ * Standard allocator drawing single objects from a shared NodePool.
+ *
+ * Copies (including copies rebound to other types, as containers make for
+ * their nodes) share the pool, which lives as long as any of them, but a
+ * copy of a container gets a new pool.
+ * Allocators are propagated with the containers that use them, so nodes
+ * are always returned to the pool they came from.
+ *
+ * The value type is immaterial when the allocator is passed to a
+ * container that rebinds it, e.g. `Cache<Key, Value, ..., NodePoolAllocator<void>>`.
+ */
+template <typename T>
+class NodePoolAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind {
+        using other = NodePoolAllocator<U>;
+    };
+
+    /// Construct an allocator with a new pool
+    NodePoolAllocator() : _pool(std::make_shared<NodePool>()) {}
+
+    template <typename U>
+    NodePoolAllocator(NodePoolAllocator<U> const& other) noexcept : _pool(other.getPool()) {}
+
+    /// A copy of a container gets a pool of its own
+    NodePoolAllocator select_on_container_copy_construction() const { return NodePoolAllocator(); }
+
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            if (void* block = _pool->allocate(sizeof(T), alignof(T))) {
+                return static_cast<T*>(block);
+            }
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* pointer, std::size_t n) noexcept {
+        if (n != 1 || !_pool->deallocate(pointer, sizeof(T))) {
+            std::allocator<T>().deallocate(pointer, n);
+        }
+    }
+
+    /// Ensure that the pool holds at least `numBlocks` blocks
+    void reserve(std::size_t numBlocks) { _pool->reserve(numBlocks); }
+
+    /// The shared pool
+    std::shared_ptr<NodePool> const& getPool() const noexcept { return _pool; }
+
+    template <typename U>
+    bool operator==(NodePoolAllocator<U> const& other) const noexcept { return _pool == other.getPool(); }
+
+    template <typename U>
+    bool operator!=(NodePoolAllocator<U> const& other) const noexcept { return _pool != other.getPool(); }
+
+private:
+    std::shared_ptr<NodePool> _pool;
+};
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#endif  // LSST_CPPUTILS_NODEPOOL_H
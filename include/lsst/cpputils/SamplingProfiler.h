@@ -0,0 +1,116 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef LSST_CPPUTILS_SAMPLINGPROFILER_H
+#define LSST_CPPUTILS_SAMPLINGPROFILER_H
+
+#include <cstddef>
+#include <string>
+
+namespace lsst {
+namespace cpputils {
+
+/**
+ *  Singleton statistical profiler, which samples the call stacks of all threads.
+ *
+ *  While the profiler is running, SIGPROF is delivered (by `setitimer`) for
+ *  every `interval` seconds of CPU time used by the process, and the signal
+ *  handler records the stack of the interrupted thread in a buffer allocated
+ *  by `start`. Like the Backtrace handler, it only uses async-signal-safe
+ *  operations: a slot is reserved with an atomic increment, and the frames
+ *  are captured with `backtrace`. Once the buffer is full, further samples
+ *  are dropped (and counted). The samples are symbolized and aggregated by
+ *  `getFoldedStacks`, outside the handler. Once installed by `start`, the
+ *  handler remains installed (doing nothing while the profiler is stopped),
+ *  so that a SIGPROF still pending when the profiler stops is harmless.
+ *
+ *  The folded-stack format (one line per distinct stack, with the frames from
+ *  the outermost down separated by semicolons, followed by the number of
+ *  samples) is that read by flame graph tools.
+ *
+ *  @note The controlling methods (`start`, `stop`, `getFoldedStacks`) should
+ *  be called from one thread at a time; they are serialized by a lock.
+ */
+class SamplingProfiler final {
+public:
+    /// Maximum number of frames recorded per sample
+    static constexpr std::size_t MAX_DEPTH = 64;
+
+    // No copying and moving
+    SamplingProfiler(SamplingProfiler const&) = delete;
+    SamplingProfiler(SamplingProfiler&&) = delete;
+    SamplingProfiler& operator=(SamplingProfiler const&) = delete;
+    SamplingProfiler& operator=(SamplingProfiler&&) = delete;
+
+    /// Get a reference to the singleton
+    static SamplingProfiler& get() noexcept {
+        static SamplingProfiler st;
+        return st;
+    }
+
+    /// Can the profiler be used on this platform?
+    bool isSupported() const noexcept { return supported; }
+
+    /// Is the profiler collecting samples?
+    bool isRunning() const noexcept;
+
+    /**
+     * Start collecting samples, discarding any previous ones.
+     *
+     * @param[in] interval  CPU time between samples, in seconds.
+     * @param[in] maxSamples  Maximum number of samples to collect.
+     *
+     * @throws lsst::pex::exceptions::LogicError if the profiler is already running.
+     * @throws lsst::pex::exceptions::InvalidParameterError if interval or maxSamples is not positive.
+     * @throws lsst::pex::exceptions::RuntimeError if the profiler is not supported, or the timer
+     *         cannot be set.
+     */
+    void start(double interval = 0.01, std::size_t maxSamples = 10000);
+
+    /// Stop collecting samples; does nothing if the profiler is not running
+    void stop();
+
+    /// Number of samples collected by the last (or current) run, excluding those dropped
+    std::size_t getNumSamples() const noexcept;
+
+    /// Number of samples dropped by the last (or current) run because the buffer was full
+    std::size_t getNumDropped() const noexcept;
+
+    /**
+     * Return the samples collected by the last run, in folded-stack format.
+     *
+     * @throws lsst::pex::exceptions::LogicError if the profiler is running.
+     */
+    std::string getFoldedStacks() const;
+
+private:
+    SamplingProfiler() noexcept;
+
+    bool const supported;
+};
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#endif
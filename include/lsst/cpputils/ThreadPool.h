@@ -0,0 +1,209 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_THREADPOOL_H
+#define LSST_CPPUTILS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lsst {
+namespace cpputils {
+
+/**
+ * Pool of worker threads with work stealing.
+ *
+ * Each worker has its own queue of tasks. Tasks submitted from a worker go
+ * to the back of its own queue, and other tasks are distributed over the
+ * queues in turn. A worker runs tasks from the back of its own queue, and
+ * when that is empty, steals from the front of the others.
+ *
+ * Most code should use `parallelFor`, with the default pool, rather than
+ * submitting tasks directly.
+ *
+ * @see getDefaultNumThreads
+ */
+class ThreadPool final {
+public:
+    /**
+     * Start a pool.
+     *
+     * @param numThreads  Number of worker threads; zero selects
+     *                    `getDefaultNumThreads()`.
+     */
+    explicit ThreadPool(std::size_t numThreads=0);
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /// Run all tasks still queued, and stop the workers
+    ~ThreadPool() noexcept;
+
+    /**
+     * The pool shared by `parallelFor` and others, created on first use.
+     *
+     * It has `getDefaultNumThreads()` workers.
+     */
+    static ThreadPool & getDefault();
+
+    /// Number of worker threads
+    std::size_t getNumThreads() const noexcept { return _workers.size(); }
+
+    /**
+     * Queue a task to be run by a worker.
+     *
+     * Any exception thrown by the task is discarded; use `parallelFor` to
+     * propagate exceptions. The pool may be passed as the executor of
+     * `ConcurrentCache::prefetch` to generate the keys in parallel (without
+     * an executor, they are generated one after another on a single thread).
+     */
+    void submit(std::function<void()> task);
+
+    void operator()(std::function<void()> task) { submit(std::move(task)); }
+
+private:
+    struct Worker {
+        std::mutex mutex;  // Protects tasks
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void _run(std::size_t index);
+    bool _runOne(std::size_t index);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    std::atomic<std::size_t> _nextQueue{0};  // Queue for the next task submitted from outside the pool
+    std::atomic<std::size_t> _numQueued{0};  // Number of tasks in all queues
+    std::mutex _sleepMutex;  // Protects _stop, and orders wakeups
+    std::condition_variable _wakeup;  // Notified when tasks are queued, or the pool stops
+    bool _stop = false;  // Should idle workers exit?
+};
+
+/**
+ * Default number of threads for parallel work.
+ *
+ * This is the value of the environment variable `LSST_CPPUTILS_NUM_THREADS`,
+ * if it is set to a positive integer. Otherwise it is the number of CPUs
+ * available to the process: the CPUs it may run on (its affinity mask),
+ * limited by any CPU quota of its cgroup (v1 or v2), so that batch jobs
+ * sharing a node don't oversubscribe it. The result is at least one.
+ */
+std::size_t getDefaultNumThreads();
+
+namespace detail {
+
+// Number of CPUs allowed by the CPU quotas of the cgroup of this process and its ancestors, or zero if
+// there is none; the arguments (for testing) are the process's cgroup file and the cgroup mount point
+std::size_t getCgroupCpus(std::string const& procCgroup="/proc/self/cgroup",
+                          std::string const& mountPoint="/sys/fs/cgroup");
+
+// State shared by the threads working on a parallelFor
+struct ParallelForState {
+    std::size_t begin;
+    std::size_t end;
+    std::size_t chunkSize;
+    std::size_t numChunks;
+    std::function<void(std::size_t, std::size_t)> const* func;  // Only used while the caller waits
+    std::atomic<std::size_t> nextChunk{0};
+    std::atomic<std::size_t> numFinished{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;  // Protects error; orders completion
+    std::condition_variable done;  // Notified when all chunks have finished
+    std::exception_ptr error;  // First exception thrown
+
+    // Run chunks until there are none left
+    void work();
+};
+
+}  // namespace detail
+
+/**
+ * Call `func(chunkBegin, chunkEnd)` over contiguous chunks covering
+ * `[begin, end)`, in parallel.
+ *
+ * Chunks have at least `grain` elements (except perhaps the last), and
+ * there are at most a few per thread, so that faster threads can take
+ * more. The calling thread works on chunks too, so `parallelFor` may be
+ * nested (e.g., called from a task in the same pool) without deadlock. If
+ * there is only one chunk, or the pool has a single thread, `func` is
+ * called directly.
+ *
+ * If `func` throws, no further chunks are started, and the first exception
+ * is rethrown in the calling thread once the chunks already running have
+ * finished.
+ *
+ * @param begin, end  Range of indices.
+ * @param grain  Minimum number of indices per chunk; zero is treated as one.
+ * @param func  Function called for each chunk; it may be called
+ *              concurrently from several threads.
+ * @param pool  Pool of threads to use.
+ */
+template <typename Function>
+void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Function func,
+                 ThreadPool & pool=ThreadPool::getDefault()) {
+    if (end <= begin) {
+        return;
+    }
+    std::size_t const num = end - begin;
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t const maxChunks = 4*pool.getNumThreads();
+    std::size_t const numChunks = std::min(num/grain, maxChunks);
+    if (numChunks <= 1 || pool.getNumThreads() <= 1) {
+        func(begin, end);
+        return;
+    }
+    std::function<void(std::size_t, std::size_t)> const function(std::move(func));
+    auto state = std::make_shared<detail::ParallelForState>();
+    state->begin = begin;
+    state->end = end;
+    state->chunkSize = (num + numChunks - 1)/numChunks;
+    state->numChunks = (num + state->chunkSize - 1)/state->chunkSize;
+    state->func = &function;
+    std::size_t const numHelpers = std::min(pool.getNumThreads(), state->numChunks - 1);
+    for (std::size_t ii = 0; ii < numHelpers; ++ii) {
+        pool.submit([state]() { state->work(); });
+    }
+    state->work();
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&state] { return state->numFinished.load() == state->numChunks; });
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#endif  // LSST_CPPUTILS_THREADPOOL_H
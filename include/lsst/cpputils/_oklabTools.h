@@ -23,9 +23,16 @@ SOFTWARE.
 Modified 2024 to us Display P3 Conversions - Princeton University
 */
 
+#ifndef LSST_CPPUTILS_OKLABTOOLS_H
+#define LSST_CPPUTILS_OKLABTOOLS_H
+
 #include <math.h>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <float.h>
+#include <limits>
+#include <vector>
 
 namespace lsst {
 namespace cpputils {
@@ -34,28 +41,112 @@ namespace details {
 struct Lab {float L; float a; float b;};
 struct RGB {float r; float g; float b;};
 
-Lab linear_srgb_to_oklab(RGB c)
+// Compile-time descriptions of RGB gamuts (color spaces with linear components), on which the
+// conversion, cusp, intersection and clip functions below are templated. Each provides:
+//  - to_lms and from_lms: the matrices from linear RGB to the linear LMS responses of OKLab, and back;
+//  - saturation_select: the coefficients {c0, c1} of the tests c0 * a + c1 * b > 1 that select
+//    whether the red (first test) or else the green (second test) component goes below zero first
+//    as the saturation increases (otherwise it is the blue component);
+//  - saturation_coeffs: for each of the red, green and blue components, the coefficients k0..k4 of
+//    the polynomial k0 + k1 * a + k2 * b + k3 * a^2 + k4 * a * b approximating the maximum saturation;
+//  - saturation_steps: the number of Halley steps refining that approximation;
+//  - transfer_function: the transfer function from linear to encoded values.
+// The Display P3 and Rec.2020 matrices are derived from the sRGB ones (through the conversions
+// between the RGB spaces), so that white maps to L = 1, a = b = 0 in every gamut, and their
+// maximum saturation coefficients were fit to the maximum saturation computed in double precision.
+struct SrgbGamut
 {
-	float l = 0.4122214708f * c.r + 0.5363325363f * c.g + 0.0514459929f * c.b;
-	float m = 0.2119034982f * c.r + 0.6806995451f * c.g + 0.1073969566f * c.b;
-	float s = 0.0883024619f * c.r + 0.2817188376f * c.g + 0.6299787005f * c.b;
+	static constexpr float to_lms[3][3] = {
+		{ 0.4122214708f, 0.5363325363f, 0.0514459929f },
+		{ 0.2119034982f, 0.6806995451f, 0.1073969566f },
+		{ 0.0883024619f, 0.2817188376f, 0.6299787005f },
+	};
+	static constexpr float from_lms[3][3] = {
+		{ +4.0767416621f, -3.3077115913f, +0.2309699292f },
+		{ -1.2684380046f, +2.6097574011f, -0.3413193965f },
+		{ -0.0041960863f, -0.7034186147f, +1.7076147010f },
+	};
+	static constexpr float saturation_select[2][2] = {
+		{ -1.88170328f, -0.80936493f },
+		{ +1.81444104f, -1.19445276f },
+	};
+	static constexpr float saturation_coeffs[3][5] = {
+		{ +1.19086277f, +1.76576728f, +0.59662641f, +0.75515197f, +0.56771245f },
+		{ +0.73956515f, -0.45954404f, +0.08285427f, +0.12541070f, +0.14503204f },
+		{ +1.35733652f, -0.00915799f, -1.15130210f, -0.50559606f, +0.00692167f },
+	};
+	static constexpr int saturation_steps = 1;
 
-	float l_ = cbrtf(l);
-	float m_ = cbrtf(m);
-	float s_ = cbrtf(s);
+	static float transfer_function(float a)
+	{
+		return .0031308f >= a ? 12.92f * a : 1.055f * powf(a, .4166666666666667f) - .055f;
+	}
+};
 
-	return {
-		0.2104542553f * l_ + 0.7936177850f * m_ - 0.0040720468f * s_,
-		1.9779984951f * l_ - 2.4285922050f * m_ + 0.4505937099f * s_,
-		0.0259040371f * l_ + 0.7827717662f * m_ - 0.8086757660f * s_,
+struct DisplayP3Gamut
+{
+	static constexpr float to_lms[3][3] = {
+		{ 0.4813798544f, 0.4621183697f, 0.0565017758f },
+		{ 0.2288319449f, 0.6532168128f, 0.1179512422f },
+		{ 0.0839457557f, 0.2241652689f, 0.6918889754f },
 	};
-}
+	static constexpr float from_lms[3][3] = {
+		{ +3.1277689872f, -2.2571357962f, +0.1293668090f },
+		{ -1.0910090478f, +2.4133317587f, -0.3223227108f },
+		{ -0.0260108130f, -0.5080413259f, +1.5340521389f },
+	};
+	static constexpr float saturation_select[2][2] = {
+		{ -1.77239839f, -0.82084073f },
+		{ +1.80301279f, -1.19316187f },
+	};
+	static constexpr float saturation_coeffs[3][5] = {
+		{ +1.46210837f, +2.05789664f, +0.73722151f, +0.84121138f, +0.67091360f },
+		{ +0.77608580f, -0.45670585f, +0.11778011f, +0.13691802f, -0.17365801f },
+		{ +1.47774750f, -0.03109815f, -1.24030661f, -0.53139502f, +0.02536155f },
+	};
+	static constexpr int saturation_steps = 2;
+
+	// Display P3 uses the sRGB transfer function
+	static float transfer_function(float a) { return SrgbGamut::transfer_function(a); }
+};
 
-Lab linear_displayP3_to_oklab(RGB c)
+struct Rec2020Gamut
 {
-	float l = 0.48132729f * c.r + 0.46206791f * c.g + 00.0564956f * c.b;
-	float m = 0.2288381f * c.r + 0.6532344f * c.g + 0.11795441f * c.b;
-	float s = 0.08398602f * c.r + 0.22427279f * c.g + 0.69222084f * c.b;
+	static constexpr float to_lms[3][3] = {
+		{ 0.6167557872f, 0.3601983994f, 0.0230458134f },
+		{ 0.2651330640f, 0.6358393641f, 0.0990275718f },
+		{ 0.1001026342f, 0.2039065194f, 0.6959908464f },
+	};
+	static constexpr float from_lms[3][3] = {
+		{ +2.1399067360f, -1.2463895092f, +0.1064827732f },
+		{ -0.8847358629f, +2.1632309824f, -0.2784951196f },
+		{ -0.0485737578f, -0.4545031431f, +1.5030769009f },
+	};
+	static constexpr float saturation_select[2][2] = {
+		{ -1.37018584f, -0.47018842f },
+		{ +2.00506938f, -2.02370308f },
+	};
+	static constexpr float saturation_coeffs[3][5] = {
+		{ +2.73002004f, +4.14241283f, +1.06450280f, +1.80515692f, +0.95947829f },
+		{ +0.92236006f, -0.58665585f, +0.22058377f, +0.19881587f, -0.28780815f },
+		{ +1.70447167f, -0.06760406f, -1.46015361f, -0.65963624f, +0.06314009f },
+	};
+	static constexpr int saturation_steps = 4;
+
+	// The ITU-R BT.2020 transfer function
+	static float transfer_function(float a)
+	{
+		return .0181f >= a ? 4.5f * a : 1.0993f * powf(a, .45f) - .0993f;
+	}
+};
+
+template <typename Gamut>
+inline Lab linear_rgb_to_oklab(RGB c)
+{
+	constexpr auto const& M = Gamut::to_lms;
+	float l = M[0][0] * c.r + M[0][1] * c.g + M[0][2] * c.b;
+	float m = M[1][0] * c.r + M[1][1] * c.g + M[1][2] * c.b;
+	float s = M[2][0] * c.r + M[2][1] * c.g + M[2][2] * c.b;
 
 	float l_ = cbrtf(l);
 	float m_ = cbrtf(m);
@@ -68,8 +159,8 @@ Lab linear_displayP3_to_oklab(RGB c)
 	};
 }
 
-
-RGB oklab_to_linear_srgb(Lab c)
+template <typename Gamut>
+inline RGB oklab_to_linear_rgb(Lab c)
 {
     float l_ = c.L + 0.3963377774f * c.a + 0.2158037573f * c.b;
     float m_ = c.L - 0.1055613458f * c.a - 0.0638541728f * c.b;
@@ -79,70 +170,49 @@ RGB oklab_to_linear_srgb(Lab c)
     float m = m_ * m_ * m_;
     float s = s_ * s_ * s_;
 
+    constexpr auto const& M = Gamut::from_lms;
     return {
-        +4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s,
-        -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s,
-        -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s,
+        M[0][0] * l + M[0][1] * m + M[0][2] * s,
+        M[1][0] * l + M[1][1] * m + M[1][2] * s,
+        M[2][0] * l + M[2][1] * m + M[2][2] * s,
     };
 }
 
-RGB oklab_to_linear_displayP3(Lab c)
-{
-    float l_ = c.L + 0.3963377774f * c.a + 0.2158037573f * c.b;
-    float m_ = c.L - 0.1055613458f * c.a - 0.0638541728f * c.b;
-    float s_ = c.L - 0.0894841775f * c.a - 1.2914855480f * c.b;
-
-    float l = l_ * l_ * l_;
-    float m = m_ * m_ * m_;
-    float s = s_ * s_ * s_;
+inline Lab linear_srgb_to_oklab(RGB c) { return linear_rgb_to_oklab<SrgbGamut>(c); }
+inline Lab linear_displayP3_to_oklab(RGB c) { return linear_rgb_to_oklab<DisplayP3Gamut>(c); }
+inline RGB oklab_to_linear_srgb(Lab c) { return oklab_to_linear_rgb<SrgbGamut>(c); }
+inline RGB oklab_to_linear_displayP3(Lab c) { return oklab_to_linear_rgb<DisplayP3Gamut>(c); }
 
-    return {
-        3.12811053f * l - 2.25707502f * m + 0.12930479f * s,
-        -1.09112816f * l + 2.41326676f * m - 0.32216817f * s,
-        -0.02601365f * l - 0.50802765f * m + 1.53331668f * s,
-    };
-}
-
-// Finds the maximum saturation possible for a given hue that fits in sRGB
+// Finds the maximum saturation possible for a given hue that fits in the gamut
 // Saturation here is defined as S = C/L
 // a and b must be normalized so a^2 + b^2 == 1
-float compute_max_saturation(float a, float b)
+template <typename Gamut>
+inline float compute_max_saturation(float a, float b)
 {
     // Max saturation will be when one of r, g or b goes below zero.
 
     // Select different coefficients depending on which component goes below zero first
-    float k0, k1, k2, k3, k4, wl, wm, ws;
-
-    if (-1.88170328f * a - 0.80936493f * b > 1)
-    {
-        // Red component
-        k0 = +1.19086277f; k1 = +1.76576728f; k2 = +0.59662641f; k3 = +0.75515197f; k4 = +0.56771245f;
-        wl = +4.0767416621f; wm = -3.3077115913f; ws = +0.2309699292f;
-    }
-    else if (1.81444104f * a - 1.19445276f * b > 1)
-    {
-        // Green component
-        k0 = +0.73956515f; k1 = -0.45954404f; k2 = +0.08285427f; k3 = +0.12541070f; k4 = +0.14503204f;
-        wl = -1.2684380046f; wm = +2.6097574011f; ws = -0.3413193965f;
-    }
-    else
-    {
-        // Blue component
-        k0 = +1.35733652f; k1 = -0.00915799f; k2 = -1.15130210f; k3 = -0.50559606f; k4 = +0.00692167f;
-        wl = -0.0041960863f; wm = -0.7034186147f; ws = +1.7076147010f;
-    }
+    constexpr auto const& select = Gamut::saturation_select;
+    int const component = (select[0][0] * a + select[0][1] * b > 1) ? 0 :  // Red
+        (select[1][0] * a + select[1][1] * b > 1) ? 1 :  // Green
+        2;  // Blue
+    float const* k = Gamut::saturation_coeffs[component];
+    float const wl = Gamut::from_lms[component][0];
+    float const wm = Gamut::from_lms[component][1];
+    float const ws = Gamut::from_lms[component][2];
 
     // Approximate max saturation using a polynomial:
-    float S = k0 + k1 * a + k2 * b + k3 * a * a + k4 * a * b;
+    float S = k[0] + k[1] * a + k[2] * b + k[3] * a * a + k[4] * a * b;
 
-    // Do one step Halley's method to get closer
-    // this gives an error less than 10e6, except for some blue hues where the dS/dh is close to infinite
-    // this should be sufficient for most applications, otherwise do two/three steps 
+    // Do Halley's method to get closer
+    // For sRGB, one step gives an error less than 10e6, except for some blue hues where the dS/dh is
+    // close to infinite; the other gamuts take more steps for a similar accuracy
 
     float k_l = +0.3963377774f * a + 0.2158037573f * b;
     float k_m = -0.1055613458f * a - 0.0638541728f * b;
     float k_s = -0.0894841775f * a - 1.2914855480f * b;
 
+    for (int step = 0; step < Gamut::saturation_steps; ++step)
     {
         float l_ = 1.f + S * k_l;
         float m_ = 1.f + S * k_m;
@@ -170,31 +240,178 @@ float compute_max_saturation(float a, float b)
     return S;
 }
 
+// As above, for the sRGB gamut
+inline float compute_max_saturation(float a, float b)
+{
+    return compute_max_saturation<SrgbGamut>(a, b);
+}
+
 // finds L_cusp and C_cusp for a given hue
 // a and b must be normalized so a^2 + b^2 == 1
 struct LC { float L; float C; };
-LC find_cusp(float a, float b)
+template <typename Gamut>
+inline LC find_cusp(float a, float b)
 {
 	// First, find the maximum saturation (saturation S = C/L)
-	float S_cusp = compute_max_saturation(a, b);
+	float S_cusp = compute_max_saturation<Gamut>(a, b);
 
-	// Convert to linear sRGB to find the first point where at least one of r,g or b >= 1:
-	RGB rgb_at_max = oklab_to_linear_displayP3({ 1, S_cusp * a, S_cusp * b });
+	// Convert to linear RGB to find the first point where at least one of r,g or b >= 1:
+	RGB rgb_at_max = oklab_to_linear_rgb<Gamut>({ 1, S_cusp * a, S_cusp * b });
 	float L_cusp = cbrtf(1.f / fmax(fmax(rgb_at_max.r, rgb_at_max.g), rgb_at_max.b));
 	float C_cusp = L_cusp * S_cusp;
 
 	return { L_cusp , C_cusp };
 }
 
+// As above, for the Display P3 gamut
+inline LC find_cusp(float a, float b) { return find_cusp<DisplayP3Gamut>(a, b); }
+
+// As above, for the sRGB gamut
+inline LC find_cusp_srgb(float a, float b) { return find_cusp<SrgbGamut>(a, b); }
+
+// Cusp provider that computes the cusp of a gamut exactly, with find_cusp.
+// Cusp providers are passed to the gamut clip functions to select how the cusp is found.
+template <typename Gamut = DisplayP3Gamut>
+struct ExactCusp
+{
+	LC operator()(float a, float b) const { return find_cusp<Gamut>(a, b); }
+};
+
+// Cusp provider that interpolates in a table of the cusp as a function of hue.
+//
+// The table is indexed by a "pseudo-angle" that increases monotonically with the hue angle,
+// but is cheaper to compute than atan2, and successive entries are interpolated linearly.
+// The exact cusp (as computed by find_cusp) is discontinuous at a few hues, where the
+// component limiting the saturation changes; the table records these discontinuities
+// (located by bisection) and does not interpolate across them. With the default size, the
+// difference from the exact cusp is below 1e-4 in L and C for 99.9% of hues (5e-5 for sRGB),
+// and below 7e-4 for all hues (1.5e-3 for Rec.2020), excepting those within floating-point
+// precision of a discontinuity, the largest errors being at the hues where the cusp has a kink.
+// The lookup is several times faster than find_cusp.
+class CuspTable
+{
+public:
+	// Tabulates the provided exact cusp function (e.g., ExactCusp<Gamut>) at size hues
+	template <typename ExactCuspFunction>
+	explicit CuspTable(ExactCuspFunction exact, std::size_t size = 4096)
+		: _scale(size/4.f), _table(size + 1), _jump(size, NO_JUMP)
+	{
+		for (std::size_t i = 0; i <= size; ++i)
+		{
+			_table[i] = _evaluate(exact, float(i)/_scale);
+		}
+		// Locate the discontinuities: where the interpolation misses the middle of a cell
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			float lo = float(i)/_scale, hi = float(i + 1)/_scale;
+			LC mid = _evaluate(exact, 0.5f*(lo + hi));
+			if (fabsf(mid.L - 0.5f*(_table[i].L + _table[i + 1].L)) < JUMP_THRESHOLD &&
+				fabsf(mid.C - 0.5f*(_table[i].C + _table[i + 1].C)) < JUMP_THRESHOLD)
+				continue;
+			for (int iter = 0; iter < 24; ++iter)
+			{
+				float p = 0.5f*(lo + hi);
+				LC value = _evaluate(exact, p);
+				if (fabsf(value.L - _table[i].L) < fabsf(value.L - _table[i + 1].L))
+					lo = p;
+				else
+					hi = p;
+			}
+			// The limits are evaluated a little way from the discontinuity, as the exact
+			// function can take intermediate values immediately next to it
+			float const offset = 1e-3f/_scale;
+			_jump[i] = _jumps.size();
+			_jumps.push_back({ 0.5f*(lo + hi)*_scale - i, _evaluate(exact, lo - offset),
+				_evaluate(exact, hi + offset) });
+		}
+	}
+
+	// Table for a gamut, built on first use
+	template <typename Gamut>
+	static CuspTable const& forGamut() { static CuspTable const table(ExactCusp<Gamut>{}); return table; }
+
+	static CuspTable const& displayP3() { return forGamut<DisplayP3Gamut>(); }
+	static CuspTable const& srgb() { return forGamut<SrgbGamut>(); }
+	static CuspTable const& rec2020() { return forGamut<Rec2020Gamut>(); }
+
+	// a and b must be normalized so a^2 + b^2 == 1; a NaN hue gives a NaN cusp
+	LC operator()(float a, float b) const
+	{
+		// Pseudo-angle in [0, 4), increasing with atan2(b, a) modulo 2 pi
+		float sum = fabsf(a) + fabsf(b);
+		float p;
+		if (b >= 0.f)
+			p = (a >= 0.f) ? b/sum : 1.f - a/sum;
+		else
+			p = (a < 0.f) ? 2.f - b/sum : 3.f + a/sum;
+
+		float x = p * _scale;
+		if (!std::isfinite(x))  // Converting to an integer would be undefined
+		{
+			float const nan = std::numeric_limits<float>::quiet_NaN();
+			return { nan, nan };
+		}
+		std::size_t i = std::min(std::size_t(x), _jump.size() - 1);
+		float w = x - i;
+		LC lo = _table[i];
+		LC hi = _table[i + 1];
+		if (_jump[i] != NO_JUMP)
+		{
+			// Interpolate only on the same side of the discontinuity
+			Jump const& jump = _jumps[_jump[i]];
+			if (w < jump.w)
+			{
+				hi = jump.left;
+				w = (jump.w > 0.f) ? w/jump.w : 0.f;
+			}
+			else
+			{
+				lo = jump.right;
+				w = (jump.w < 1.f) ? (w - jump.w)/(1.f - jump.w) : 1.f;
+			}
+		}
+		return { lo.L + w * (hi.L - lo.L), lo.C + w * (hi.C - lo.C) };
+	}
+
+private:
+	// A discontinuity within a table cell
+	struct Jump { float w; LC left; LC right; };  // position within cell, and limits on either side
+
+	static constexpr std::size_t NO_JUMP = static_cast<std::size_t>(-1);
+	static constexpr float JUMP_THRESHOLD = 1e-3f;
+
+	// Evaluate the exact cusp at a pseudo-angle
+	template <typename ExactCuspFunction>
+	static LC _evaluate(ExactCuspFunction exact, float p)
+	{
+		int quadrant = std::min(int(p), 3);
+		float f = p - quadrant;
+		float a, b;
+		switch (quadrant)
+		{
+			case 0: a = 1.f - f; b = f; break;
+			case 1: a = -f; b = 1.f - f; break;
+			case 2: a = f - 1.f; b = -f; break;
+			default: a = f; b = f - 1.f; break;
+		}
+		float norm = sqrtf(a*a + b*b);
+		return exact(a/norm, b/norm);
+	}
+
+	float _scale;  // Number of table entries per unit of pseudo-angle
+	std::vector<LC> _table;  // Cusp at equal intervals of pseudo-angle, with the first entry repeated
+	std::vector<std::size_t> _jump;  // Index into _jumps for each cell, or NO_JUMP
+	std::vector<Jump> _jumps;  // Discontinuities
+};
+
 // Finds intersection of the line defined by 
 // L = L0 * (1 - t) + t * L1;
 // C = t * C1;
 // a and b must be normalized so a^2 + b^2 == 1
-float find_gamut_intersection(float a, float b, float L1, float C1, float L0)
+// cusp must be find_cusp<Gamut>(a, b), for callers that need it anyway
+template <typename Gamut>
+inline float find_gamut_intersection(float a, float b, float L1, float C1, float L0, LC cusp)
 {
-	// Find the cusp of the gamut triangle
-	LC cusp = find_cusp(a, b);
-
 	// Find the intersection for upper and lower half seprately
 	float t;
 	if (((L1 - L0) * cusp.C - (cusp.L - L0) * C1) <= 0.f)
@@ -245,32 +462,22 @@ float find_gamut_intersection(float a, float b, float L1, float C1, float L0)
 				float mdt2 = 6 * m_dt * m_dt * m_;
 				float sdt2 = 6 * s_dt * s_dt * s_;
 
-				float r = 4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s - 1;
-				float r1 = 4.0767416621f * ldt - 3.3077115913f * mdt + 0.2309699292f * sdt;
-				float r2 = 4.0767416621f * ldt2 - 3.3077115913f * mdt2 + 0.2309699292f * sdt2;
-
-				float u_r = r1 / (r1 * r1 - 0.5f * r * r2);
-				float t_r = -r * u_r;
-
-				float g = -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s - 1;
-				float g1 = -1.2684380046f * ldt + 2.6097574011f * mdt - 0.3413193965f * sdt;
-				float g2 = -1.2684380046f * ldt2 + 2.6097574011f * mdt2 - 0.3413193965f * sdt2;
+				// Step towards where each component reaches 1, and take the first
+				constexpr auto const& M = Gamut::from_lms;
+				float t_min[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					float r = M[i][0] * l + M[i][1] * m + M[i][2] * s - 1;
+					float r1 = M[i][0] * ldt + M[i][1] * mdt + M[i][2] * sdt;
+					float r2 = M[i][0] * ldt2 + M[i][1] * mdt2 + M[i][2] * sdt2;
 
-				float u_g = g1 / (g1 * g1 - 0.5f * g * g2);
-				float t_g = -g * u_g;
+					float u_r = r1 / (r1 * r1 - 0.5f * r * r2);
+					float t_r = -r * u_r;
 
-				float b = -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s - 1;
-				float b1 = -0.0041960863f * ldt - 0.7034186147f * mdt + 1.7076147010f * sdt;
-				float b2 = -0.0041960863f * ldt2 - 0.7034186147f * mdt2 + 1.7076147010f * sdt2;
+					t_min[i] = u_r >= 0.f ? t_r : FLT_MAX;
+				}
 
-				float u_b = b1 / (b1 * b1 - 0.5f * b * b2);
-				float t_b = -b * u_b;
-
-				t_r = u_r >= 0.f ? t_r : FLT_MAX;
-				t_g = u_g >= 0.f ? t_g : FLT_MAX;
-				t_b = u_b >= 0.f ? t_b : FLT_MAX;
-
-				t += fmin(t_r, fmin(t_g, t_b));
+				t += fmin(t_min[0], fmin(t_min[1], t_min[2]));
 			}
 		}
 	}
@@ -278,7 +485,27 @@ float find_gamut_intersection(float a, float b, float L1, float C1, float L0)
 	return t;
 }
 
-float clamp(float x, float min, float max)
+template <typename Gamut>
+inline float find_gamut_intersection(float a, float b, float L1, float C1, float L0)
+{
+	// Find the cusp of the gamut triangle
+	LC cusp = find_cusp<Gamut>(a, b);
+
+	return find_gamut_intersection<Gamut>(a, b, L1, C1, L0, cusp);
+}
+
+// As above, for the Display P3 gamut
+inline float find_gamut_intersection(float a, float b, float L1, float C1, float L0, LC cusp)
+{
+	return find_gamut_intersection<DisplayP3Gamut>(a, b, L1, C1, L0, cusp);
+}
+
+inline float find_gamut_intersection(float a, float b, float L1, float C1, float L0)
+{
+	return find_gamut_intersection<DisplayP3Gamut>(a, b, L1, C1, L0);
+}
+
+inline float clamp(float x, float min, float max)
 {
 	if (x < min)
 		return min;
@@ -288,17 +515,18 @@ float clamp(float x, float min, float max)
 	return x;
 }
 
-float sgn(float x)
+inline float sgn(float x)
 {
 	return (float)(0.f < x) - (float)(x < 0.f);
 }
 
-RGB gamut_clip_preserve_chroma(RGB rgb)
+template <typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline RGB gamut_clip_preserve_chroma(RGB rgb, CuspProvider const& cusp_provider = CuspProvider())
 {
 	if (rgb.r < 1 && rgb.g < 1 && rgb.b < 1 && rgb.r > 0 && rgb.g > 0 && rgb.b > 0)
 		return rgb;
 
-	Lab lab = linear_displayP3_to_oklab(rgb);
+	Lab lab = linear_rgb_to_oklab<Gamut>(rgb);
 
 	float L = lab.L;
 	float eps = 0.00001f;
@@ -308,19 +536,20 @@ RGB gamut_clip_preserve_chroma(RGB rgb)
 
 	float L0 = clamp(L, 0, 1);
 
-	float t = find_gamut_intersection(a_, b_, L, C, L0);
+	float t = find_gamut_intersection<Gamut>(a_, b_, L, C, L0, cusp_provider(a_, b_));
 	float L_clipped = L0 * (1 - t) + t * L;
 	float C_clipped = t * C;
 
-	return oklab_to_linear_displayP3({ L_clipped, C_clipped * a_, C_clipped * b_ });
+	return oklab_to_linear_rgb<Gamut>({ L_clipped, C_clipped * a_, C_clipped * b_ });
 }
 
-RGB gamut_clip_project_to_0_5(RGB rgb)
+template <typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline RGB gamut_clip_project_to_0_5(RGB rgb, CuspProvider const& cusp_provider = CuspProvider())
 {
 	if (rgb.r < 1 && rgb.g < 1 && rgb.b < 1 && rgb.r > 0 && rgb.g > 0 && rgb.b > 0)
 		return rgb;
 
-	Lab lab = linear_displayP3_to_oklab(rgb);
+	Lab lab = linear_rgb_to_oklab<Gamut>(rgb);
 
 	float L = lab.L;
 	float eps = 0.00001f;
@@ -330,19 +559,20 @@ RGB gamut_clip_project_to_0_5(RGB rgb)
 
 	float L0 = 0.5;
 
-	float t = find_gamut_intersection(a_, b_, L, C, L0);
+	float t = find_gamut_intersection<Gamut>(a_, b_, L, C, L0, cusp_provider(a_, b_));
 	float L_clipped = L0 * (1 - t) + t * L;
 	float C_clipped = t * C;
 
-	return oklab_to_linear_displayP3({ L_clipped, C_clipped * a_, C_clipped * b_ });
+	return oklab_to_linear_rgb<Gamut>({ L_clipped, C_clipped * a_, C_clipped * b_ });
 }
 
-RGB gamut_clip_project_to_L_cusp(RGB rgb)
+template <typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline RGB gamut_clip_project_to_L_cusp(RGB rgb, CuspProvider const& cusp_provider = CuspProvider())
 {
 	if (rgb.r < 1 && rgb.g < 1 && rgb.b < 1 && rgb.r > 0 && rgb.g > 0 && rgb.b > 0)
 		return rgb;
 
-	Lab lab = linear_displayP3_to_oklab(rgb);
+	Lab lab = linear_rgb_to_oklab<Gamut>(rgb);
 
 	float L = lab.L;
 	float eps = 0.00001f;
@@ -350,25 +580,26 @@ RGB gamut_clip_project_to_L_cusp(RGB rgb)
 	float a_ = lab.a / C;
 	float b_ = lab.b / C;
 
-	// The cusp is computed here and in find_gamut_intersection, an optimized solution would only compute it once.
-	LC cusp = find_cusp(a_, b_);
+	LC cusp = cusp_provider(a_, b_);
 
 	float L0 = cusp.L;
 
-	float t = find_gamut_intersection(a_, b_, L, C, L0);
+	float t = find_gamut_intersection<Gamut>(a_, b_, L, C, L0, cusp);
 
 	float L_clipped = L0 * (1 - t) + t * L;
 	float C_clipped = t * C;
 
-	return oklab_to_linear_displayP3({ L_clipped, C_clipped * a_, C_clipped * b_ });
+	return oklab_to_linear_rgb<Gamut>({ L_clipped, C_clipped * a_, C_clipped * b_ });
 }
 
-RGB gamut_clip_adaptive_L0_0_5(RGB rgb, float alpha = 0.05f)
+template <typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline RGB gamut_clip_adaptive_L0_0_5(RGB rgb, float alpha = 0.05f,
+	CuspProvider const& cusp_provider = CuspProvider())
 {
 	if (rgb.r < 1 && rgb.g < 1 && rgb.b < 1 && rgb.r > 0 && rgb.g > 0 && rgb.b > 0)
 		return rgb;
 
-	Lab lab = linear_displayP3_to_oklab(rgb);
+	Lab lab = linear_rgb_to_oklab<Gamut>(rgb);
 
 	float L = lab.L;
 	float eps = 0.00001f;
@@ -380,19 +611,21 @@ RGB gamut_clip_adaptive_L0_0_5(RGB rgb, float alpha = 0.05f)
 	float e1 = 0.5f + fabs(Ld) + alpha * C;
 	float L0 = 0.5f*(1.f + sgn(Ld)*(e1 - sqrtf(e1*e1 - 2.f *fabs(Ld))));
 
-	float t = find_gamut_intersection(a_, b_, L, C, L0);
+	float t = find_gamut_intersection<Gamut>(a_, b_, L, C, L0, cusp_provider(a_, b_));
 	float L_clipped = L0 * (1.f - t) + t * L;
 	float C_clipped = t * C;
 
-	return oklab_to_linear_displayP3({ L_clipped, C_clipped * a_, C_clipped * b_ });
+	return oklab_to_linear_rgb<Gamut>({ L_clipped, C_clipped * a_, C_clipped * b_ });
 }
 
-RGB gamut_clip_adaptive_L0_L_cusp(RGB rgb, float alpha = 0.05f)
+template <typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline RGB gamut_clip_adaptive_L0_L_cusp(RGB rgb, float alpha = 0.05f,
+	CuspProvider const& cusp_provider = CuspProvider())
 {
 	if (rgb.r < 1 && rgb.g < 1 && rgb.b < 1 && rgb.r > 0 && rgb.g > 0 && rgb.b > 0)
 		return rgb;
 
-	Lab lab = linear_displayP3_to_oklab(rgb);
+	Lab lab = linear_rgb_to_oklab<Gamut>(rgb);
 
 	float L = lab.L;
 	float eps = 0.00001f;
@@ -400,8 +633,7 @@ RGB gamut_clip_adaptive_L0_L_cusp(RGB rgb, float alpha = 0.05f)
 	float a_ = lab.a / C;
 	float b_ = lab.b / C;
 
-	// The cusp is computed here and in find_gamut_intersection, an optimized solution would only compute it once.
-	LC cusp = find_cusp(a_, b_);
+	LC cusp = cusp_provider(a_, b_);
 
 	float Ld = L - cusp.L;
 	float k = 2.f * (Ld > 0 ? 1.f - cusp.L : cusp.L);
@@ -409,13 +641,109 @@ RGB gamut_clip_adaptive_L0_L_cusp(RGB rgb, float alpha = 0.05f)
 	float e1 = 0.5f*k + fabs(Ld) + alpha * C/k;
 	float L0 = cusp.L + 0.5f * (sgn(Ld) * (e1 - sqrtf(e1 * e1 - 2.f * k * fabs(Ld))));
 
-	float t = find_gamut_intersection(a_, b_, L, C, L0);
+	float t = find_gamut_intersection<Gamut>(a_, b_, L, C, L0, cusp);
 	float L_clipped = L0 * (1.f - t) + t * L;
 	float C_clipped = t * C;
 
-	return oklab_to_linear_displayP3({ L_clipped, C_clipped * a_, C_clipped * b_ });
+	return oklab_to_linear_rgb<Gamut>({ L_clipped, C_clipped * a_, C_clipped * b_ });
 }
 
+// Clips a color given in OKLab (rather than linear RGB) with the adaptive L0 towards L_cusp method,
+// without first testing whether it is in the gamut; the cusp is computed only once.
+// Gamut is the gamut to clip to, and T is the storage type (float or double); intermediate results are single precision.
+template <typename T, typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline void gamut_clip_lab_adaptive_L0_L_cusp(T L, T a, T b, T & L_out, T & a_out, T & b_out,
+	float alpha = 0.05f, CuspProvider const& cusp_provider = CuspProvider())
+{
+	T eps = T(0.00001);
+	float C = std::max(eps, std::sqrt(a*a + b*b));
+	float a_ = a / C;
+	float b_ = b / C;
+
+	LC cusp = cusp_provider(a_, b_);
+
+	float Ld = L - cusp.L;
+	float k = 2.f * (Ld > 0 ? 1.f - cusp.L : cusp.L);
+
+	float e1 = 0.5f*k + fabs(Ld) + alpha * C/k;
+	float L0 = cusp.L + 0.5f * (sgn(Ld) * (e1 - sqrtf(e1 * e1 - 2.f * k * fabs(Ld))));
+
+	float t = find_gamut_intersection<Gamut>(a_, b_, L, C, L0, cusp);
+	float L_clipped = L0 * (1.f - t) + t * L;
+	float C_clipped = t * C;
+
+	L_out = L_clipped;
+	a_out = C_clipped * a_;
+	b_out = C_clipped * b_;
 }
+
+// Batch version of the above, for n colors.
+// The components of color i are read from L[i*in_stride], a[i*in_stride] and b[i*in_stride], and
+// written to L_out[i*out_stride], etc., so both interleaved (stride 3) and planar (stride 1)
+// buffers are supported. The output may be the same as the input.
+template <typename T, typename Gamut = DisplayP3Gamut, typename CuspProvider = ExactCusp<Gamut>>
+inline void gamut_clip_lab_adaptive_L0_L_cusp(std::size_t n,
+	T const* L, T const* a, T const* b, std::ptrdiff_t in_stride,
+	T * L_out, T * a_out, T * b_out, std::ptrdiff_t out_stride,
+	float alpha = 0.05f, CuspProvider const& cusp_provider = CuspProvider())
+{
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		std::ptrdiff_t const in = i * in_stride;
+		std::ptrdiff_t const out = i * out_stride;
+		gamut_clip_lab_adaptive_L0_L_cusp<T, Gamut>(L[in], a[in], b[in], L_out[out], a_out[out], b_out[out], alpha,
+			cusp_provider);
+	}
 }
+
+// The sRGB transfer function (from linear to encoded values), which is also used by Display P3
+inline float srgb_transfer_function(float a) { return SrgbGamut::transfer_function(a); }
+
+// Quantizes a value in [0, 1] to the full range of an unsigned integer type, rounding to nearest.
+// Values outside that range are clamped, and NaN is mapped to zero.
+template <typename Out>
+inline Out quantize(float x)
+{
+	x = x > 0.f ? (x < 1.f ? x : 1.f) : 0.f;
+	return static_cast<Out>(x * float(std::numeric_limits<Out>::max()) + 0.5f);
+}
+
+// Converts n linear RGB colors to encoded, quantized RGB for display, in a single pass:
+// out-of-gamut colors are clipped with gamut_clip_adaptive_L0_L_cusp, then the gamut's transfer function
+// is applied and the result quantized to Out (e.g., uint8_t or uint16_t).
+// The components of color i are read from r[i*in_stride], g[i*in_stride] and b[i*in_stride], and
+// written to r_out[i*out_stride], etc.
+template <typename Gamut, typename Out, typename In, typename CuspProvider = ExactCusp<Gamut>>
+inline void linear_rgb_to_display(std::size_t n,
+	In const* r, In const* g, In const* b, std::ptrdiff_t in_stride,
+	Out * r_out, Out * g_out, Out * b_out, std::ptrdiff_t out_stride,
+	float alpha = 0.05f, CuspProvider const& cusp_provider = CuspProvider())
+{
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		std::ptrdiff_t const in = i * in_stride;
+		std::ptrdiff_t const out = i * out_stride;
+		RGB rgb = gamut_clip_adaptive_L0_L_cusp<Gamut>({ float(r[in]), float(g[in]), float(b[in]) }, alpha,
+			cusp_provider);
+		r_out[out] = quantize<Out>(Gamut::transfer_function(rgb.r));
+		g_out[out] = quantize<Out>(Gamut::transfer_function(rgb.g));
+		b_out[out] = quantize<Out>(Gamut::transfer_function(rgb.b));
+	}
 }
+
+// As above, for Display P3
+template <typename Out, typename In, typename CuspProvider = ExactCusp<DisplayP3Gamut>>
+inline void linear_displayP3_to_display(std::size_t n,
+	In const* r, In const* g, In const* b, std::ptrdiff_t in_stride,
+	Out * r_out, Out * g_out, Out * b_out, std::ptrdiff_t out_stride,
+	float alpha = 0.05f, CuspProvider const& cusp_provider = CuspProvider())
+{
+	linear_rgb_to_display<DisplayP3Gamut>(n, r, g, b, in_stride, r_out, g_out, b_out, out_stride, alpha,
+		cusp_provider);
+}
+
+}
+}
+}
+
+#endif // LSST_CPPUTILS_OKLABTOOLS_H
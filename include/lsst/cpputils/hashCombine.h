@@ -22,7 +22,14 @@
 #ifndef LSST_CPPUTILS_HASH_COMBINE_H
 #define LSST_CPPUTILS_HASH_COMBINE_H
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace lsst {
 namespace cpputils {
@@ -60,7 +67,7 @@ inline std::size_t hashCombine(std::size_t seed) noexcept { return seed; }
 // Algorithm described at https://stackoverflow.com/a/27952689
 // WARNING: should not be inline or constexpr; it can cause instantiation-order problems with std::hash<T>
 template <typename T, typename... Rest>
-std::size_t hashCombine(std::size_t seed, const T& value, Rest... rest) noexcept {
+std::size_t hashCombine(std::size_t seed, const T& value, const Rest&... rest) noexcept {
     std::hash<T> hasher;
     seed ^= hasher(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
     return hashCombine(seed, rest...);
@@ -91,13 +98,274 @@ std::size_t hashCombine(std::size_t seed, const T& value, Rest... rest) noexcept
 // WARNING: should not be inline or constexpr; it can cause instantiation-order problems with std::hash<T>
 template <typename InputIterator>
 std::size_t hashIterable(std::size_t seed, InputIterator begin, InputIterator end) noexcept {
-    std::size_t result = 0;
+    std::size_t result = seed;
     for (; begin != end; ++begin) {
         result = hashCombine(result, *begin);
     }
     return result;
 }
 
+/**
+ * Mix the bits of a 64-bit value.
+ *
+ * This is the finalizer of the SplitMix64 generator: a bijection in which
+ * every input bit affects every output bit, so it turns values with
+ * poor distribution (e.g., small or sequential integers, or the result of
+ * an identity `std::hash`) into well-distributed hashes.
+ *
+ * @exceptsafe Shall not throw exceptions.
+ */
+constexpr std::uint64_t hashMix(std::uint64_t value) noexcept {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+namespace detail {
+
+// Arbitrary odd constants with balanced bits (those of wyhash)
+constexpr std::uint64_t HASH_SECRET[4] = {0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+                                          0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL};
+
+// Fold the 128-bit product of two values into 64 bits
+inline std::uint64_t hashMum(std::uint64_t a, std::uint64_t b) noexcept {
+#ifdef __SIZEOF_INT128__
+    __uint128_t const product = static_cast<__uint128_t>(a)*b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#else
+    std::uint64_t const aHi = a >> 32, aLo = a & 0xffffffffULL;
+    std::uint64_t const bHi = b >> 32, bLo = b & 0xffffffffULL;
+    std::uint64_t const hh = aHi*bHi, hl = aHi*bLo, lh = aLo*bHi, ll = aLo*bLo;
+    std::uint64_t const middle = (ll >> 32) + (hl & 0xffffffffULL) + (lh & 0xffffffffULL);
+    std::uint64_t const lo = (middle << 32) | (ll & 0xffffffffULL);
+    std::uint64_t const hi = hh + (hl >> 32) + (lh >> 32) + (middle >> 32);
+    return lo ^ hi;
+#endif
+}
+
+inline std::uint64_t hashRead64(unsigned char const* p) noexcept {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline std::uint64_t hashRead32(unsigned char const* p) noexcept {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+template <typename T, typename = void>
+struct IsContiguousRange : std::false_type {};
+
+template <typename T>
+struct IsContiguousRange<T, std::void_t<decltype(std::declval<T const&>().data()),
+                                         decltype(std::declval<T const&>().size())>>
+        : std::is_pointer<decltype(std::declval<T const&>().data())> {};
+
+template <typename T, typename = void>
+struct IsRange : std::false_type {};
+
+template <typename T>
+struct IsRange<T, std::void_t<decltype(std::begin(std::declval<T const&>())),
+                               decltype(std::end(std::declval<T const&>()))>> : std::true_type {};
+
+template <typename T, typename = void>
+struct IsTupleLike : std::false_type {};
+
+template <typename T>
+struct IsTupleLike<T, std::void_t<decltype(std::tuple_size<T>::value)>> : std::true_type {};
+
+// Can a value of this type be hashed through its bytes, consistently with operator==?
+template <typename T>
+constexpr bool isHashableAsBytes =
+        std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>;
+
+}  // namespace detail
+
+/**
+ * Hash a contiguous block of memory.
+ *
+ * The algorithm is that of wyhash: 16 bytes are folded into the state per
+ * step by a 64x64->128-bit multiplication, which is much faster than
+ * combining bytes or elements one at a time.  Hashes depend on the
+ * platform's endianness, so they should not be persisted.
+ *
+ * @param data, size The memory to hash.
+ * @param seed An arbitrary starting value.
+ * @returns A hash of the `size` bytes starting at `data`.
+ *
+ * @exceptsafe Shall not throw exceptions.
+ */
+inline std::uint64_t hashBytes(void const* data, std::size_t size, std::uint64_t seed = 0) noexcept {
+    using namespace detail;
+    auto p = static_cast<unsigned char const*>(data);
+    std::uint64_t state = seed ^ hashMum(seed ^ HASH_SECRET[0], HASH_SECRET[1]);
+    std::size_t remaining = size;
+    for (; remaining > 16; remaining -= 16, p += 16) {
+        state = hashMum(hashRead64(p) ^ HASH_SECRET[1], hashRead64(p + 8) ^ state);
+    }
+    // Last 1-16 bytes, as two possibly overlapping words (which are distinguished by the size)
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+    if (remaining >= 8) {
+        a = hashRead64(p);
+        b = hashRead64(p + remaining - 8);
+    } else if (remaining >= 4) {
+        a = hashRead32(p);
+        b = hashRead32(p + remaining - 4);
+    } else if (remaining > 0) {
+        a = (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[remaining/2]) << 8) | p[remaining - 1];
+    }
+    return hashMum(HASH_SECRET[1] ^ size, hashMum(a ^ HASH_SECRET[1], b ^ state));
+}
+
+/**
+ * A fast, well-distributed hash function object.
+ *
+ * FastHash can be used in place of `std::hash` wherever a hasher is
+ * expected, e.g. as the `KeyHash` of a `Cache` or `std::unordered_map`:
+ *
+ *     Cache<std::tuple<int, int, long>, Value, FastHash<std::tuple<int, int, long>>> cache(1000);
+ *
+ * Arithmetic, enum and pointer values are mixed with hashMix (so, unlike
+ * with the identity `std::hash<int>` of libstdc++, sequential keys do not
+ * fall in sequential buckets); strings and contiguous containers of
+ * trivially-copyable values without padding are hashed as a block with
+ * hashBytes; other containers, `std::pair` and `std::tuple` are hashed by
+ * combining the hashes of their elements with fastHashCombine; and any
+ * other type is hashed by mixing the result of its `std::hash`.
+ *
+ * @tparam T the type to hash.
+ */
+template <typename T>
+struct FastHash {
+    std::size_t operator()(T const& value) const noexcept;
+};
+
+namespace detail {
+
+// The value to combine into a hash for `value`: integers need not be mixed first, as combining does that
+template <typename T>
+std::uint64_t fastHashInput(T const& value) noexcept {
+    if constexpr (std::is_integral_v<T>) {
+        return static_cast<std::uint64_t>(value);
+    } else {
+        return FastHash<std::remove_cv_t<T>>()(value);
+    }
+}
+
+}  // namespace detail
+
+/**
+ * Combine fast hashes
+ *
+ * Like hashCombine, but hashing each argument with FastHash and mixing the
+ * results with a 64-bit multiply, which is much better distributed than the
+ * boost-style `0x9e3779b9` mix.
+ *
+ * @param seed An arbitrary starting value.
+ * @param values The objects to hash.
+ * @returns A combined hash for all the arguments after `seed`.
+ *
+ * @exceptsafe Shall not throw exceptions.
+ */
+template <typename... T>
+std::size_t fastHashCombine(std::size_t seed, T const&... values) noexcept {
+    std::uint64_t state = seed;
+    ((state = detail::hashMum(state ^ detail::HASH_SECRET[2],
+                              detail::fastHashInput(values) ^ detail::HASH_SECRET[3])),
+     ...);
+    return state;
+}
+
+/**
+ * Combine fast hashes of the elements of a contiguous array.
+ *
+ * If the elements can be compared through their bytes (e.g., integers and
+ * structs of them without padding), the whole array is hashed as a block;
+ * otherwise, the elements are combined one at a time.
+ *
+ * @param seed An arbitrary starting value.
+ * @param data, size The array to hash.
+ * @returns A combined hash for the `size` elements starting at `data`.
+ *
+ * @exceptsafe Shall not throw exceptions.
+ */
+template <typename T>
+std::size_t fastHashRange(std::size_t seed, T const* data, std::size_t size) noexcept {
+    if constexpr (detail::isHashableAsBytes<T>) {
+        return hashBytes(data, size*sizeof(T), seed);
+    } else {
+        std::size_t result = fastHashCombine(seed, size);
+        for (std::size_t i = 0; i < size; ++i) {
+            result = fastHashCombine(result, data[i]);
+        }
+        return result;
+    }
+}
+
+/**
+ * Combine fast hashes in an iterable.
+ *
+ * Like hashIterable, but with FastHash and fastHashCombine; ranges given
+ * by pointers are hashed with fastHashRange.
+ *
+ * @param seed An arbitrary starting value.
+ * @param begin, end The range to hash.
+ * @returns A combined hash for all the elements in [begin, end).
+ *
+ * @exceptsafe Shall not throw exceptions.
+ */
+template <typename InputIterator>
+std::size_t fastHashIterable(std::size_t seed, InputIterator begin, InputIterator end) noexcept {
+    if constexpr (std::is_pointer_v<InputIterator>) {
+        return fastHashRange(seed, begin, static_cast<std::size_t>(end - begin));
+    } else {
+        std::size_t result = seed;
+        for (; begin != end; ++begin) {
+            result = fastHashCombine(result, *begin);
+        }
+        return result;
+    }
+}
+
+template <typename T>
+std::size_t FastHash<T>::operator()(T const& value) const noexcept {
+    if constexpr (std::is_enum_v<T>) {
+        return hashMix(static_cast<std::uint64_t>(static_cast<std::underlying_type_t<T>>(value)));
+    } else if constexpr (std::is_integral_v<T>) {
+        return hashMix(static_cast<std::uint64_t>(value));
+    } else if constexpr (std::is_pointer_v<T>) {
+        return hashMix(reinterpret_cast<std::uintptr_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        // 0.0 == -0.0, so both must have the same hash; long double has padding, so it is hashed as a double
+        if (value == 0) {
+            return hashMix(0);
+        } else if constexpr (sizeof(T) <= sizeof(std::uint64_t)) {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(T));
+            return hashMix(bits);
+        } else {
+            return FastHash<double>()(static_cast<double>(value));
+        }
+    } else if constexpr (std::is_convertible_v<T const&, std::string_view>) {
+        std::string_view const view = value;
+        return hashBytes(view.data(), view.size());
+    } else if constexpr (detail::IsContiguousRange<T>::value) {
+        return fastHashRange(0, value.data(), value.size());
+    } else if constexpr (detail::IsRange<T>::value) {
+        return fastHashIterable(0, std::begin(value), std::end(value));
+    } else if constexpr (detail::IsTupleLike<T>::value) {
+        return std::apply([](auto const&... elements) { return fastHashCombine(0, elements...); }, value);
+    } else {
+        return hashMix(std::hash<T>()(value));
+    }
+}
+
 }
 } // namespace lsst::cpputils
 
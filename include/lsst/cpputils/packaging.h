@@ -25,7 +25,14 @@
 #ifndef LSST_CPPUTILS_PACKAGING_H
 #define LSST_CPPUTILS_PACKAGING_H
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace lsst {
 namespace cpputils {
@@ -39,6 +46,71 @@ namespace cpputils {
  */
 std::string getPackageDir(std::string const& packageName);
 
+/*!
+ * \brief Resolve the root directories of setup packages from a snapshot of the environment
+ *
+ * The `*_DIR` environment variables are read once, by the constructor or by
+ * refresh(), into an immutable table; lookups (like getPackageDir, the
+ * package name is upper-cased to find the variable) then neither read the
+ * environment nor allocate memory, and are safe to call concurrently with
+ * each other and with refresh(). Changes to the environment are only seen
+ * after refresh().
+ */
+class PackageDirResolver final {
+public:
+    /// Snapshot the current environment
+    PackageDirResolver();
+
+    PackageDirResolver(PackageDirResolver const&) = delete;
+    PackageDirResolver& operator=(PackageDirResolver const&) = delete;
+
+    /// Get a process-wide resolver, created on first use
+    static PackageDirResolver& get();
+
+    /// Snapshot the environment again
+    void refresh();
+
+    /*!
+     * \brief Return the root directory of a setup package, or an empty view if it is not setup
+     *
+     * The view remains valid for the lifetime of the resolver, even across calls to refresh().
+     */
+    std::string_view find(std::string_view packageName) const noexcept;
+
+    /*!
+     * \brief Return the root directory of a setup package
+     *
+     * \throw lsst::pex::exceptions::NotFoundError if the package is not setup
+     */
+    std::string getPackageDir(std::string_view packageName) const;
+
+    /*!
+     * \brief Return the root directories of several setup packages, from the same snapshot
+     *
+     * \throw lsst::pex::exceptions::NotFoundError (naming all such packages) if any package is not setup
+     */
+    std::vector<std::string> getPackageDirs(std::vector<std::string> const& packageNames) const;
+
+private:
+    // Case-insensitive (ASCII) hash and comparison, so lookups need not upper-case the name
+    struct UpperHash {
+        std::size_t operator()(std::string_view str) const noexcept;
+    };
+    struct UpperEqual {
+        bool operator()(std::string_view a, std::string_view b) const noexcept;
+    };
+
+    // Package directories, keyed by the upper-case package name; the views point into storage
+    struct Snapshot {
+        std::vector<std::string> storage;
+        std::unordered_map<std::string_view, std::string_view, UpperHash, UpperEqual> dirs;
+    };
+
+    std::atomic<Snapshot const*> _current;  // Snapshot used for lookups
+    std::vector<std::unique_ptr<Snapshot const>> _snapshots;  // All snapshots, kept so views stay valid
+    std::mutex _mutex;  // Serializes refresh
+};
+
 }
 } // namespace lsst::cpputils
 
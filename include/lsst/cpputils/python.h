@@ -26,18 +26,27 @@
 
 #include "pybind11/pybind11.h"
 
+#include <chrono>
 #include <cstddef>
+#include <cstdlib>
+#include <exception>
 #include <memory>
 #include <string>
 #include <sstream>
 #include <utility>
 #include <list>
+#include <map>
+#include <vector>
 #include <functional>
 
 #include <iostream>
 
 #include "lsst/pex/exceptions.h"
 #include "lsst/pex/exceptions/python/Exception.h"
+#include "lsst/cpputils/Instrumentation.h"
+#include "lsst/cpputils/ThreadPool.h"
+#include "lsst/cpputils/python/ArrayView.h"
+#include "lsst/cpputils/python/WrapperInstrumentation.h"
 
 namespace lsst {
 namespace cpputils {
@@ -160,6 +169,34 @@ inline std::pair<std::size_t, std::size_t> cppIndex(std::ptrdiff_t size_i, std::
     }
 }
 
+/**
+Call `func(chunkBegin, chunkEnd)` over chunks of `[begin, end)` in parallel, without the GIL.
+
+This is `lsst::cpputils::parallelFor` on the default pool, with the GIL released for the parallel
+region.  An exception thrown by `func` on any thread is rethrown in the caller once the GIL has been
+reacquired, so a `pex::exceptions` exception reaches Python as its Python equivalent, exactly as if
+the wrapped function had thrown it itself.
+
+@param[in] begin, end  Range of indices.
+@param[in] grain  Minimum number of indices worth handing to a thread.
+@param[in] func  Function called for each chunk; it must not use Python objects.
+*/
+template <typename Function>
+void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Function func) {
+    std::exception_ptr error;
+    {
+        pybind11::gil_scoped_release release;
+        try {
+            lsst::cpputils::parallelFor(begin, end, grain, std::move(func));
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 /**
  * A helper class for subdividing pybind11 module across multiple translation
  * units (i.e. source files).
@@ -238,6 +275,31 @@ inline std::pair<std::size_t, std::size_t> cppIndex(std::ptrdiff_t size_i, std::
  *
  * Note that we recommend the use of universal lambdas (i.e. `auto &`
  * parameters) to reduce verbosity.
+ *
+ * The time taken by each deferred callable (and by each signature
+ * dependency import) is recorded when it is run, and published as a list of
+ * `(label, seconds)` tuples in the `__wrapper_timings__` attribute of the
+ * module whose definitions were run; see also getTimings().  This makes it
+ * possible to see which wrappers dominate the import time of a module.
+ *
+ * Calls to selected functions can also be counted and timed, both through
+ * their Python binding (with instrument()) and in C++ (with timed()), to
+ * tell the overhead of the binding from the work done in C++.  This
+ * instrumentation is disabled by default; it is enabled by
+ * enableInstrumentation() or by setting the `LSST_CPPUTILS_INSTRUMENT_WRAPPERS`
+ * environment variable to a value other than "0" before the module is
+ * imported.  Measurements for a module and its submodules are returned as a
+ * dict by its `__wrapper_instrumentation__()` function; see
+ * WrapperInstrumentation::toDict.
+ * @code
+ * wrappers.wrapType(
+ *     py::class_<ClassA>(wrappers.module, "ClassA"),
+ *     [timedMethod=wrappers.timed("mypackage.ClassA.method", &ClassA::method)](auto & mod, auto & cls) {
+ *         cls.def("method", timedMethod);
+ *     }
+ * );
+ * wrappers.instrument(wrappers.module.attr("ClassA"), "method", "mypackage.ClassA.method");
+ * @endcode
  */
 class LSST_PRIVATE WrapperCollection final {
     // LSST_PRIVATE above: don't export symbols used only in pybind11 wrappers
@@ -246,6 +308,9 @@ public:
     /// Function handle type used to hold deferred wrapper declaration functions.
     using WrapperCallback = std::function<void(pybind11::module &)>;
 
+    /// Label and duration (in seconds) of a deferred wrapper declaration or dependency import.
+    using Timing = WrapperInstrumentation::Timing;
+
     /**
      * Construct a new WrapperCollection.
      *
@@ -263,7 +328,8 @@ public:
      */
     explicit WrapperCollection(pybind11::module module_, std::string const & package) :
         module(module_),
-        _package(package)
+        _package(package),
+        _instrumentation(std::make_shared<WrapperInstrumentation>(_isInstrumentationRequested()))
     {}
 
     // WrapperCollection is move-contructable.
@@ -271,7 +337,13 @@ public:
         module(std::move(other.module)),
         _package(std::move(other._package)),
         _dependencies(std::move(other._dependencies)),
-        _definitions(std::move(other._definitions))
+        _definitions(std::move(other._definitions)),
+        _name(std::move(other._name)),
+        _lazy(other._lazy),
+        _lazySubmodules(std::move(other._lazySubmodules)),
+        _timings(std::move(other._timings)),
+        _instrumented(std::move(other._instrumented)),
+        _instrumentation(std::move(other._instrumentation))
     {}
 
     // WrapperCollection is not copyable or assignable.
@@ -296,6 +368,8 @@ public:
      * WrapperCollection's finish() method is called.
      *
      * @param  name  Relative name of the submodule.
+     * @param  lazy  If true, defer the submodule's definitions until it is
+     *               first used instead; see below.
      *
      * Attributes added to the returned WrapperCollection will actually be put
      * in a submodule that adds an underscore prefix to ``name``, with
@@ -312,23 +386,72 @@ public:
      *
      *     from .._package._submodule import *
      *
+     * A lazy submodule is materialized (its signature dependencies imported
+     * and its deferred definitions executed) when it is first looked up as
+     * an attribute of the parent (e.g. ``_package._submodule``), or when an
+     * attribute of the submodule is first looked up, by module-level
+     * ``__getattr__`` functions (PEP 562) installed on both. The submodule
+     * stays in ``sys.modules``, so it can also be reached through the import
+     * system: ``import package._package._submodule`` does not materialize it
+     * by itself, but ``from .._package._submodule import *`` does. Types
+     * declared with wrapType are still registered immediately, but cannot be
+     * reached from Python until the submodule is materialized. Lifting a lazy
+     * submodule in ``__init__.py`` as shown above therefore materializes it
+     * at import time; to keep the savings, look it up only where needed
+     * (e.g. from a ``__getattr__`` in ``__init__.py``).
+     *
      * @return a new WrapperCollection instance that sets the `__module__`
      *         of any classes added to it to `{package}.{name}`.
      */
-    WrapperCollection makeSubmodule(std::string const & name) {
-        return WrapperCollection(module.def_submodule(("_" + name).c_str()), _package + "." + name);
+    WrapperCollection makeSubmodule(std::string const & name, bool lazy=false) {
+        std::string const attrName = "_" + name;
+        WrapperCollection result(module.def_submodule(attrName.c_str()), _package + "." + name);
+        result._name = attrName;
+        result._instrumentation = _instrumentation;
+        if (lazy) {
+            // Hidden from the parent (but not from sys.modules) until it is materialized
+            pybind11::delattr(module, attrName.c_str());
+            result._lazy = true;
+        }
+        return result;
     }
 
     /**
      * Merge deferred definitions in the given submodule into the parent
      * WrapperCollection.
      *
+     * If the submodule was created with `lazy=true`, its definitions are
+     * instead held until the submodule is first looked up in this
+     * collection's module, and are not run by finish().
+     *
      * @param submodule  A WrapperCollection created by makeSubmodule.
      *                   Will be consumed (and must be an rvalue).
      */
     void collectSubmodule(WrapperCollection && submodule) {
-        _dependencies.splice(_dependencies.end(), submodule._dependencies);
-        _definitions.splice(_definitions.end(), submodule._definitions);
+        if (!submodule._lazy) {
+            _dependencies.splice(_dependencies.end(), submodule._dependencies);
+            _definitions.splice(_definitions.end(), submodule._definitions);
+            _instrumented.splice(_instrumented.end(), submodule._instrumented);
+            return;
+        }
+        if (!_lazySubmodules) {
+            _lazySubmodules = std::make_shared<std::map<std::string, LazySubmodule>>();
+            _installLazyLookup();
+        }
+        LazySubmodule & lazy = (*_lazySubmodules)[submodule._name];
+        lazy.module = submodule.module;
+        lazy.dependencies.splice(lazy.dependencies.end(), submodule._dependencies);
+        lazy.definitions.splice(lazy.definitions.end(), submodule._definitions);
+        lazy.instrumented.splice(lazy.instrumented.end(), submodule._instrumented);
+        // Materialize on the first lookup of an attribute of the submodule itself (e.g. from an import)
+        submodule.module.attr("__getattr__") = pybind11::cpp_function(
+            [parent=module, sub=submodule.module, lazySubmodules=_lazySubmodules,
+             instrumentation=_instrumentation, name=submodule._name](std::string const & attr) -> pybind11::object {
+                _materialize(parent, *lazySubmodules, name, instrumentation);
+                return sub.attr(attr.c_str());
+            },
+            pybind11::arg("name")
+        );
     }
 
     /**
@@ -365,9 +488,11 @@ public:
      *                     `pybind11::module` argument (by reference) and
      *                     adds pybind11 wrappers to it, to be called later
      *                     by `finish()`.
+     * @param[in] label    Name under which the time taken by `function` is
+     *                     recorded; defaults to the package name.
      */
-    void wrap(WrapperCallback function) {
-        _definitions.emplace_back(std::make_pair(module, function));
+    void wrap(WrapperCallback function, std::string const & label=std::string()) {
+        _definitions.push_back(Definition{module, label.empty() ? _package : label, std::move(function)});
     }
 
     /**
@@ -392,11 +517,13 @@ public:
         if (setModuleName) {
             cls.attr("__module__") = _package;
         }
+        std::string const label = _package + "." + cls.attr("__name__").template cast<std::string>();
         // lambda below is mutable so it can modify the captured `cls` variable
         wrap(
             [cls=cls, function=std::move(function)] (pybind11::module & mod) mutable -> void {
                 function(mod, cls);
-            }
+            },
+            label
         );
         return cls;
     }
@@ -433,12 +560,107 @@ public:
      * `PYBIND11_MODULE` block.
      */
     void finish() {
-        for (auto dep = _dependencies.begin(); dep != _dependencies.end(); dep = _dependencies.erase(dep)) {
-            pybind11::module::import(dep->c_str());
-        }
-        for (auto def = _definitions.begin(); def != _definitions.end(); def = _definitions.erase(def)) {
-            (def->second)(def->first);  // WrapperCallback(module)
+        _timings = _runDefinitions(module, _dependencies, _definitions, _instrumented, _instrumentation);
+        module.attr("__wrapper_instrumentation__") = pybind11::cpp_function(
+            [instrumentation=_instrumentation]() { return instrumentation->toDict(); },
+            pybind11::doc("Return the import timings and call counters of this module as a dict.")
+        );
+    }
+
+    /**
+     * Return the time taken by each dependency import and deferred
+     * definition run by finish(), in order.
+     *
+     * Definitions of lazy submodules are not included; their timings are
+     * only available from the `__wrapper_timings__` attribute of the
+     * submodule once it has been materialized.
+     */
+    std::vector<Timing> const & getTimings() const noexcept { return _timings; }
+
+    /**
+     * Enable or disable the instrumentation of function calls.
+     *
+     * This affects subsequent calls to instrument() and timed() on this
+     * WrapperCollection and on all other collections for the same module
+     * and its submodules.
+     */
+    void enableInstrumentation(bool enable=true) noexcept { _instrumentation->setEnabled(enable); }
+
+    /// Is the instrumentation of function calls enabled?
+    bool isInstrumented() const noexcept { return _instrumentation->isEnabled(); }
+
+    /**
+     * Count and time calls to a function through its Python binding.
+     *
+     * The attribute is replaced by a wrapper after all deferred definitions have
+     * been run, so it need not exist yet.  The time recorded includes the
+     * conversion of arguments and return values by pybind11, but not the
+     * overhead of the wrapper itself.  Does nothing if instrumentation is
+     * disabled when the definitions are run.
+     *
+     * @param[in] owner  Module or class with the function as an attribute.
+     * @param[in] name   Name of the function (a free function, or an
+     *                   instance or static method).
+     * @param[in] label  Name under which calls are recorded; defaults to
+     *                   `{package}.{name}` for a module and to
+     *                   `{package}.{class}.{name}` for a class.
+     *
+     * @throws lsst::pex::exceptions::InvalidParameterError Thrown when the
+     *     definitions are run if the attribute is not a function.
+     */
+    void instrument(pybind11::object owner, std::string const & name,
+                    std::string const & label=std::string()) {
+        std::string fullLabel = label;
+        if (fullLabel.empty()) {
+            fullLabel = _package + ".";
+            if (!pybind11::isinstance<pybind11::module>(owner)) {
+                fullLabel += owner.attr("__name__").cast<std::string>() + ".";
+            }
+            fullLabel += name;
         }
+        _instrumented.push_back(Instrumented{std::move(owner), name, std::move(fullLabel)});
+    }
+
+    /**
+     * Return a callable that calls a C++ function, counting and timing
+     * the calls.
+     *
+     * The callable has the same signature as `function` (with an explicit
+     * first argument for the object, if it is a member function), so it can
+     * be wrapped in its place.  If instrumentation is disabled, the calls are
+     * not recorded.
+     *
+     * @param[in] label     Name under which calls are recorded; to compare
+     *                      with the time spent in the Python binding, use
+     *                      the label passed to instrument().
+     * @param[in] function  Function or member function pointer.
+     */
+    template <typename R, typename ...Args>
+    auto timed(std::string const & label, R (*function)(Args...)) const {
+        return [function, counter=_getBodyCounter(label), keepAlive=_instrumentation](Args... args) -> R {
+            detail::CallTimer timer(counter);
+            return function(std::forward<Args>(args)...);
+        };
+    }
+
+    /// @copydoc timed
+    template <typename R, typename Class, typename ...Args>
+    auto timed(std::string const & label, R (Class::*function)(Args...)) const {
+        return [function, counter=_getBodyCounter(label), keepAlive=_instrumentation](
+                Class & self, Args... args) -> R {
+            detail::CallTimer timer(counter);
+            return (self.*function)(std::forward<Args>(args)...);
+        };
+    }
+
+    /// @copydoc timed
+    template <typename R, typename Class, typename ...Args>
+    auto timed(std::string const & label, R (Class::*function)(Args...) const) const {
+        return [function, counter=_getBodyCounter(label), keepAlive=_instrumentation](
+                Class const & self, Args... args) -> R {
+            detail::CallTimer timer(counter);
+            return (self.*function)(std::forward<Args>(args)...);
+        };
     }
 
     /**
@@ -448,9 +670,158 @@ public:
     pybind11::module module;
 
 private:
+    // A deferred wrapper declaration, with the module to pass it
+    struct Definition {
+        pybind11::module module;
+        std::string label;
+        WrapperCallback callback;
+    };
+
+    // A function to instrument once the definitions have been run
+    struct Instrumented {
+        pybind11::object owner;
+        std::string name;
+        std::string label;
+    };
+
+    // Deferred state of a lazy submodule, held until it is first looked up
+    struct LazySubmodule {
+        pybind11::module module;
+        std::list<std::string> dependencies;
+        std::list<Definition> definitions;
+        std::list<Instrumented> instrumented;
+    };
+
+    static bool _isInstrumentationRequested() noexcept {
+        char const * value = std::getenv("LSST_CPPUTILS_INSTRUMENT_WRAPPERS");
+        return value && *value && std::string(value) != "0";
+    }
+
+    CallCounter * _getBodyCounter(std::string const & label) const {
+        return _instrumentation->isEnabled() ? &_instrumentation->getBodyCounter(label) : nullptr;
+    }
+
+    // Replace a function attribute by a wrapper that records its calls
+    static void _instrumentAttribute(Instrumented const & target,
+                                     std::shared_ptr<WrapperInstrumentation> const & instrumentation) {
+        pybind11::object const raw = target.owner.attr("__dict__")[target.name.c_str()];
+        pybind11::object const original = target.owner.attr(target.name.c_str());
+        if (!PyCallable_Check(original.ptr())) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              "Cannot instrument " + target.label + ": not a function");
+        }
+        std::string doc;
+        if (pybind11::isinstance<pybind11::str>(original.attr("__doc__"))) {
+            doc = original.attr("__doc__").cast<std::string>();
+        }
+        pybind11::cpp_function wrapper(
+            [original, counter=&instrumentation->getCallCounter(target.label), keepAlive=instrumentation](
+                    pybind11::args args, pybind11::kwargs kwargs) {
+                detail::CallTimer timer(counter);
+                return original(*args, **kwargs);
+            },
+            pybind11::name(target.name.c_str()),
+            pybind11::doc(doc.c_str())
+        );
+        if (PyInstanceMethod_Check(raw.ptr())) {
+            auto method = pybind11::reinterpret_steal<pybind11::object>(PyInstanceMethod_New(wrapper.ptr()));
+            pybind11::setattr(target.owner, target.name.c_str(), method);
+        } else if (PyObject_TypeCheck(raw.ptr(), &PyStaticMethod_Type)) {
+            pybind11::setattr(target.owner, target.name.c_str(), pybind11::staticmethod(wrapper));
+        } else {
+            pybind11::setattr(target.owner, target.name.c_str(), wrapper);
+        }
+    }
+
+    // Import dependencies, run definitions and instrument functions (consuming all three),
+    // returning how long each import and definition took; this is also recorded in
+    // `instrumentation` and the CounterRegistry, and published as `target.__wrapper_timings__`.
+    static std::vector<Timing> _runDefinitions(
+            pybind11::module & target,
+            std::list<std::string> & dependencies,
+            std::list<Definition> & definitions,
+            std::list<Instrumented> & instrumented,
+            std::shared_ptr<WrapperInstrumentation> const & instrumentation) {
+        std::vector<Timing> timings;
+        using Clock = std::chrono::steady_clock;
+        using Seconds = std::chrono::duration<double>;
+        for (auto dep = dependencies.begin(); dep != dependencies.end(); dep = dependencies.erase(dep)) {
+            auto const start = Clock::now();
+            pybind11::module::import(dep->c_str());
+            timings.emplace_back("import " + *dep, Seconds(Clock::now() - start).count());
+        }
+        for (auto def = definitions.begin(); def != definitions.end(); def = definitions.erase(def)) {
+            auto const start = Clock::now();
+            def->callback(def->module);
+            timings.emplace_back(def->label, Seconds(Clock::now() - start).count());
+        }
+        pybind11::list published;
+        for (auto const & timing : timings) {
+            published.append(pybind11::make_tuple(timing.first, timing.second));
+        }
+        target.attr("__wrapper_timings__") = published;
+        instrumentation->addTimings(timings);
+#ifndef LSST_CPPUTILS_INSTRUMENTATION_DISABLE
+        std::string const moduleName = pybind11::str(target.attr("__name__"));
+        for (auto const & timing : timings) {
+            Counter("python.wrappers." + moduleName + ": " + timing.first).add(1, Seconds(timing.second));
+        }
+#endif
+        if (instrumentation->isEnabled()) {
+            for (auto const & function : instrumented) {
+                _instrumentAttribute(function, instrumentation);
+            }
+        }
+        instrumented.clear();
+        return timings;
+    }
+
+    // Install a module-level __getattr__ that materializes lazy submodules on first lookup
+    void _installLazyLookup() {
+        std::string const parentName = module.attr("__name__").cast<std::string>();
+        module.attr("__getattr__") = pybind11::cpp_function(
+            [parent=module, lazySubmodules=_lazySubmodules, instrumentation=_instrumentation, parentName](
+                    std::string const & name) -> pybind11::object {
+                if (lazySubmodules->count(name) == 0) {
+                    throw pybind11::attribute_error("module '" + parentName + "' has no attribute '" +
+                                                    name + "'");
+                }
+                _materialize(parent, *lazySubmodules, name, instrumentation);
+                return parent.attr(name.c_str());
+            },
+            pybind11::arg("name")
+        );
+    }
+
+    // Run the deferred definitions of a lazy submodule and make it an attribute of its parent,
+    // unless that has already been done
+    static void _materialize(pybind11::module const & parent,
+                             std::map<std::string, LazySubmodule> & lazySubmodules,
+                             std::string const & name,
+                             std::shared_ptr<WrapperInstrumentation> const & instrumentation) {
+        auto const iter = lazySubmodules.find(name);
+        if (iter == lazySubmodules.end()) {
+            return;
+        }
+        // Remove the entry and the submodule's hook first, so a failed or reentrant lookup cannot run
+        // definitions twice, and the definitions may install their own __getattr__
+        LazySubmodule lazy = std::move(iter->second);
+        lazySubmodules.erase(iter);
+        pybind11::delattr(lazy.module, "__getattr__");
+        _runDefinitions(lazy.module, lazy.dependencies, lazy.definitions, lazy.instrumented,
+                        instrumentation);
+        parent.attr(name.c_str()) = lazy.module;
+    }
+
     std::string _package;
     std::list<std::string> _dependencies;
-    std::list<std::pair<pybind11::module, WrapperCallback>> _definitions;
+    std::list<Definition> _definitions;
+    std::string _name;  // Attribute name of this submodule in its parent, if any
+    bool _lazy = false;  // Are this submodule's definitions deferred until first lookup?
+    std::shared_ptr<std::map<std::string, LazySubmodule>> _lazySubmodules;  // Lazy submodules collected
+    std::vector<Timing> _timings;
+    std::list<Instrumented> _instrumented;
+    std::shared_ptr<WrapperInstrumentation> _instrumentation;  // Shared with submodules and lazy lookups
 };
 
 
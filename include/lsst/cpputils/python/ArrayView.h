@@ -0,0 +1,350 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_PYTHON_ARRAYVIEW_H
+#define LSST_CPPUTILS_PYTHON_ARRAYVIEW_H
+
+#include "pybind11/pybind11.h"
+#include "pybind11/numpy.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/cpputils/python/TemplateInvoker.h"
+
+namespace lsst { namespace cpputils { namespace python {
+
+/**
+ * A contiguous sequence of `T`, in the manner of C++20's `std::span`.
+ *
+ * A Span does not own its elements; `T` may be const to give read-only
+ * access.
+ */
+template <typename T>
+class Span final {
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using iterator = T *;
+
+    constexpr Span() noexcept = default;
+    constexpr Span(T * data, std::size_t size) noexcept : _data(data), _size(size) {}
+
+    /// A read-only span may be made from a writeable one
+    template <typename U, typename = std::enable_if_t<std::is_same<T, U const>::value>>
+    constexpr Span(Span<U> const & other) noexcept : _data(other.data()), _size(other.size()) {}
+
+    constexpr T * data() const noexcept { return _data; }
+    constexpr std::size_t size() const noexcept { return _size; }
+    constexpr bool empty() const noexcept { return _size == 0; }
+    constexpr iterator begin() const noexcept { return _data; }
+    constexpr iterator end() const noexcept { return _data + _size; }
+    constexpr T & operator[](std::size_t i) const noexcept { return _data[i]; }
+
+    /// The `count` elements starting at `offset` (which must be in range)
+    constexpr Span subspan(std::size_t offset, std::size_t count) const noexcept {
+        return Span(_data + offset, count);
+    }
+
+private:
+    T * _data = nullptr;
+    std::size_t _size = 0;
+};
+
+/**
+ * A strided `N`-dimensional view of `T`, such as a NumPy array.
+ *
+ * Strides are in elements, not bytes, and may be negative or zero.  An
+ * ArrayView does not own its elements; `T` may be const to give read-only
+ * access.
+ */
+template <typename T, std::size_t N>
+class ArrayView final {
+public:
+    static_assert(N > 0, "ArrayView must have at least one dimension");
+
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using Index = std::array<std::ptrdiff_t, N>;
+
+    ArrayView(T * data, Index const & shape, Index const & strides) noexcept
+            : _data(data), _shape(shape), _strides(strides) {}
+
+    /// A read-only view may be made from a writeable one
+    template <typename U, typename = std::enable_if_t<std::is_same<T, U const>::value>>
+    ArrayView(ArrayView<U, N> const & other) noexcept
+            : _data(other.data()), _shape(other.getShape()), _strides(other.getStrides()) {}
+
+    /// Pointer to the element at index zero
+    T * data() const noexcept { return _data; }
+
+    std::ptrdiff_t shape(std::size_t i) const noexcept { return _shape[i]; }
+    std::ptrdiff_t stride(std::size_t i) const noexcept { return _strides[i]; }
+    Index const & getShape() const noexcept { return _shape; }
+    Index const & getStrides() const noexcept { return _strides; }
+
+    /// Number of elements
+    std::size_t size() const noexcept {
+        std::size_t result = 1;
+        for (auto extent : _shape) {
+            result *= extent;
+        }
+        return result;
+    }
+
+    /// Element at an index (of N values, which are not checked)
+    template <typename ...I>
+    T & operator()(I... index) const noexcept {
+        static_assert(sizeof...(I) == N, "Wrong number of indices");
+        std::ptrdiff_t const indices[] = {static_cast<std::ptrdiff_t>(index)...};
+        std::ptrdiff_t offset = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            offset += indices[i]*_strides[i];
+        }
+        return _data[offset];
+    }
+
+    /// Are the elements contiguous, in C order?
+    bool isContiguous() const noexcept {
+        std::ptrdiff_t expected = 1;
+        for (std::size_t i = N; i > 0; --i) {
+            if (_shape[i - 1] != 1 && _strides[i - 1] != expected) {
+                return false;
+            }
+            expected *= _shape[i - 1];
+        }
+        return true;
+    }
+
+    /**
+     * The elements as a Span, in C order.
+     *
+     * @throws pex::exceptions::InvalidParameterError if the view is not contiguous.
+     */
+    Span<T> flat() const {
+        if (!isContiguous()) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, "Array view is not contiguous");
+        }
+        return Span<T>(_data, size());
+    }
+
+private:
+    T * _data;
+    Index _shape;
+    Index _strides;
+};
+
+/// Memory layout required by makeArrayView
+enum class ArrayLayout {
+    STRIDED,       ///< Any strides that are a multiple of the item size
+    C_CONTIGUOUS,  ///< Contiguous, in C order
+};
+
+namespace detail {
+
+// Check that the elements of an array may be accessed as T, with the given layout
+template <typename T>
+void checkArray(pybind11::array const & array, ArrayLayout layout, std::string const & name) {
+    using Value = std::remove_const_t<T>;
+    if (!pybind11::detail::npy_api::get().PyArray_EquivTypes_(array.dtype().ptr(),
+                                                              pybind11::dtype::of<Value>().ptr())) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          name + " has dtype " + std::string(pybind11::str(array.dtype())) + ", not " +
+                          std::string(pybind11::str(pybind11::dtype::of<Value>())));
+    }
+    if (!std::is_const<T>::value && !array.writeable()) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, name + " must be writeable");
+    }
+    if (layout == ArrayLayout::C_CONTIGUOUS && !(array.flags() & pybind11::array::c_style)) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, name + " must be C-contiguous");
+    }
+    if (reinterpret_cast<std::uintptr_t>(array.data()) % alignof(Value) != 0) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, name + " is not aligned");
+    }
+}
+
+// Pointer to the elements of an array; data() is const, and makes no check of writeability
+template <typename T>
+T * getArrayData(pybind11::array const & array) {
+    return static_cast<T *>(const_cast<void *>(array.data()));
+}
+
+}  // namespace detail
+
+/**
+ * View the elements of a NumPy array without copying them.
+ *
+ * @tparam T  Element type, which must match the dtype of the array exactly
+ *            (no conversion is made).  If it is not const, the array must be
+ *            writeable.
+ * @tparam N  Number of dimensions of the array.
+ *
+ * @param[in] array  Array to view; it must outlive the view.
+ * @param[in] layout  Required memory layout.
+ * @param[in] name  Name of the array, for error messages.
+ *
+ * @throws pex::exceptions::LengthError if the array does not have `N`
+ *         dimensions.
+ * @throws pex::exceptions::InvalidParameterError if the dtype does not match
+ *         `T`, the data or strides are not aligned for `T`, the array is not
+ *         writeable (if `T` is not const), or the array does not have the
+ *         layout required.
+ */
+template <typename T, std::size_t N>
+ArrayView<T, N> makeArrayView(pybind11::array const & array, ArrayLayout layout = ArrayLayout::STRIDED,
+                              std::string const & name = "array") {
+    if (array.ndim() != static_cast<pybind11::ssize_t>(N)) {
+        std::ostringstream os;
+        os << name << " must have " << N << " dimension(s), not " << array.ndim();
+        throw LSST_EXCEPT(pex::exceptions::LengthError, os.str());
+    }
+    detail::checkArray<T>(array, layout, name);
+    auto const itemSize = static_cast<pybind11::ssize_t>(sizeof(T));
+    typename ArrayView<T, N>::Index shape;
+    typename ArrayView<T, N>::Index strides;
+    for (std::size_t i = 0; i < N; ++i) {
+        if (array.strides(i) % itemSize != 0) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              name + " strides must be multiples of the item size");
+        }
+        shape[i] = array.shape(i);
+        strides[i] = array.strides(i)/itemSize;
+    }
+    return ArrayView<T, N>(detail::getArrayData<T>(array), shape, strides);
+}
+
+/**
+ * View the elements of a C-contiguous NumPy array of any shape as a Span,
+ * in C order, without copying them.
+ *
+ * The checks are those of makeArrayView with the C_CONTIGUOUS layout,
+ * except that the number of dimensions is not checked.
+ */
+template <typename T>
+Span<T> makeSpan(pybind11::array const & array, std::string const & name = "array") {
+    detail::checkArray<T>(array, ArrayLayout::C_CONTIGUOUS, name);
+    return Span<T>(detail::getArrayData<T>(array), array.size());
+}
+
+/**
+ * Call `function(view)` with an `ArrayView<T const, N>` of a NumPy array,
+ * where `T` is the type in `types` that matches the dtype of the array.
+ *
+ * This combines TemplateInvoker dispatch with makeArrayView.
+ *
+ * @param[in] function  Callable object that takes an `ArrayView<T const, N>`
+ *                      for each type `T` in `types`.
+ * @param[in] array  Array to view.
+ * @param[in] types  The types to try.
+ * @param[in] layout  Required memory layout.
+ * @param[in] name  Name of the array, for error messages.
+ *
+ * @return the result of `function`, converted into a Python object.
+ *
+ * @throws the exceptions of makeArrayView; a Python TypeError if no type
+ *         matches.
+ */
+template <std::size_t N, typename Function, typename ...Types>
+pybind11::object applyArrayView(Function function, pybind11::array const & array,
+                                TemplateInvoker::Tag<Types...> types,
+                                ArrayLayout layout = ArrayLayout::STRIDED,
+                                std::string const & name = "array") {
+    return TemplateInvoker().apply(
+        [&](auto t) { return function(makeArrayView<decltype(t) const, N>(array, layout, name)); },
+        array.dtype(),
+        types
+    );
+}
+
+namespace detail {
+
+// NumPy array of the elements of a view, with the given base object
+template <typename T, std::size_t N>
+pybind11::array makeArray(ArrayView<T, N> const & view, pybind11::handle base) {
+    using Value = std::remove_const_t<T>;
+    std::vector<pybind11::ssize_t> shape(view.getShape().begin(), view.getShape().end());
+    std::vector<pybind11::ssize_t> strides;
+    for (auto stride : view.getStrides()) {
+        strides.push_back(stride*static_cast<pybind11::ssize_t>(sizeof(Value)));
+    }
+    pybind11::array result(pybind11::dtype::of<Value>(), shape, strides, view.data(), base);
+    if (std::is_const<T>::value) {
+        pybind11::detail::array_proxy(result.ptr())->flags &=
+                ~pybind11::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    }
+    return result;
+}
+
+}  // namespace detail
+
+/**
+ * Wrap memory owned by C++ as a NumPy array, without copying it.
+ *
+ * The array holds a reference to `owner`, which keeps the memory alive for
+ * as long as the array (or any view of it) exists, even after the C++ side
+ * has let go of it.  For example, a buffer held in a Cache may be returned
+ * to Python as an array that stays valid after the buffer has been evicted:
+ *
+ * @code
+ * std::shared_ptr<std::vector<double>> buffer = cache[key];
+ * std::ptrdiff_t const size = buffer->size();
+ * return makeArray(ArrayView<double const, 1>(buffer->data(), {size}, {1}), buffer);
+ * @endcode
+ *
+ * The array is read-only if `T` is const.
+ *
+ * @param[in] view  Elements to wrap.
+ * @param[in] owner  Object owning the elements.
+ */
+template <typename T, std::size_t N, typename Owner>
+pybind11::array makeArray(ArrayView<T, N> const & view, std::shared_ptr<Owner> owner) {
+    auto * holder = new std::shared_ptr<void const>(std::move(owner));
+    pybind11::capsule base(holder, [](void * pointer) {
+        delete static_cast<std::shared_ptr<void const> *>(pointer);
+    });
+    return detail::makeArray(view, base);
+}
+
+/**
+ * Wrap memory owned by a Python object as a NumPy array, without copying it.
+ *
+ * The array holds a reference to `owner` (e.g. the `self` of the method
+ * returning the array), which must keep the memory alive.
+ */
+template <typename T, std::size_t N>
+pybind11::array makeArray(ArrayView<T, N> const & view, pybind11::object const & owner) {
+    return detail::makeArray(view, owner);
+}
+
+}}
+}  // namespace lsst::cpputils::python
+
+#endif
@@ -22,12 +22,16 @@
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
 
+#include <chrono>
 #include <functional>  // for std::function
+#include <memory>
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
+#include "pybind11/chrono.h"  // for times to live
 #include "pybind11/functional.h"  // for binding std::function
 
 #include "lsst/cpputils/Cache.h"
+#include "lsst/cpputils/ConcurrentCache.h"
 
 namespace py = pybind11;
 using namespace pybind11::literals;
@@ -36,13 +40,94 @@ namespace lsst {
 namespace cpputils {
 namespace python {
 
+/// Convert cache statistics to a dict, e.g. for export to metrics
+inline py::dict cacheStatisticsToDict(CacheStatistics const& stats) {
+    return py::dict(
+        "hits"_a=stats.hits,
+        "misses"_a=stats.misses,
+        "insertions"_a=stats.insertions,
+        "evictions"_a=stats.evictions,
+        "expirations"_a=stats.expirations,
+        "generations"_a=stats.generations,
+        "generatorTime"_a=std::chrono::duration<double>(stats.generatorTime).count(),
+        "spills"_a=stats.spills,
+        "spillHits"_a=stats.spillHits,
+        "hitRate"_a=stats.hitRate()
+    );
+}
+
 template <typename Key, typename Value, typename KeyHash=boost::hash<Key>,
-          typename KeyPred=std::equal_to<Key>>
+          typename KeyPred=std::equal_to<Key>, typename Policy=LruPolicy>
 void declareCache(py::module & mod, std::string const& name) {
-    typedef lsst::cpputils::Cache<Key, Value, KeyHash, KeyPred> Class;
+    typedef lsst::cpputils::Cache<Key, Value, KeyHash, KeyPred, Policy> Class;
     py::class_<Class> cls(mod, name.c_str());
 
     cls.def(py::init<std::size_t>(), "maxElements"_a=0);
+    cls.def(py::init<std::size_t, typename Class::Weigher, std::size_t>(),
+            "maxElements"_a, "weigher"_a, "maxWeight"_a);
+    cls.def("__call__",
+            [](Class & self, Key const& key, std::function<Value(Key const& key)> func) {
+                py::gil_scoped_release release;
+                return self(key, func);
+            }, "key"_a, "func"_a);
+    cls.def("__getitem__", &Class::operator[]);
+    cls.def("get", &Class::get);
+    cls.def("add", py::overload_cast<Key const&, Value const&>(&Class::add), "key"_a, "value"_a);
+    cls.def("add", py::overload_cast<Key const&, Value const&, typename Class::Duration>(&Class::add),
+            "key"_a, "value"_a, "timeToLive"_a);
+    cls.def("erase", &Class::erase, "key"_a);
+    cls.def("getMany", &Class::getMany, "keys"_a);
+    cls.def("addMany", &Class::addMany, "keys"_a, "values"_a);
+    cls.def("computeMany",
+            [](Class & self, std::vector<Key> const& keys,
+               std::function<std::vector<Value>(std::vector<Key> const& missing)> func) {
+                py::gil_scoped_release release;
+                return self.computeMany(keys, func);
+            }, "keys"_a, "func"_a);
+    cls.def("size", &Class::size);
+    cls.def("__len__", &Class::size);
+    cls.def("keys", &Class::keys);
+    cls.def("contains", &Class::contains);
+    cls.def("__contains__", &Class::contains);
+    cls.def("capacity", &Class::capacity);
+    cls.def("reserve", &Class::reserve);
+    cls.def("weight", &Class::weight);
+    cls.def("maxWeight", &Class::maxWeight);
+    cls.def("reserveWeight", &Class::reserveWeight);
+    cls.def("flush", &Class::flush);
+    cls.def("stats", [](Class const& self) { return cacheStatisticsToDict(self.stats()); });
+    cls.def("resetStats", &Class::resetStats);
+    cls.def("enableSampling", &Class::enableSampling, "capacity"_a, "interval"_a=1);
+    cls.def("sampledKeys", &Class::sampledKeys);
+    cls.def("timeToLive", &Class::timeToLive);
+    cls.def("setTimeToLive", &Class::setTimeToLive, "timeToLive"_a);
+    cls.def("timeRemaining", &Class::timeRemaining, "key"_a);
+}
+
+namespace detail {
+
+// Deleter that releases the GIL, so that background threads needing it can complete
+template <typename T>
+struct GilReleasingDelete {
+    void operator()(T * ptr) const {
+        py::gil_scoped_release release;
+        delete ptr;
+    }
+};
+
+}  // namespace detail
+
+template <typename Key, typename Value, typename KeyHash=boost::hash<Key>,
+          typename KeyPred=std::equal_to<Key>, typename Policy=LruPolicy>
+void declareConcurrentCache(py::module & mod, std::string const& name) {
+    typedef lsst::cpputils::ConcurrentCache<Key, Value, KeyHash, KeyPred, Policy> Class;
+    // Destruction waits for background refreshes, which may call back into Python
+    py::class_<Class, std::unique_ptr<Class, detail::GilReleasingDelete<Class>>> cls(mod, name.c_str());
+
+    cls.def(py::init<std::size_t, std::size_t, bool>(),
+            "maxElements"_a=0, "numShards"_a=0, "singleFlight"_a=false);
+    // No constructor taking a Weigher: it is called with a shard lock held, and would need the GIL while
+    // another thread holds the GIL and waits for that shard lock.
     cls.def("__call__",
             [](Class & self, Key const& key, std::function<Value(Key const& key)> func) {
                 py::gil_scoped_release release;
@@ -50,7 +135,18 @@ void declareCache(py::module & mod, std::string const& name) {
             }, "key"_a, "func"_a);
     cls.def("__getitem__", &Class::operator[]);
     cls.def("get", &Class::get);
-    cls.def("add", &Class::add, "key"_a, "value"_a);
+    cls.def("add", py::overload_cast<Key const&, Value const&>(&Class::add), "key"_a, "value"_a);
+    cls.def("add", py::overload_cast<Key const&, Value const&, typename Class::Duration>(&Class::add),
+            "key"_a, "value"_a, "timeToLive"_a);
+    cls.def("erase", &Class::erase, "key"_a);
+    cls.def("getMany", &Class::getMany, "keys"_a);
+    cls.def("addMany", &Class::addMany, "keys"_a, "values"_a);
+    cls.def("computeMany",
+            [](Class & self, std::vector<Key> const& keys,
+               std::function<std::vector<Value>(std::vector<Key> const& missing)> func) {
+                py::gil_scoped_release release;
+                return self.computeMany(keys, func);
+            }, "keys"_a, "func"_a);
     cls.def("size", &Class::size);
     cls.def("__len__", &Class::size);
     cls.def("keys", &Class::keys);
@@ -58,7 +154,21 @@ void declareCache(py::module & mod, std::string const& name) {
     cls.def("__contains__", &Class::contains);
     cls.def("capacity", &Class::capacity);
     cls.def("reserve", &Class::reserve);
+    cls.def("weight", &Class::weight);
+    cls.def("maxWeight", &Class::maxWeight);
+    cls.def("reserveWeight", &Class::reserveWeight);
     cls.def("flush", &Class::flush);
+    cls.def("stats", [](Class const& self) { return cacheStatisticsToDict(self.stats()); });
+    cls.def("resetStats", &Class::resetStats);
+    cls.def("enableSampling", &Class::enableSampling, "capacity"_a, "interval"_a=1);
+    cls.def("sampledKeys", &Class::sampledKeys);
+    cls.def("numShards", &Class::numShards);
+    cls.def("isSingleFlight", &Class::isSingleFlight);
+    cls.def("timeToLive", &Class::timeToLive);
+    cls.def("refreshAhead", &Class::refreshAhead);
+    cls.def("timeRemaining", &Class::timeRemaining, "key"_a);
+    cls.def("setTimeToLive", &Class::setTimeToLive, "timeToLive"_a,
+            "refreshAhead"_a=typename Class::Duration::zero());
 }
 
 }}
@@ -27,6 +27,7 @@
 #include "pybind11/pybind11.h"
 #include "pybind11/numpy.h"
 
+#include <array>
 #include <iostream>
 
 namespace lsst { namespace cpputils { namespace python {
@@ -102,6 +103,12 @@ namespace lsst { namespace cpputils { namespace python {
  * C++ type corresponds to the type passed in the `dtype` argument.  So instead
  * of using that value, we use the `decltype` operator to extract that type and
  * use it as a template parameter.
+ *
+ * Native-byte-order dtypes of the builtin NumPy scalar types are dispatched
+ * with a single lookup, by type number, in a table built on first use for
+ * each combination of callable and types.  Other dtypes (structured, string,
+ * byte-swapped, ...) are compared with each of the types in turn.  Both give
+ * the same result.
  */
 class TemplateInvoker {
 public:
@@ -158,11 +165,61 @@ public:
         pybind11::dtype const & dtype,
         Tag<TypesToTry...> typesToTry
     ) const {
+        if constexpr (sizeof...(TypesToTry) > 0) {
+            auto const * descr = pybind11::detail::array_descriptor_proxy(dtype.ptr());
+            if (descr->type_num >= 0 && descr->type_num < NUM_BUILTIN_TYPES &&
+                    (descr->byteorder == '=' || descr->byteorder == '|')) {
+                using Thunk = pybind11::object (*)(Function &);
+                static constexpr Thunk thunks[] = {&_call<Function, TypesToTry>...};
+                int const index = _getDispatchTable<TypesToTry...>()[descr->type_num];
+                return index >= 0 ? thunks[index](function) : _onError(dtype);
+            }
+        }
         return _apply(function, dtype, typesToTry);
     }
 
 private:
 
+    // Number of builtin NumPy scalar types (bool to clongdouble), which are dispatched by table
+    static constexpr int NUM_BUILTIN_TYPES = pybind11::detail::npy_api::NPY_CLONGDOUBLE_ + 1;
+
+    using DispatchTable = std::array<int, NUM_BUILTIN_TYPES>;
+
+    // Index in TypesToTry of the first type equivalent to each builtin type, or -1 if there is none.
+    // The table is guarded by the GIL rather than by a static initializer, which could deadlock if
+    // building it released the GIL.
+    template <typename ...TypesToTry>
+    static DispatchTable const & _getDispatchTable() {
+        static DispatchTable table;
+        static bool initialized = false;
+        if (!initialized) {
+            auto & api = pybind11::detail::npy_api::get();
+            pybind11::object const candidates[] = {pybind11::dtype::of<TypesToTry>()...};
+            table.fill(-1);
+            for (int num = 0; num < NUM_BUILTIN_TYPES; ++num) {
+                auto const descr = pybind11::reinterpret_steal<pybind11::object>(
+                        api.PyArray_DescrFromType_(num));
+                if (!descr) {
+                    PyErr_Clear();
+                    continue;
+                }
+                for (int i = 0; i < static_cast<int>(sizeof...(TypesToTry)); ++i) {
+                    if (api.PyArray_EquivTypes_(descr.ptr(), candidates[i].ptr())) {
+                        table[num] = i;
+                        break;
+                    }
+                }
+            }
+            initialized = true;
+        }
+        return table;
+    }
+
+    template <typename Function, typename T>
+    static pybind11::object _call(Function & function) {
+        return pybind11::cast(function(static_cast<T>(0)));
+    }
+
     template <typename Function>
     pybind11::object _apply(Function & function, pybind11::dtype const & dtype, Tag<>) const {
         return _onError(dtype);
@@ -172,7 +229,7 @@ private:
     pybind11::object _apply(Function & function, pybind11::dtype const & dtype, Tag<T, A...>) const {
         if (pybind11::detail::npy_api::get().PyArray_EquivTypes_(dtype.ptr(),
                                                                  pybind11::dtype::of<T>().ptr())) {
-            return pybind11::cast(function(static_cast<T>(0)));
+            return _call<Function, T>(function);
         }
         return _apply(function, dtype, Tag<A...>());
     }
@@ -0,0 +1,211 @@
+// -*- lsst-c++ -*-
+/*
+ * LSST Data Management System
+ * See COPYRIGHT file at the top of the source tree.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_CPPUTILS_PYTHON_WRAPPERINSTRUMENTATION_H
+#define LSST_CPPUTILS_PYTHON_WRAPPERINSTRUMENTATION_H
+
+#include "pybind11/pybind11.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lsst { namespace cpputils { namespace python {
+
+/**
+ * Number and duration of calls to an instrumented function.
+ *
+ * Durations are accumulated in total and in a histogram with logarithmic
+ * bins: bin `i` counts calls that took between `2**i` and `2**(i+1)`
+ * nanoseconds, with the last bin also counting all longer calls.  The
+ * counters are relaxed atomics, so calls may be recorded from any thread,
+ * with or without the GIL.
+ */
+class CallCounter final {
+public:
+    /// Number of histogram bins
+    static constexpr std::size_t HISTOGRAM_SIZE = 40;
+
+    CallCounter() noexcept {
+        for (auto & bin : _histogram) {
+            bin.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    CallCounter(CallCounter const &) = delete;
+    CallCounter & operator=(CallCounter const &) = delete;
+
+    /// Record one call that took `duration`
+    void record(std::chrono::nanoseconds duration) noexcept {
+        using Rep = std::chrono::nanoseconds::rep;
+        auto const ns = static_cast<std::uint64_t>(std::max<Rep>(duration.count(), 1));
+        std::size_t bin = 0;
+        while (bin + 1 < HISTOGRAM_SIZE && (ns >> (bin + 1)) != 0) {
+            ++bin;
+        }
+        _calls.fetch_add(1, std::memory_order_relaxed);
+        _nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+        _histogram[bin].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Number of calls recorded
+    std::uint64_t getCalls() const noexcept { return _calls.load(std::memory_order_relaxed); }
+
+    /// Total duration of the calls recorded
+    std::chrono::nanoseconds getTotalTime() const noexcept {
+        return std::chrono::nanoseconds(_nanoseconds.load(std::memory_order_relaxed));
+    }
+
+    /// Return the counters as a dict with keys "calls", "seconds" and "histogram"
+    pybind11::dict toDict() const {
+        pybind11::list histogram;
+        for (auto const & bin : _histogram) {
+            histogram.append(bin.load(std::memory_order_relaxed));
+        }
+        pybind11::dict result;
+        result["calls"] = getCalls();
+        result["seconds"] = std::chrono::duration<double>(getTotalTime()).count();
+        result["histogram"] = histogram;
+        return result;
+    }
+
+private:
+    std::atomic<std::uint64_t> _calls{0};
+    std::atomic<std::uint64_t> _nanoseconds{0};
+    std::array<std::atomic<std::uint64_t>, HISTOGRAM_SIZE> _histogram;
+};
+
+/**
+ * Measurements of a pybind11 module collected by WrapperCollection.
+ *
+ * A single instance is shared by a WrapperCollection and all of its
+ * submodules.  It holds the time taken by each deferred definition and
+ * dependency import, and, if enabled, a pair of CallCounters for each
+ * instrumented function:
+ *
+ *  - "call" counts calls through the Python binding, including pybind11's
+ *    argument and return value conversion;
+ *  - "body" counts calls to the C++ function itself.
+ *
+ * The difference between the two is the overhead of the binding.
+ */
+class WrapperInstrumentation final {
+public:
+    /// Label and duration (in seconds) of a deferred wrapper declaration or dependency import.
+    using Timing = std::pair<std::string, double>;
+
+    explicit WrapperInstrumentation(bool enabled) noexcept : _enabled(enabled) {}
+
+    WrapperInstrumentation(WrapperInstrumentation const &) = delete;
+    WrapperInstrumentation & operator=(WrapperInstrumentation const &) = delete;
+
+    /// Are function calls instrumented?
+    bool isEnabled() const noexcept { return _enabled; }
+
+    /// Enable or disable instrumentation of functions wrapped from now on
+    void setEnabled(bool enabled) noexcept { _enabled = enabled; }
+
+    /// Counter for calls through the Python binding of the function labelled `label`
+    CallCounter & getCallCounter(std::string const & label) { return _counters[label].first; }
+
+    /// Counter for calls to the C++ function labelled `label`
+    CallCounter & getBodyCounter(std::string const & label) { return _counters[label].second; }
+
+    /// Record the time taken by deferred definitions
+    void addTimings(std::vector<Timing> const & timings) {
+        _timings.insert(_timings.end(), timings.begin(), timings.end());
+    }
+
+    /// Time taken by each deferred definition and dependency import, in the order they were run
+    std::vector<Timing> const & getTimings() const noexcept { return _timings; }
+
+    /**
+     * Return all measurements as a dict.
+     *
+     * The dict has keys "enabled" (a bool), "timings" (a list of
+     * `(label, seconds)` tuples) and "calls" (a dict mapping the label of
+     * each instrumented function to a dict with keys "call" and "body", each
+     * in the form returned by CallCounter::toDict).
+     */
+    pybind11::dict toDict() const {
+        pybind11::list timings;
+        for (auto const & timing : _timings) {
+            timings.append(pybind11::make_tuple(timing.first, timing.second));
+        }
+        pybind11::dict calls;
+        for (auto const & entry : _counters) {
+            pybind11::dict counters;
+            counters["call"] = entry.second.first.toDict();
+            counters["body"] = entry.second.second.toDict();
+            calls[entry.first.c_str()] = counters;
+        }
+        pybind11::dict result;
+        result["enabled"] = _enabled;
+        result["timings"] = timings;
+        result["calls"] = calls;
+        return result;
+    }
+
+private:
+    bool _enabled;
+    std::vector<Timing> _timings;
+    // Nodes of a std::map are never moved, so references to counters stay valid
+    std::map<std::string, std::pair<CallCounter, CallCounter>> _counters;
+};
+
+namespace detail {
+
+// Record the duration of its own lifetime in a CallCounter, if there is one
+class CallTimer final {
+public:
+    explicit CallTimer(CallCounter * counter) noexcept
+            : _counter(counter), _start(counter ? std::chrono::steady_clock::now()
+                                                : std::chrono::steady_clock::time_point()) {}
+
+    CallTimer(CallTimer const &) = delete;
+    CallTimer & operator=(CallTimer const &) = delete;
+
+    ~CallTimer() noexcept {
+        if (_counter) {
+            _counter->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - _start));
+        }
+    }
+
+private:
+    CallCounter * _counter;
+    std::chrono::steady_clock::time_point _start;
+};
+
+}  // namespace detail
+
+}}
+}  // namespace lsst::cpputils::python
+
+#endif
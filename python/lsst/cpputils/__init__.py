@@ -25,5 +25,6 @@ import lsst.pex.exceptions
 
 from ._cpputils import *
 from . import backtrace
+from . import instrumentation
 
 from .version import *
@@ -0,0 +1,72 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include "lsst/cpputils/python.h"
+#include "lsst/cpputils/CacheTrace.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace cpputils {
+
+void wrapCacheTrace(python::WrapperCollection & wrappers) {
+    wrappers.wrapType(py::enum_<CacheTracePolicy>(wrappers.module, "CacheTracePolicy"), [](auto & mod,
+                                                                                          auto & cls) {
+        cls.value("LRU", CacheTracePolicy::LRU);
+        cls.value("SLRU", CacheTracePolicy::SLRU);
+        cls.value("TINY_LFU", CacheTracePolicy::TINY_LFU);
+    });
+    wrappers.wrapType(py::class_<CacheTrace>(wrappers.module, "CacheTrace"), [](auto & mod, auto & cls) {
+        cls.def(py::init<>());
+        cls.def(py::init<std::vector<CacheTrace::KeyId>, std::size_t>(), "requests"_a, "numKeys"_a);
+        cls.def_static("read", &CacheTrace::read, "filename"_a);
+        cls.def_static("readText", py::overload_cast<std::string const&>(&CacheTrace::readText),
+                       "filename"_a);
+        cls.def_static("readBinary", py::overload_cast<std::string const&>(&CacheTrace::readBinary),
+                       "filename"_a);
+        cls.def("writeBinary", py::overload_cast<std::string const&>(&CacheTrace::writeBinary, py::const_),
+                "filename"_a);
+        cls.def("append", &CacheTrace::append, "key"_a);
+        cls.def("getRequests", &CacheTrace::getRequests);
+        cls.def("getNumKeys", &CacheTrace::getNumKeys);
+        cls.def("__len__", &CacheTrace::size);
+    });
+    wrappers.wrapType(py::class_<StackDistances>(wrappers.module, "StackDistances"), [](auto & mod,
+                                                                                      auto & cls) {
+        cls.def(py::init<CacheTrace const&>(), "trace"_a, py::call_guard<py::gil_scoped_release>());
+        cls.def("getNumRequests", &StackDistances::getNumRequests);
+        cls.def("getNumCompulsoryMisses", &StackDistances::getNumCompulsoryMisses);
+        cls.def("getHistogram", &StackDistances::getHistogram);
+        cls.def("getHitRate", &StackDistances::getHitRate, "capacity"_a);
+        cls.def("getHitRates", &StackDistances::getHitRates, "capacities"_a);
+    });
+    wrappers.wrap([](auto & mod) {
+        mod.def("simulateHitRates", &simulateHitRates, "trace"_a, "capacities"_a, "policy"_a,
+                py::call_guard<py::gil_scoped_release>());
+    });
+}
+
+}  // namespace cpputils
+}  // namespace lsst
@@ -27,8 +27,11 @@ namespace lsst {
 namespace cpputils {
 
 void wrapBacktrace(python::WrapperCollection & wrappers);
+void wrapCacheTrace(python::WrapperCollection & wrappers);
 void wrapDemangle(python::WrapperCollection & wrappers);
 void wrapFixGamut(python::WrapperCollection & wrappers);
+void wrapInstrumentation(python::WrapperCollection & wrappers);
+void wrapMagnitude(python::WrapperCollection & wrappers);
 
 PYBIND11_MODULE(_cpputils, mod) {
     python::WrapperCollection wrappers(mod, "_cpputils");
@@ -37,8 +40,15 @@ PYBIND11_MODULE(_cpputils, mod) {
         wrapBacktrace(backtraceWrappers);
         wrappers.collectSubmodule(std::move(backtraceWrappers));
     }
+    {
+        auto instrumentationWrappers = wrappers.makeSubmodule("instrumentation");
+        wrapInstrumentation(instrumentationWrappers);
+        wrappers.collectSubmodule(std::move(instrumentationWrappers));
+    }
+    wrapCacheTrace(wrappers);
     wrapDemangle(wrappers);
     wrapFixGamut(wrappers);
+    wrapMagnitude(wrappers);
     wrappers.finish();
 }
 
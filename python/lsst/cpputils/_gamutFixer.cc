@@ -18,56 +18,182 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
 #include "pybind11/pybind11.h"
 #include "pybind11/numpy.h"
+#include "lsst/pex/exceptions.h"
 #include "lsst/cpputils/python.h"
+#include "lsst/cpputils/Instrumentation.h"
+#include "lsst/cpputils/ThreadPool.h"
+#include "lsst/cpputils/python/TemplateInvoker.h"
 #include "lsst/cpputils/_oklabTools.h"
 
 namespace py = pybind11;
+using namespace pybind11::literals;
 
 namespace lsst {
 namespace cpputils {
 
+namespace {
+
+// Minimum number of pixels worth handing to a thread
+constexpr std::size_t MIN_PIXELS_PER_THREAD = 1 << 16;
+
+// Convert linear Display P3 colors (In) to quantized display values (Out); see linearToDisplayP3
+template <typename In, typename Out>
+void convertLinearToDisplayP3(python::Span<In const> const& rgb, python::Span<Out> const& out, float alpha,
+                              bool useCuspTable) {
+    In const* in = rgb.data();
+    Out* result = out.data();
+    std::size_t const num = rgb.size()/3;
+
+    py::gil_scoped_release release;
+    auto convert = [num, in, result, alpha](auto const& cuspProvider) {
+        auto block = [in, result, alpha, &cuspProvider](std::size_t begin, std::size_t end) {
+            details::linear_displayP3_to_display<Out, In>(
+                end - begin, in + 3*begin, in + 3*begin + 1, in + 3*begin + 2, 3,
+                result + 3*begin, result + 3*begin + 1, result + 3*begin + 2, 3, alpha, cuspProvider);
+        };
+        parallelFor(0, num, MIN_PIXELS_PER_THREAD, block);
+    };
+    if (useCuspTable) {
+        convert(details::CuspTable::displayP3());
+    } else {
+        convert(details::ExactCusp<>());
+    }
+}
+
+// Clip Lab colors (T) to a gamut; see fixGamutOK
+template <typename T, typename Gamut>
+void clipLab(python::ArrayView<T const, 2> const& in, python::ArrayView<T, 2> const& out, bool useCuspTable) {
+    // Strides (in elements) between colors and between components
+    std::ptrdiff_t const inStride = in.stride(0);
+    std::ptrdiff_t const inComponent = in.stride(1);
+    std::ptrdiff_t const outStride = out.stride(0);
+    std::ptrdiff_t const outComponent = out.stride(1);
+    std::size_t const num = in.shape(0);
+    float const alpha = 0.5f;
+
+    py::gil_scoped_release release;
+    auto clip = [&](auto const& cuspProvider) {
+        parallelFor(0, num, MIN_PIXELS_PER_THREAD, [&](std::size_t begin, std::size_t end) {
+            T const* src = in.data() + std::ptrdiff_t(begin)*inStride;
+            T* dst = out.data() + std::ptrdiff_t(begin)*outStride;
+            details::gamut_clip_lab_adaptive_L0_L_cusp<T, Gamut>(
+                end - begin, src, src + inComponent, src + 2*inComponent, inStride,
+                dst, dst + outComponent, dst + 2*outComponent, outStride, alpha, cuspProvider);
+        });
+    };
+    if (useCuspTable) {
+        clip(details::CuspTable::forGamut<Gamut>());
+    } else {
+        clip(details::ExactCusp<Gamut>());
+    }
+}
+
+// Clip Lab colors (T) to the named gamut
+template <typename T>
+void clipLab(python::ArrayView<T const, 2> const& in, python::ArrayView<T, 2> const& out, bool useCuspTable,
+             std::string const& gamut) {
+    if (gamut == "displayP3") {
+        clipLab<T, details::DisplayP3Gamut>(in, out, useCuspTable);
+    } else if (gamut == "sRGB") {
+        clipLab<T, details::SrgbGamut>(in, out, useCuspTable);
+    } else if (gamut == "rec2020") {
+        clipLab<T, details::Rec2020Gamut>(in, out, useCuspTable);
+    } else {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          "Unknown gamut '" + gamut + "'; expected 'displayP3', 'sRGB' or 'rec2020'");
+    }
+}
+
+}  // anonymous namespace
+
 
-py::array_t<double> fixGamutOK(py::array_t<double, py::array::c_style | py::array::forcecast> & Lab_points) {
-  py::buffer_info Lab_buffer = Lab_points.request();
-  auto Lab_ptr = Lab_points.unchecked<2>();
-  py::array_t<double> result(Lab_buffer.shape);
-  py::buffer_info result_buffer = result.request();
-  auto result_ptr = result.mutable_unchecked<2>();
-  float alpha = 0.5f;
-
-  for (int pixel_number=0; pixel_number < Lab_buffer.shape[0]; pixel_number++){
-    double L = Lab_ptr(pixel_number, 0);
-    double a = Lab_ptr(pixel_number, 1);
-    double b = Lab_ptr(pixel_number, 2);
-    double esp = 0.00001;
-    float C = std::max(esp, sqrt(a*a + b*b));
-    float a_ = a/C;
-    float b_ = b/C;
-
-    details::LC cusp = details::find_cusp(a_, b_);
-  	float Ld = L - cusp.L;
-  	float k = 2.f * (Ld > 0 ? 1.f - cusp.L : cusp.L);
-
-  	float e1 = 0.5f*k + fabs(Ld) + alpha * C/k;
-  	float L0 = cusp.L + 0.5f * (details::sgn(Ld) * (e1 - sqrtf(e1 * e1 - 2.f * k * fabs(Ld))));
-
-  	float t = details::find_gamut_intersection(a_, b_, L, C, L0);
-  	float L_clipped = L0 * (1.f - t) + t * L;
-  	float C_clipped = t * C;
-
-    result_ptr(pixel_number, 0) = L_clipped;
-    result_ptr(pixel_number, 1) = C_clipped * a_;
-    result_ptr(pixel_number, 2) = C_clipped * b_;
+// Clip Lab colors to a gamut: "displayP3" (the default), "sRGB" or "rec2020".
+// Float32 and float64 arrays (including strided views) are processed without copying, and the result
+// has the same dtype; anything else is first converted to float64. The result is written to out if it
+// is provided (which may be Lab_points itself, but must not otherwise overlap it), or else to a new
+// array.
+py::object fixGamutOK(py::object const& Lab_points, bool useCuspTable, py::object out,
+                      std::string const& gamut) {
+  LSST_SCOPED_TIMER("cpputils.fixGamutOK");
+  py::array input;
+  if (py::isinstance<py::array_t<float>>(Lab_points) || py::isinstance<py::array_t<double>>(Lab_points)) {
+    input = py::reinterpret_borrow<py::array>(Lab_points);
+  } else {
+    input = py::array_t<double, py::array::forcecast>::ensure(Lab_points);
+    if (!input) {
+      throw py::type_error("Lab_points must be convertible to a float64 array");
+    }
   }
-  return result;
+  if (input.ndim() != 2 || input.shape(1) != 3) {
+    throw LSST_EXCEPT(pex::exceptions::LengthError, "Lab_points must have shape (N, 3)");
+  }
+  return python::applyArrayView<2>(
+    [&](auto in) {
+      using T = typename decltype(in)::value_type;
+      py::array result;
+      if (out.is_none()) {
+        result = py::array_t<T>({in.shape(0), in.shape(1)});
+      } else {
+        if (!py::isinstance<py::array>(out)) {
+          throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                            "out must be an array with the same dtype as Lab_points");
+        }
+        result = py::reinterpret_borrow<py::array>(out);
+      }
+      auto outView = python::makeArrayView<T, 2>(result, python::ArrayLayout::STRIDED, "out");
+      if (outView.shape(0) != in.shape(0) || outView.shape(1) != 3) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError, "out must have the same shape as Lab_points");
+      }
+      clipLab<T>(in, outView, useCuspTable, gamut);
+      return result;
+    },
+    input,
+    python::TemplateInvoker::Tag<float, double>(),
+    python::ArrayLayout::STRIDED,
+    "Lab_points"
+  );
+}
 
+// Convert linear Display P3 to gamut-clipped, encoded and quantized Display P3, in a single pass
+py::object linearToDisplayP3(py::array const& rgb, py::array & out, float alpha, bool useCuspTable) {
+  LSST_SCOPED_TIMER("cpputils.linearToDisplayP3");
+  if (rgb.ndim() < 1 || rgb.shape(rgb.ndim() - 1) != 3) {
+    throw LSST_EXCEPT(pex::exceptions::LengthError, "rgb must have shape (..., 3)");
+  }
+  if (out.ndim() != rgb.ndim() || !std::equal(rgb.shape(), rgb.shape() + rgb.ndim(), out.shape())) {
+    throw LSST_EXCEPT(pex::exceptions::LengthError, "out must have the same shape as rgb");
+  }
+  return python::TemplateInvoker().apply(
+    [&](auto inType) {
+      return python::TemplateInvoker().apply(
+        [&](auto outType) {
+          using In = decltype(inType);
+          using Out = decltype(outType);
+          convertLinearToDisplayP3<In, Out>(python::makeSpan<In const>(rgb, "rgb"),
+                                            python::makeSpan<Out>(out, "out"), alpha, useCuspTable);
+          return out;
+        },
+        out.dtype(),
+        python::TemplateInvoker::Tag<std::uint8_t, std::uint16_t>()
+      );
+    },
+    rgb.dtype(),
+    python::TemplateInvoker::Tag<float, double>()
+  );
 }
 
 void wrapFixGamut(lsst::cpputils::python::WrapperCollection &wrappers) {
     wrappers.wrap([](auto &mod) {
-        mod.def("fixGamutOK", &fixGamutOK,"");
+        mod.def("fixGamutOK", &fixGamutOK, "Lab_points"_a, "useCuspTable"_a=false, "out"_a=py::none(),
+                "gamut"_a="displayP3");
+        mod.def("linearToDisplayP3", &linearToDisplayP3, "rgb"_a, "out"_a, "alpha"_a=0.05f,
+                "useCuspTable"_a=false);
     });
 }
 
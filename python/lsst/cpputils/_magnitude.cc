@@ -0,0 +1,121 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+#include "pybind11/numpy.h"
+#include "lsst/pex/exceptions.h"
+#include "lsst/cpputils/python.h"
+#include "lsst/cpputils/Magnitude.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace cpputils {
+
+namespace {
+
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// Minimum number of values worth handing to a thread
+constexpr std::size_t MIN_VALUES_PER_THREAD = 1 << 16;
+
+// A new array with the shape of another
+DoubleArray makeLike(py::array const& array) {
+    return DoubleArray(std::vector<py::ssize_t>(array.shape(), array.shape() + array.ndim()));
+}
+
+// Apply a batch conversion of one array
+DoubleArray convert(DoubleArray const& input, void (*function)(double const*, double*, std::size_t)) {
+    DoubleArray result = makeLike(input);
+    double const* in = input.data();
+    double* out = result.mutable_data();
+    std::size_t const num = input.size();
+    python::parallelFor(0, num, MIN_VALUES_PER_THREAD, [=](std::size_t begin, std::size_t end) {
+        function(in + begin, out + begin, end - begin);
+    });
+    return result;
+}
+
+// Apply a batch conversion of a pair of arrays (values and errors)
+DoubleArray convertErr(DoubleArray const& value, DoubleArray const& error,
+                       void (*function)(double const*, double const*, double*, std::size_t)) {
+    if (value.ndim() != error.ndim() ||
+        !std::equal(value.shape(), value.shape() + value.ndim(), error.shape())) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError, "Values and errors must have the same shape");
+    }
+    DoubleArray result = makeLike(value);
+    double const* in = value.data();
+    double const* inErr = error.data();
+    double* out = result.mutable_data();
+    std::size_t const num = value.size();
+    python::parallelFor(0, num, MIN_VALUES_PER_THREAD, [=](std::size_t begin, std::size_t end) {
+        function(in + begin, inErr + begin, out + begin, end - begin);
+    });
+    return result;
+}
+
+// Overloads are tried in the order they are defined: numpy arrays of any dtype and shape come first, as
+// the scalar overload would otherwise take a one-element array through its __float__; then scalars, which
+// may need conversion (e.g. ints); then anything else that can be made into an array, such as a list.
+void defConvert(py::module &mod, char const *name, char const *arg, double (*scalar)(double),
+                void (*batch)(double const *, double *, std::size_t)) {
+    mod.def(name, [batch](py::array const &value) {
+        return convert(py::cast<DoubleArray>(value), batch);
+    }, py::arg(arg));
+    mod.def(name, scalar, py::arg(arg));
+    mod.def(name, [batch](DoubleArray const &value) { return convert(value, batch); }, py::arg(arg));
+}
+
+// As defConvert, for a conversion of values and their errors
+void defConvertErr(py::module &mod, char const *name, char const *arg, char const *errArg,
+                   double (*scalar)(double, double),
+                   void (*batch)(double const *, double const *, double *, std::size_t)) {
+    mod.def(name, [batch](py::array const &value, py::array const &error) {
+        return convertErr(py::cast<DoubleArray>(value), py::cast<DoubleArray>(error), batch);
+    }, py::arg(arg), py::arg(errArg));
+    mod.def(name, scalar, py::arg(arg), py::arg(errArg));
+    mod.def(name, [batch](DoubleArray const &value, DoubleArray const &error) {
+        return convertErr(value, error, batch);
+    }, py::arg(arg), py::arg(errArg));
+}
+
+}  // anonymous namespace
+
+void wrapMagnitude(lsst::cpputils::python::WrapperCollection &wrappers) {
+    wrappers.wrap([](auto &mod) {
+        // Arrays are converted with the batch overloads, without the GIL, and scalars with the scalar ones.
+        defConvert(mod, "nanojanskyToABMagnitude", "flux", &nanojanskyToABMagnitude,
+                   &nanojanskyToABMagnitude);
+        defConvert(mod, "ABMagnitudeToNanojansky", "magnitude", &ABMagnitudeToNanojansky,
+                   &ABMagnitudeToNanojansky);
+        defConvertErr(mod, "nanojanskyErrToABMagnitudeErr", "flux", "fluxErr",
+                      &nanojanskyErrToABMagnitudeErr, &nanojanskyErrToABMagnitudeErr);
+        defConvertErr(mod, "ABMagnitudeErrToNanojanskyErr", "magnitude", "magnitudeErr",
+                      &ABMagnitudeErrToNanojanskyErr, &ABMagnitudeErrToNanojanskyErr);
+        mod.attr("referenceFlux") = referenceFlux;
+    });
+}
+
+}
+}
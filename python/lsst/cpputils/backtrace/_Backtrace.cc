@@ -23,8 +23,10 @@
 
 #include "lsst/cpputils/python.h"
 #include "lsst/cpputils/Backtrace.h"
+#include "lsst/cpputils/SamplingProfiler.h"
 
 namespace py = pybind11;
+using namespace pybind11::literals;
 
 namespace lsst {
 namespace cpputils {
@@ -37,6 +39,21 @@ void wrapBacktrace(python::WrapperCollection & wrappers) {
             // optimized away, as well as convenient way to check if backtrace
             // is enabled.
             mod.def("isEnabled", [&backtrace]() -> bool { return backtrace.isEnabled(); });
+
+            // Sampling profiler; see SamplingProfiler
+            mod.def("isProfilerSupported", []() { return SamplingProfiler::get().isSupported(); });
+            mod.def("isProfiling", []() { return SamplingProfiler::get().isRunning(); });
+            mod.def("startProfiler",
+                    [](double interval, std::size_t maxSamples) {
+                        SamplingProfiler::get().start(interval, maxSamples);
+                    },
+                    "interval"_a = 0.01, "maxSamples"_a = 10000);
+            // Stop the profiler, and return the samples in folded-stack format
+            mod.def("stopProfiler", []() {
+                SamplingProfiler &profiler = SamplingProfiler::get();
+                profiler.stop();
+                return profiler.getFoldedStacks();
+            });
         }
     );
 }
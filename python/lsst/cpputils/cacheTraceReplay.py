@@ -0,0 +1,129 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+
+"""Replay cache request traces, and report the hit rate of the cache as a
+function of its capacity.
+
+The traces are either the text files written by a ``Cache`` compiled with
+``LSST_CACHE_DEBUG`` (``lsst-cache-<type>-<id>.dat``) or binary traces, which
+may be written with ``--convert``. Hit rates of the LRU policy are computed
+at all capacities at once from the stack distances of the requests; those of
+the other policies are simulated at each capacity.
+"""
+
+__all__ = ["POLICIES", "defaultCapacities", "replay", "main"]
+
+import argparse
+import json
+import sys
+
+from ._cpputils import CacheTrace, CacheTracePolicy, StackDistances, simulateHitRates
+
+POLICIES = {
+    "lru": CacheTracePolicy.LRU,
+    "slru": CacheTracePolicy.SLRU,
+    "tinylfu": CacheTracePolicy.TINY_LFU,
+}
+
+
+def defaultCapacities(numKeys):
+    """Powers of two up to the number of distinct keys, and that number.
+
+    Parameters
+    ----------
+    numKeys : `int`
+        Number of distinct keys in the trace.
+
+    Returns
+    -------
+    capacities : `list` [`int`]
+        Capacities at which to evaluate the hit rate.
+    """
+    capacities = []
+    capacity = 1
+    while capacity < numKeys:
+        capacities.append(capacity)
+        capacity *= 2
+    if numKeys > 0:
+        capacities.append(numKeys)
+    return capacities
+
+
+def replay(trace, capacities, policies=("lru",)):
+    """Compute hit-rate-vs-capacity curves of a trace.
+
+    Parameters
+    ----------
+    trace : `CacheTrace`
+        Requests to replay.
+    capacities : `list` [`int`]
+        Maximum number of elements of the cache.
+    policies : iterable of `str`
+        Eviction policies, from the keys of `POLICIES`.
+
+    Returns
+    -------
+    curves : `dict` [`str`, `list` [`float`]]
+        Hit rate at each capacity, for each policy.
+    """
+    curves = {}
+    for name in policies:
+        if name == "lru":
+            curves[name] = StackDistances(trace).getHitRates(capacities)
+        else:
+            curves[name] = simulateHitRates(trace, capacities, POLICIES[name])
+    return curves
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="Trace file, in the text or binary format")
+    parser.add_argument("--capacities", type=lambda text: [int(value) for value in text.split(",")],
+                        help="Comma-separated capacities (default: powers of two up to the number of keys)")
+    parser.add_argument("--policies", default="lru,slru,tinylfu",
+                        help="Comma-separated eviction policies, from: " + ", ".join(POLICIES))
+    parser.add_argument("--json", action="store_true", help="Write the curves as JSON")
+    parser.add_argument("--convert", metavar="FILE", help="Also write the trace in the binary format")
+    args = parser.parse_args(argv)
+
+    policies = args.policies.split(",")
+    unknown = [name for name in policies if name not in POLICIES]
+    if unknown:
+        parser.error(f"Unknown policies: {', '.join(unknown)}")
+    trace = CacheTrace.read(args.trace)
+    if args.convert:
+        trace.writeBinary(args.convert)
+    capacities = args.capacities if args.capacities else defaultCapacities(trace.getNumKeys())
+    if any(capacity <= 0 for capacity in capacities):
+        parser.error("Capacities must be positive")
+    curves = replay(trace, capacities, policies)
+
+    if args.json:
+        json.dump({"trace": args.trace, "requests": len(trace), "keys": trace.getNumKeys(),
+                   "capacities": capacities, "hitRates": curves}, sys.stdout, indent=2)
+        print()
+        return
+    print(f"# {args.trace}: {len(trace)} requests for {trace.getNumKeys()} keys")
+    print("capacity " + " ".join(f"{name:>8}" for name in policies))
+    for i, capacity in enumerate(capacities):
+        print(f"{capacity:8d} " + " ".join(f"{curves[name][i]:8.4f}" for name in policies))
@@ -0,0 +1,64 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+
+#include <chrono>
+
+#include "lsst/cpputils/python.h"
+#include "lsst/cpputils/Instrumentation.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace cpputils {
+
+void wrapInstrumentation(python::WrapperCollection & wrappers) {
+    wrappers.wrap(
+        [](auto & mod) {
+            // Were the instrumentation macros compiled in (in this package)?
+            mod.def("isEnabled", []() {
+#ifndef LSST_CPPUTILS_INSTRUMENTATION_DISABLE
+                return true;
+#else
+                return false;
+#endif
+            });
+            // Values of all counters since the last reset, as a dict mapping each name to a dict with keys
+            // "count" and "seconds"
+            mod.def("getCounters", []() {
+                py::dict result;
+                for (auto const & entry : CounterRegistry::get().getSnapshot()) {
+                    py::dict counter;
+                    counter["count"] = entry.count;
+                    counter["seconds"] = std::chrono::duration<double>(entry.time).count();
+                    result[entry.name.c_str()] = counter;
+                }
+                return result;
+            });
+            mod.def("resetCounters", []() { CounterRegistry::get().reset(); });
+        }
+    );
+}
+
+}  // utils
+}  // lsst
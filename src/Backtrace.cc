@@ -24,15 +24,12 @@
 
 #if defined(LSST_CPPUTILS_BACKTRACE_ENABLE) && (defined(__clang__) || defined(__GNUC__))
 
-#include <cerrno>
-#include <cstdio>
-#include <cstdlib>
+#include <atomic>
 #include <csignal>
+#include <cstddef>
 
-#include <cxxabi.h>
 #include <execinfo.h>
-
-#include <regex>
+#include <unistd.h>
 
 #include "lsst/cpputils/Backtrace.h"
 
@@ -41,68 +38,64 @@ namespace cpputils {
 
 namespace {
 
-/// Maximum number of frames in the backtrace
-static constexpr size_t MAX_FRAMES = 128;
-/// Estimated number of characters in name
-static constexpr size_t NAME_SIZE_ESTIMATE = 1024;
-
-/**
- * Print symbol list entry to stderr, demangling the name if possible
- *
- * @param[in] input entry produced by backtrace_symbol
- * @param[out] buffer allocated with malloc for output of the demangled name
- *               if the name does not fit the bufferSize is increased with realloc
- *               the user is responsible for freeing the buffer
- * @param[in,out] bufferSize size of the name buffer (increased if needed)
- *
- * @return buffer (possibly reallocated) buffer for demangled name,
- *                caller should always free this.
+/*
+ * Everything the signal handler needs is allocated statically (or when Backtrace is constructed),
+ * and the handler only uses async-signal-safe functions (backtrace and backtrace_symbols_fd are
+ * safe once the former has been called once, which loads the unwinder). Symbols are written
+ * mangled, as demangling allocates memory; pipe the output through c++filt to demangle it.
  */
-char *demangleAndPrint(char *input, char *buffer, size_t *bufferSize) noexcept {
-    int status = 1;
-
-    try {
-        std::cmatch matches;
-        std::regex rgx(
-                "(.*[\\s|\\(])"  // before
-                "(_\\w+)"        // mangled name
-                "(.*\\+.*)"      // after
-                );
-
-        if (std::regex_match(input, matches, rgx)) {
-            buffer = abi::__cxa_demangle(matches.str(2).c_str(), buffer, bufferSize, &status);
-            fprintf(stderr, "%s%s%s\n", matches.str(1).c_str(), buffer, matches.str(3).c_str());
-        }
-    } catch(const std::regex_error &e) {
-        fprintf(stderr, "[demangleAndPrint] %s\n", e.what());
-        status = 1;
-    } catch(const std::runtime_error &e) {
-        fprintf(stderr, "[demangleAndPrint] %s\n", e.what());
-        status = 1;
-    } catch(const std::exception &e) {
-        fprintf(stderr, "[demangleAndPrint] %s\n", e.what());
-        status = 1;
-    } catch(...) {
-        fprintf(stderr, "[demangleAndPrint] unknown error occurred in demangling\n");
-        status = 1;
-    }
 
-    if (status != 0) {
-        // no name found to demangle or name demangling failed
-        fprintf(stderr, "%s\n", input);
+/// Maximum number of frames in the backtrace
+static constexpr std::size_t MAX_FRAMES = 128;
+/// Size of the alternate stack on which the handler runs (so stack overflows can be reported)
+static constexpr std::size_t ALT_STACK_SIZE = 64*1024;
+/// Signals that are handled
+static constexpr int SIGNALS[] = {SIGABRT, SIGSEGV, SIGILL, SIGFPE, SIGBUS};
+
+/// Frames captured by the handler
+void *addressList[MAX_FRAMES];
+/// Alternate signal stack
+alignas(16) char altStack[ALT_STACK_SIZE];
+/// Set by the first thread to enter the handler
+std::atomic_flag handling = ATOMIC_FLAG_INIT;
+
+/// Write a string to stderr, ignoring errors
+void writeString(char const *str) noexcept {
+    std::size_t length = 0;
+    while (str[length] != '\0') ++length;
+    while (length > 0) {
+        ssize_t const written = write(STDERR_FILENO, str, length);
+        if (written <= 0) return;
+        str += written;
+        length -= written;
     }
-    return buffer;
+}
+
+/// Write a non-negative integer to stderr
+void writeNumber(int value) noexcept {
+    char buffer[16];
+    char *ptr = buffer + sizeof(buffer) - 1;
+    *ptr = '\0';
+    do {
+        *--ptr = '0' + value % 10;
+        value /= 10;
+    } while (value > 0 && ptr > buffer);
+    writeString(ptr);
 }
 
 /**
  * Restore default signal handler and re-raise.
  *
- * This prevents breaking the debugger.
+ * This prevents breaking the debugger, and lets the process terminate (and dump core) as it
+ * would have without the handler.
  *
  * @param[in] signum signal number to raise.
  */
 void raiseWithDefaultHandler(int signum) noexcept {
-    signal(signum, SIG_DFL);
+    struct sigaction action = {};
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(signum, &action, nullptr);
     raise(signum);
 }
 
@@ -111,57 +104,51 @@ void raiseWithDefaultHandler(int signum) noexcept {
  *
  * @param[in] signum signal number to handle.
  */
-void signalHandler(int signum) noexcept {
-    fprintf(stderr, "Caught signal %d, backtrace follows:\n", signum);
-
-    // retrieve current stack addresses
-    void *addressList[MAX_FRAMES + 1];
-    size_t addressLength = backtrace(addressList, MAX_FRAMES);
-    if (addressLength == 0) {
-        fprintf(stderr, "  \n");
+void signalHandler(int signum, siginfo_t *, void *) noexcept {
+    if (handling.test_and_set()) {
+        // Another thread is already reporting a failure; it will terminate the process
+        pause();
         return;
     }
-
-    // translate the addresses into an array of strings
-    // that describe the addresses symbolically.
-    // return value symbolList is malloc'ed and must be free'd
-    char **symbolList = backtrace_symbols(addressList, addressLength);
-    if (symbolList == NULL) {
-        fprintf(stderr, "[backtrace_symbols] cannot dump trace, probably out of memory\n");
-        raiseWithDefaultHandler(signum);
-    }
-
-    // allocate storage for demangled name
-    // this will be reallocated by abi::__cxa_demangle in demangleAndPrint
-    // if storage is insufficient, but if it is sufficient
-    // this reduces the number of allocations
-    size_t nameSize = NAME_SIZE_ESTIMATE;
-    char *name = (char *)malloc(nameSize * sizeof(char));
-    if (name == NULL) {
-        fprintf(stderr, "[malloc] cannot dump trace, probably out of memory\n");
-        raiseWithDefaultHandler(signum);
-    }
-
-    for (size_t i = 0; i < addressLength; ++i) {
-        if (char *buffer = demangleAndPrint(symbolList[i], name, &nameSize)) {
-            // buffer may have been realloc'ed
-            name = buffer;
-        }
+    writeString("Caught signal ");
+    writeNumber(signum);
+    writeString(", backtrace follows:\n");
+
+    // retrieve current stack addresses, and write them with their (mangled) symbols
+    int const addressLength = backtrace(addressList, MAX_FRAMES);
+    if (addressLength > 0) {
+        backtrace_symbols_fd(addressList, addressLength, STDERR_FILENO);
+    } else {
+        writeString("  \n");
     }
 
-    free(name);
-    free(symbolList);
     raiseWithDefaultHandler(signum);
 }
 
 }  // namespace
 
 Backtrace::Backtrace() noexcept : enabled(true) {
+    // Load the unwinder now: the first call to backtrace may allocate memory
+    backtrace(addressList, MAX_FRAMES);
+
+    // Run the handler on its own stack, so stack overflows can be reported
+    // (alternate stacks are per-thread, so this covers the thread constructing the singleton)
+    stack_t stack = {};
+    stack.ss_sp = altStack;
+    stack.ss_size = ALT_STACK_SIZE;
+    sigaltstack(&stack, nullptr);
+
     // Register abort handlers
-    signal(SIGABRT, signalHandler);
-    signal(SIGSEGV, signalHandler);
-    signal(SIGILL, signalHandler);
-    signal(SIGFPE, signalHandler);
+    struct sigaction action = {};
+    action.sa_sigaction = signalHandler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int signum : SIGNALS) {
+        sigaddset(&action.sa_mask, signum);
+    }
+    for (int signum : SIGNALS) {
+        sigaction(signum, &action, nullptr);
+    }
 }
 
 }  // namespace cpputils
@@ -0,0 +1,92 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2017  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "lsst/cpputils/CacheSpill.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lsst {
+namespace cpputils {
+
+std::shared_ptr<MappedFile const> MappedFile::open(std::string const& filename) {
+    int const fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          "Cannot open " + filename + ": " + std::strerror(errno));
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        int const error = errno;
+        ::close(fd);
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          "Cannot stat " + filename + ": " + std::strerror(error));
+    }
+    std::size_t const size = status.st_size;
+    void* data = nullptr;
+    if (size > 0) {
+        data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int const error = errno;
+            ::close(fd);
+            throw LSST_EXCEPT(pex::exceptions::IoError,
+                              "Cannot map " + filename + ": " + std::strerror(error));
+        }
+    }
+    ::close(fd);  // The mapping holds its own reference to the file
+    return std::shared_ptr<MappedFile const>(new MappedFile(data, size));
+}
+
+MappedFile::~MappedFile() noexcept {
+    if (_data) {
+        ::munmap(_data, _size);
+    }
+}
+
+namespace detail {
+
+std::string makeUniqueFile(std::string const& directory, std::string const& prefix) {
+    std::string const pattern = directory + "/" + prefix + "XXXXXX";
+    std::vector<char> filename(pattern.begin(), pattern.end());
+    filename.push_back('\0');
+    int const fd = ::mkstemp(filename.data());  // Creates the file exclusively
+    if (fd < 0) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          "Cannot create file in " + directory + ": " + std::strerror(errno));
+    }
+    ::close(fd);
+    return std::string(filename.data());
+}
+
+}  // namespace detail
+
+}  // namespace cpputils
+}  // namespace lsst
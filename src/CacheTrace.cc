@@ -0,0 +1,276 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2017  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "lsst/cpputils/CacheTrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/cpputils/Cache.h"
+
+namespace lsst {
+namespace cpputils {
+
+namespace {
+
+std::size_t const MAGIC_SIZE = std::strlen(CacheTrace::MAGIC);
+
+void writeVarint(std::streambuf & buffer, std::uint64_t value) {
+    while (value >= 0x80) {
+        buffer.sputc(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.sputc(static_cast<char>(value));
+}
+
+std::uint64_t readVarint(std::streambuf & buffer) {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        auto const byte = buffer.sbumpc();
+        if (byte == std::char_traits<char>::eof()) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Unexpected end of cache trace");
+        }
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw LSST_EXCEPT(pex::exceptions::IoError, "Invalid integer in cache trace");
+}
+
+std::ifstream openInput(std::string const& filename) {
+    std::ifstream input(filename, std::ios::binary);
+    if (!input) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Cannot open cache trace " + filename);
+    }
+    return input;
+}
+
+// Replay a trace through caches of each capacity, all in one pass
+template <typename Policy>
+std::vector<double> simulate(CacheTrace const& trace, std::vector<std::size_t> const& capacities) {
+    using SimulatedCache = Cache<CacheTrace::KeyId, bool, std::hash<CacheTrace::KeyId>,
+                                 std::equal_to<CacheTrace::KeyId>, Policy>;
+    std::vector<SimulatedCache> caches;
+    caches.reserve(capacities.size());
+    for (std::size_t capacity : capacities) {
+        caches.emplace_back(capacity, typename SimulatedCache::Weigher(), 0, Policy());
+    }
+    auto const generate = [](CacheTrace::KeyId) { return true; };
+    for (CacheTrace::KeyId key : trace.getRequests()) {
+        for (auto & cache : caches) {
+            cache(key, generate);
+        }
+    }
+    std::vector<double> result;
+    result.reserve(caches.size());
+    for (auto const& cache : caches) {
+        result.push_back(cache.stats().hitRate());
+    }
+    return result;
+}
+
+}  // anonymous namespace
+
+CacheTrace::CacheTrace(std::vector<KeyId> requests, std::size_t numKeys)
+  : _requests(std::move(requests)), _numKeys(numKeys) {
+    if (!_requests.empty() && *std::max_element(_requests.begin(), _requests.end()) >= numKeys) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          "Key identifiers must be less than the number of keys");
+    }
+}
+
+CacheTrace CacheTrace::read(std::string const& filename) {
+    std::ifstream input = openInput(filename);
+    std::string magic(MAGIC_SIZE, '\0');
+    input.read(&magic[0], MAGIC_SIZE);
+    bool const binary = input && magic == MAGIC;
+    input.clear();
+    input.seekg(0);
+    return binary ? readBinary(input) : readText(input);
+}
+
+CacheTrace CacheTrace::readText(std::string const& filename) {
+    std::ifstream input = openInput(filename);
+    return readText(input);
+}
+
+CacheTrace CacheTrace::readText(std::istream& input) {
+    CacheTraceRecorder<std::string> recorder;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        recorder.record(line);
+    }
+    if (input.bad()) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Error reading cache trace");
+    }
+    return recorder.getTrace();
+}
+
+CacheTrace CacheTrace::readBinary(std::string const& filename) {
+    std::ifstream input = openInput(filename);
+    return readBinary(input);
+}
+
+CacheTrace CacheTrace::readBinary(std::istream& input) {
+    std::string magic(MAGIC_SIZE, '\0');
+    if (!input.read(&magic[0], MAGIC_SIZE) || magic != MAGIC) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Not a binary cache trace");
+    }
+    std::streambuf & buffer = *input.rdbuf();
+    std::uint64_t const numKeys = readVarint(buffer);
+    std::uint64_t const numRequests = readVarint(buffer);
+    if (numKeys > std::numeric_limits<KeyId>::max() + std::uint64_t(1)) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Too many keys in cache trace");
+    }
+    CacheTrace result;
+    result._numKeys = numKeys;
+    // Don't trust the header with the size of the allocation: the identifiers are read one by one
+    result._requests.reserve(std::min<std::uint64_t>(numRequests, 1 << 20));
+    for (std::uint64_t i = 0; i < numRequests; ++i) {
+        std::uint64_t const key = readVarint(buffer);
+        if (key >= numKeys) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Invalid key identifier in cache trace");
+        }
+        result._requests.push_back(static_cast<KeyId>(key));
+    }
+    return result;
+}
+
+void CacheTrace::writeBinary(std::string const& filename) const {
+    std::ofstream output(filename, std::ios::binary);
+    if (!output) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Cannot open cache trace " + filename);
+    }
+    writeBinary(output);
+    output.close();
+    if (!output) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Error writing cache trace " + filename);
+    }
+}
+
+void CacheTrace::writeBinary(std::ostream& output) const {
+    output.write(MAGIC, MAGIC_SIZE);
+    std::streambuf & buffer = *output.rdbuf();
+    writeVarint(buffer, _numKeys);
+    writeVarint(buffer, _requests.size());
+    for (KeyId key : _requests) {
+        writeVarint(buffer, key);
+    }
+    if (!output.flush()) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Error writing cache trace");
+    }
+}
+
+void CacheTrace::append(KeyId key) {
+    _requests.push_back(key);
+    _numKeys = std::max<std::size_t>(_numKeys, std::size_t(key) + 1);
+}
+
+StackDistances::StackDistances(CacheTrace const& trace)
+  : _numRequests(trace.size()), _numCompulsory(0), _histogram(trace.getNumKeys(), 0) {
+    std::vector<CacheTrace::KeyId> const& requests = trace.getRequests();
+    std::size_t const num = requests.size();
+    // Fenwick tree over request times, with a one at the time of the latest request for each key
+    std::vector<std::uint32_t> tree(num + 1, 0);
+    auto const add = [&tree, num](std::size_t index, std::int32_t delta) {
+        for (++index; index <= num; index += index & -index) {
+            tree[index] += delta;
+        }
+    };
+    // Number of ones at times before `index`
+    auto const count = [&tree](std::size_t index) {
+        std::uint64_t total = 0;
+        for (; index > 0; index -= index & -index) {
+            total += tree[index];
+        }
+        return total;
+    };
+    std::size_t const never = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> latest(trace.getNumKeys(), never);
+    std::uint64_t numLatest = 0;  // Number of ones in the tree
+    for (std::size_t time = 0; time < num; ++time) {
+        std::size_t & previous = latest[requests[time]];
+        if (previous == never) {
+            ++_numCompulsory;
+            ++numLatest;
+        } else {
+            // Distinct keys requested since the previous request are those with their latest request after it
+            ++_histogram[numLatest - count(previous + 1)];
+            add(previous, -1);
+        }
+        add(time, 1);
+        previous = time;
+    }
+    _cumulative.resize(_histogram.size());
+    std::uint64_t total = 0;
+    for (std::size_t distance = 0; distance < _histogram.size(); ++distance) {
+        total += _histogram[distance];
+        _cumulative[distance] = total;
+    }
+}
+
+double StackDistances::getHitRate(std::size_t capacity) const {
+    if (_numRequests == 0 || capacity == 0 || _cumulative.empty()) {
+        return 0.0;
+    }
+    std::size_t const last = std::min(capacity, _cumulative.size()) - 1;
+    return static_cast<double>(_cumulative[last])/_numRequests;
+}
+
+std::vector<double> StackDistances::getHitRates(std::vector<std::size_t> const& capacities) const {
+    std::vector<double> result;
+    result.reserve(capacities.size());
+    for (std::size_t capacity : capacities) {
+        result.push_back(getHitRate(capacity));
+    }
+    return result;
+}
+
+std::vector<double> simulateHitRates(CacheTrace const& trace, std::vector<std::size_t> const& capacities,
+                                     CacheTracePolicy policy) {
+    if (std::find(capacities.begin(), capacities.end(), 0u) != capacities.end()) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, "Simulated capacities must be positive");
+    }
+    switch (policy) {
+        case CacheTracePolicy::LRU:
+            return simulate<LruPolicy>(trace, capacities);
+        case CacheTracePolicy::SLRU:
+            return simulate<SlruPolicy>(trace, capacities);
+        case CacheTracePolicy::TINY_LFU:
+            return simulate<TinyLfuPolicy>(trace, capacities);
+    }
+    throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, "Unknown cache policy");
+}
+
+}  // namespace cpputils
+}  // namespace lsst
@@ -21,10 +21,12 @@
  */
 
 #include "lsst/cpputils/Demangle.h"
+#include "lsst/cpputils/Cache.h"
 
 #include <iostream>
 #include <string>
 #include <stack>
+#include <utility>
 #include <boost/format.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
@@ -44,16 +46,12 @@ public:
     int n;                              // index of substitution
     std::string key;                    // key to saved string
 
-    Symbol(std::string key) : n(n_next++), key(key) { }
+    Symbol(int n, std::string key) : n(n), key(std::move(key)) { }
     ~Symbol() {}
 
-    static void reset() { n_next = 0; } // reset counter
-
     void print() const {
         std::cout << '\t' << n << " " << key << '\n';
     }
-private:
-    static int n_next;                  // the next value of n
 };
 
 /*
@@ -62,7 +60,12 @@ private:
 struct n {};                            // lookup by n
 struct key {};                          // lookup by key
 
-int Symbol::n_next = 0;                 // unique ID for each symbol
+namespace {
+/*
+ * Number of demangled names remembered by each thread
+ */
+std::size_t const DEMANGLE_CACHE_SIZE = 1000;
+}
 
 /*! \brief Try to demangle a C++ type
  *
@@ -110,7 +113,12 @@ static bool interpret_typeletter(const char c, std::string &type) {
 }
 
 
-std::string demangleType(std::string const _typeName) {
+/*
+ * Demangle a type name, without memoization.
+ *
+ * All the state (in particular the symbol table) is local, so this is reentrant.
+ */
+static std::string demangleTypeUncached(std::string const& _typeName) {
 #if 1
     typedef multi_index_container<
         Symbol,
@@ -123,7 +131,6 @@ std::string demangleType(std::string const _typeName) {
     > SymbolTable;
     typedef SymbolTable::index<n>::type::iterator nIterator;
     typedef SymbolTable::index<key>::type::iterator keyIterator;
-    Symbol::reset();
 
     // Here's my symbol table and its indices
     SymbolTable st;
@@ -134,6 +141,7 @@ std::string demangleType(std::string const _typeName) {
     // Start mangling
     //
     std::string typeName("");
+    typeName.reserve(2*_typeName.size());
     const char *ptr = _typeName.c_str();
 
     if (*ptr == 'r' || *ptr == 'V' || *ptr == 'K') {
@@ -264,7 +272,7 @@ std::string demangleType(std::string const _typeName) {
                 typeName += name;
 
                 if (keyIndex.find(currentSymbol) == keyIndex.end()) {
-                    st.insert(currentSymbol);
+                    st.insert(Symbol(st.size(), currentSymbol)); // substitutions are numbered in order
                 }
 	    }
             break;
@@ -303,4 +311,10 @@ std::string demangleType(std::string const _typeName) {
 #endif
 }
 
+std::string demangleType(std::string const& _typeName) {
+    // Each thread has its own cache, so no locking is needed
+    thread_local Cache<std::string, std::string> cache(DEMANGLE_CACHE_SIZE);
+    return cache(_typeName, demangleTypeUncached);
+}
+
 }} // namespace lsst::cpputils
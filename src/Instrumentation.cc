@@ -0,0 +1,116 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2017  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "lsst/cpputils/Instrumentation.h"
+
+#include <algorithm>
+
+#include "lsst/pex/exceptions.h"
+
+namespace lsst {
+namespace cpputils {
+
+CounterRegistry & CounterRegistry::get() noexcept {
+    // Never destroyed, so that threads exiting after static destruction can still release their counters
+    static CounterRegistry * registry = new CounterRegistry();
+    return *registry;
+}
+
+std::size_t CounterRegistry::getId(std::string const& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto const iter = _ids.find(name);
+    if (iter != _ids.end()) {
+        return iter->second;
+    }
+    if (_names.size() >= MAX_COUNTERS) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          "Too many counters (" + std::to_string(MAX_COUNTERS) + "); cannot add " + name);
+    }
+    std::size_t const id = _names.size();
+    _names.push_back(name);
+    _ids.emplace(name, id);
+    return id;
+}
+
+detail::ThreadCounters * CounterRegistry::_acquireThreadCounters() {
+    // Adopt the block of a thread that has exited, if there is one
+    for (detail::ThreadCounters * block = _threads.load(std::memory_order_acquire); block;
+         block = block->next) {
+        bool expected = false;
+        if (block->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return block;
+        }
+    }
+    auto * block = new detail::ThreadCounters();
+    block->next = _threads.load(std::memory_order_relaxed);
+    while (!_threads.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    return block;
+}
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>> CounterRegistry::_sum(std::size_t numCounters) const {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> sums(numCounters, {0, 0});
+    using detail::ThreadCounters;
+    for (ThreadCounters const * block = _threads.load(std::memory_order_acquire); block;
+         block = block->next) {
+        for (std::size_t first = 0; first < numCounters; first += ThreadCounters::PAGE_SIZE) {
+            detail::CounterSlot const * page =
+                    block->pages[first/ThreadCounters::PAGE_SIZE].load(std::memory_order_acquire);
+            if (!page) {
+                continue;
+            }
+            std::size_t const num = std::min(ThreadCounters::PAGE_SIZE, numCounters - first);
+            for (std::size_t ii = 0; ii < num; ++ii) {
+                sums[first + ii].first += page[ii].count.load(std::memory_order_relaxed);
+                sums[first + ii].second += page[ii].nanoseconds.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return sums;
+}
+
+std::vector<CounterSnapshot> CounterRegistry::getSnapshot() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto const sums = _sum(_names.size());
+    std::vector<CounterSnapshot> result;
+    result.reserve(sums.size());
+    std::pair<std::uint64_t, std::uint64_t> const zero(0, 0);  // Baseline of counters added since the reset
+    for (std::size_t id = 0; id < sums.size(); ++id) {
+        auto const& baseline = id < _baseline.size() ? _baseline[id] : zero;
+        result.push_back({_names[id], sums[id].first - baseline.first,
+                          std::chrono::nanoseconds(sums[id].second - baseline.second)});
+    }
+    std::sort(result.begin(), result.end(),
+              [](CounterSnapshot const& a, CounterSnapshot const& b) { return a.name < b.name; });
+    return result;
+}
+
+void CounterRegistry::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _baseline = _sum(_names.size());
+}
+
+}  // namespace cpputils
+}  // namespace lsst
@@ -27,9 +27,61 @@
 namespace lsst {
 namespace cpputils {
 
-double nanojanskyToABMagnitude(double flux) { return -2.5 * log10(flux / referenceFlux); }
+namespace {
 
-double ABMagnitudeToNanojansky(double magnitude) { return pow(10, magnitude / -2.5) * referenceFlux; }
+// The scalar conversions, inline so the batch loops below can be optimized
+inline double toMagnitude(double flux) { return -2.5 * log10(flux / referenceFlux); }
+
+inline double toFlux(double magnitude) { return pow(10, magnitude / -2.5) * referenceFlux; }
+
+// d(magnitude)/d(flux) = -2.5/(ln(10) flux)
+double const magnitudeErrScale = 2.5 / std::log(10.0);
+
+inline double toMagnitudeErr(double flux, double fluxErr) {
+    return std::abs(magnitudeErrScale * fluxErr / flux);
+}
+
+inline double toFluxErr(double magnitude, double magnitudeErr) {
+    return std::abs(magnitudeErr * toFlux(magnitude) / magnitudeErrScale);
+}
+
+}  // namespace
+
+double nanojanskyToABMagnitude(double flux) { return toMagnitude(flux); }
+
+double ABMagnitudeToNanojansky(double magnitude) { return toFlux(magnitude); }
+
+double nanojanskyErrToABMagnitudeErr(double flux, double fluxErr) { return toMagnitudeErr(flux, fluxErr); }
+
+double ABMagnitudeErrToNanojanskyErr(double magnitude, double magnitudeErr) {
+    return toFluxErr(magnitude, magnitudeErr);
+}
+
+void nanojanskyToABMagnitude(double const* flux, double* magnitude, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        magnitude[i] = toMagnitude(flux[i]);
+    }
+}
+
+void ABMagnitudeToNanojansky(double const* magnitude, double* flux, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        flux[i] = toFlux(magnitude[i]);
+    }
+}
+
+void nanojanskyErrToABMagnitudeErr(double const* flux, double const* fluxErr, double* magnitudeErr,
+                                   std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        magnitudeErr[i] = toMagnitudeErr(flux[i], fluxErr[i]);
+    }
+}
+
+void ABMagnitudeErrToNanojanskyErr(double const* magnitude, double const* magnitudeErr, double* fluxErr,
+                                   std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        fluxErr[i] = toFluxErr(magnitude[i], magnitudeErr[i]);
+    }
+}
 
 }  // namespace cpputils
 }  // namespace lsst
@@ -0,0 +1,274 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2017  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "lsst/cpputils/SamplingProfiler.h"
+
+#include "lsst/pex/exceptions.h"
+
+#if defined(LSST_CPPUTILS_BACKTRACE_ENABLE) && (defined(__clang__) || defined(__GNUC__))
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <sys/time.h>
+
+namespace lsst {
+namespace cpputils {
+
+namespace {
+
+/// Frames at the top of each captured stack that belong to the handler (itself and the signal trampoline)
+constexpr int HANDLER_FRAMES = 2;
+
+/*
+ * State shared with the signal handler
+ *
+ * The buffers are allocated by start and only freed by a later start, once the handler can no longer
+ * be using them.
+ */
+std::unique_ptr<void *[]> frames;  // MAX_DEPTH frames per sample, innermost first
+std::unique_ptr<std::atomic<int>[]> depths;  // Number of frames in each sample; zero until written
+std::size_t capacity = 0;  // Number of samples that fit in the buffers
+std::atomic<std::size_t> nextSample{0};  // Index of the next sample to write
+std::atomic<bool> running{false};  // Is the handler recording samples?
+std::atomic<int> inHandler{0};  // Number of handlers currently running
+
+/// Lock for the controlling methods
+std::mutex controlMutex;
+/// Has the handler been installed? It is never removed, as a SIGPROF may still be pending after stop.
+bool handlerInstalled = false;
+
+void profileHandler(int, siginfo_t *, void *) noexcept {
+    int const savedErrno = errno;
+    ++inHandler;
+    if (running.load()) {
+        std::size_t const index = nextSample.fetch_add(1, std::memory_order_relaxed);
+        if (index < capacity) {
+            void *stack[SamplingProfiler::MAX_DEPTH + HANDLER_FRAMES];
+            int const depth = backtrace(stack, SamplingProfiler::MAX_DEPTH + HANDLER_FRAMES) - HANDLER_FRAMES;
+            if (depth > 0) {
+                std::copy(stack + HANDLER_FRAMES, stack + HANDLER_FRAMES + depth,
+                          frames.get() + index*SamplingProfiler::MAX_DEPTH);
+                depths[index].store(depth, std::memory_order_release);
+            }
+        }
+    }
+    --inHandler;
+    errno = savedErrno;
+}
+
+/**
+ * Name of a frame, from its entry produced by backtrace_symbols.
+ *
+ * The entry has the form "module(symbol+offset) [address]"; the symbol is demangled if possible, and
+ * frames without a symbol are named after their module.
+ */
+std::string frameName(char const *entry) {
+    char const *open = std::strchr(entry, '(');
+    char const *plus = open ? std::strchr(open, '+') : nullptr;
+    if (!open || !plus || plus == open + 1) {
+        std::string module(entry, open ? open : entry + std::strlen(entry));
+        std::size_t const slash = module.rfind('/');
+        return "[" + (slash == std::string::npos ? module : module.substr(slash + 1)) + "]";
+    }
+    std::string const mangled(open + 1, plus);
+    int status = 1;
+    char *demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+    std::string result = (status == 0 && demangled) ? demangled : mangled;
+    std::free(demangled);
+    return result;
+}
+
+}  // namespace
+
+SamplingProfiler::SamplingProfiler() noexcept : supported(true) {}
+
+bool SamplingProfiler::isRunning() const noexcept { return running.load(); }
+
+void SamplingProfiler::start(double interval, std::size_t maxSamples) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (running.load()) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError, "Sampling profiler is already running");
+    }
+    if (!(interval > 0) || maxSamples == 0) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          "Sampling interval and maximum number of samples must be positive");
+    }
+    // Load the unwinder now: the first call to backtrace may allocate memory
+    void *dummy[1];
+    backtrace(dummy, 1);
+
+    frames.reset(new void *[maxSamples*MAX_DEPTH]);
+    depths.reset(new std::atomic<int>[maxSamples]);
+    for (std::size_t i = 0; i < maxSamples; ++i) {
+        depths[i].store(0, std::memory_order_relaxed);
+    }
+    capacity = maxSamples;
+    nextSample.store(0);
+
+    if (!handlerInstalled) {
+        struct sigaction action = {};
+        action.sa_sigaction = profileHandler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, nullptr) != 0) {
+            throw LSST_EXCEPT(pex::exceptions::RuntimeError,
+                              std::string("Cannot install SIGPROF handler: ") + std::strerror(errno));
+        }
+        handlerInstalled = true;
+    }
+    running.store(true);
+
+    struct itimerval timer = {};
+    double const seconds = std::floor(interval);
+    timer.it_interval.tv_sec = static_cast<time_t>(seconds);
+    timer.it_interval.tv_usec = std::max<suseconds_t>(1, static_cast<suseconds_t>((interval - seconds)*1e6));
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        int const error = errno;
+        running.store(false);
+        throw LSST_EXCEPT(pex::exceptions::RuntimeError,
+                          std::string("Cannot set profiling timer: ") + std::strerror(error));
+    }
+}
+
+void SamplingProfiler::stop() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (!running.load()) {
+        return;
+    }
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    running.store(false);
+    // Wait for any handlers still recording a sample; the handler stays installed, and ignores any
+    // SIGPROF still pending
+    while (inHandler.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+std::size_t SamplingProfiler::getNumSamples() const noexcept {
+    return std::min(nextSample.load(), capacity);
+}
+
+std::size_t SamplingProfiler::getNumDropped() const noexcept {
+    std::size_t const total = nextSample.load();
+    return total > capacity ? total - capacity : 0;
+}
+
+std::string SamplingProfiler::getFoldedStacks() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (running.load()) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError, "Cannot read samples while the profiler is running");
+    }
+    std::size_t const num = getNumSamples();
+
+    // Symbolize each distinct address once
+    std::unordered_map<void *, std::string> names;
+    {
+        std::vector<void *> addresses;
+        for (std::size_t i = 0; i < num; ++i) {
+            void *const *sample = frames.get() + i*MAX_DEPTH;
+            for (int j = 0; j < depths[i].load(); ++j) {
+                if (names.emplace(sample[j], std::string()).second) {
+                    addresses.push_back(sample[j]);
+                }
+            }
+        }
+        if (!addresses.empty()) {
+            std::unique_ptr<char *, void (*)(void *)> symbols(
+                    backtrace_symbols(addresses.data(), addresses.size()), std::free);
+            for (std::size_t i = 0; i < addresses.size(); ++i) {
+                names[addresses[i]] = symbols ? frameName(symbols.get()[i]) : "[unknown]";
+            }
+        }
+    }
+
+    // Count the distinct stacks, outermost frame first
+    std::map<std::string, std::size_t> counts;
+    for (std::size_t i = 0; i < num; ++i) {
+        void *const *sample = frames.get() + i*MAX_DEPTH;
+        int const depth = depths[i].load();
+        if (depth == 0) {
+            continue;
+        }
+        std::string stack;
+        for (int j = depth - 1; j >= 0; --j) {
+            stack += names[sample[j]];
+            if (j > 0) {
+                stack += ';';
+            }
+        }
+        ++counts[stack];
+    }
+
+    std::ostringstream os;
+    for (auto const& entry : counts) {
+        os << entry.first << ' ' << entry.second << '\n';
+    }
+    return os.str();
+}
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#else
+
+namespace lsst {
+namespace cpputils {
+
+SamplingProfiler::SamplingProfiler() noexcept : supported(false) {}
+
+bool SamplingProfiler::isRunning() const noexcept { return false; }
+
+void SamplingProfiler::start(double, std::size_t) {
+    throw LSST_EXCEPT(pex::exceptions::RuntimeError, "Sampling profiler is not supported on this platform");
+}
+
+void SamplingProfiler::stop() {}
+
+std::size_t SamplingProfiler::getNumSamples() const noexcept { return 0; }
+
+std::size_t SamplingProfiler::getNumDropped() const noexcept { return 0; }
+
+std::string SamplingProfiler::getFoldedStacks() const { return std::string(); }
+
+}  // namespace cpputils
+}  // namespace lsst
+
+#endif
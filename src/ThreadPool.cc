@@ -0,0 +1,295 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2017  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "lsst/cpputils/ThreadPool.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace lsst {
+namespace cpputils {
+
+namespace {
+
+// Index of the worker running on this thread, and the pool it belongs to
+thread_local ThreadPool const *currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+
+// Parse a positive integer, returning zero if the text is not one
+std::size_t parsePositive(std::string const& text) {
+    char *end = nullptr;
+    long long const value = std::strtoll(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || value <= 0) {
+        return 0;
+    }
+    return static_cast<std::size_t>(value);
+}
+
+// Number of CPUs allowed by a quota and period, rounded up, or zero if there is no quota
+std::size_t quotaCpus(double quota, double period) {
+    if (!(quota > 0) || !(period > 0)) {
+        return 0;
+    }
+    return std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(quota/period)));
+}
+
+// Number of CPUs this process may run on, or zero if unknown
+std::size_t getAffinityCpus() {
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+        return CPU_COUNT(&cpus);
+    }
+#endif
+    return 0;
+}
+
+// Quota of a cgroup v2 directory, from "<quota> <period>", or "max <period>" if unlimited; zero if none
+std::size_t getCgroupV2Cpus(std::string const& dir) {
+    std::ifstream file(dir + "/cpu.max");
+    std::string quota;
+    double period = 0;
+    if (file >> quota >> period && quota != "max") {
+        return quotaCpus(std::atof(quota.c_str()), period);
+    }
+    return 0;
+}
+
+// Quota of a cgroup v1 directory, with a quota of -1 if unlimited; zero if none
+std::size_t getCgroupV1Cpus(std::string const& dir) {
+    std::ifstream quotaFile(dir + "/cpu.cfs_quota_us");
+    std::ifstream periodFile(dir + "/cpu.cfs_period_us");
+    double quota = 0;
+    double period = 0;
+    if (quotaFile >> quota && periodFile >> period) {
+        return quotaCpus(quota, period);
+    }
+    return 0;
+}
+
+// Smallest quota of a cgroup and its ancestors, up to the mount point (which, inside a cgroup
+// namespace, is itself the process's cgroup, whatever path is reported)
+std::size_t getHierarchyCpus(std::string const& mount, std::string path,
+                             std::size_t (*getCpus)(std::string const&)) {
+    std::size_t result = 0;
+    while (true) {
+        std::size_t const cpus = getCpus(mount + path);
+        if (cpus > 0 && (result == 0 || cpus < result)) {
+            result = cpus;
+        }
+        std::size_t const slash = path.rfind('/');
+        if (path.empty() || slash == std::string::npos) {
+            break;
+        }
+        path.erase(slash);
+    }
+    return result;
+}
+
+}  // namespace
+
+namespace detail {
+
+std::size_t getCgroupCpus(std::string const& procCgroup, std::string const& mountPoint) {
+    // Each line is "<hierarchy>:<controllers>:<path>"; cgroup v2 has a single line, "0::<path>"
+    std::ifstream file(procCgroup);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::size_t const first = line.find(':');
+        std::size_t const second = first == std::string::npos ? first : line.find(':', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        std::string const controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+        std::string path = line.substr(second + 1);
+        if (path == "/") {
+            path.clear();
+        }
+        if (controllers == ",,") {
+            std::size_t const cpus = getHierarchyCpus(mountPoint, path, getCgroupV2Cpus);
+            if (cpus > 0) {
+                return cpus;
+            }
+        } else if (controllers.find(",cpu,") != std::string::npos) {
+            for (std::string const dir : {"/cpu", "/cpu,cpuacct"}) {
+                std::size_t const cpus = getHierarchyCpus(mountPoint + dir, path, getCgroupV1Cpus);
+                if (cpus > 0) {
+                    return cpus;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace detail
+
+std::size_t getDefaultNumThreads() {
+    if (char const *env = std::getenv("LSST_CPPUTILS_NUM_THREADS")) {
+        std::size_t const num = parsePositive(env);
+        if (num > 0) {
+            return num;
+        }
+    }
+    std::size_t num = getAffinityCpus();
+    if (num == 0) {
+        num = std::thread::hardware_concurrency();
+    }
+    std::size_t const quota = detail::getCgroupCpus();
+    if (quota > 0 && (num == 0 || quota < num)) {
+        num = quota;
+    }
+    return std::max<std::size_t>(num, 1);
+}
+
+ThreadPool::ThreadPool(std::size_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = getDefaultNumThreads();
+    }
+    _workers.reserve(numThreads);
+    for (std::size_t ii = 0; ii < numThreads; ++ii) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    _threads.reserve(numThreads);
+    for (std::size_t ii = 0; ii < numThreads; ++ii) {
+        _threads.emplace_back(&ThreadPool::_run, this, ii);
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stop = true;
+    }
+    _wakeup.notify_all();
+    for (auto & thread : _threads) {
+        thread.join();
+    }
+}
+
+ThreadPool & ThreadPool::getDefault() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    std::size_t const index = (currentPool == this) ? currentWorker
+                                                    : _nextQueue.fetch_add(1) % _workers.size();
+    {
+        Worker & worker = *_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    {
+        // Taking the lock ensures a worker about to sleep sees the new task
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        ++_numQueued;
+    }
+    _wakeup.notify_one();
+}
+
+bool ThreadPool::_runOne(std::size_t index) {
+    std::function<void()> task;
+    {
+        Worker & own = *_workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (std::size_t ii = 1; !task && ii < _workers.size(); ++ii) {
+        Worker & victim = *_workers[(index + ii) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    --_numQueued;
+    try {
+        task();
+    } catch (...) {
+        // Discarded, as documented; parallelFor catches its own exceptions
+    }
+    return true;
+}
+
+void ThreadPool::_run(std::size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    while (true) {
+        if (_runOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wakeup.wait(lock, [this] { return _stop || _numQueued.load() > 0; });
+        if (_stop && _numQueued.load() == 0) {
+            return;
+        }
+    }
+}
+
+namespace detail {
+
+void ParallelForState::work() {
+    while (true) {
+        std::size_t const chunk = nextChunk.fetch_add(1);
+        if (chunk >= numChunks) {
+            return;
+        }
+        if (!failed.load()) {
+            std::size_t const chunkBegin = begin + chunk*chunkSize;
+            std::size_t const chunkEnd = std::min(chunkBegin + chunkSize, end);
+            try {
+                (*func)(chunkBegin, chunkEnd);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true);
+            }
+        }
+        if (numFinished.fetch_add(1) + 1 == numChunks) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+}  // namespace detail
+
+}  // namespace cpputils
+}  // namespace lsst
@@ -22,11 +22,14 @@
 
 #include "lsst/cpputils/packaging.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include "lsst/pex/exceptions.h"
 
+extern char **environ;
+
 namespace lsst {
 namespace cpputils {
 
@@ -44,4 +47,95 @@ std::string getPackageDir(std::string const& packageName) {
     return dir;
 }
 
+namespace {
+
+char toUpper(char c) { return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c; }
+
+std::string_view const DIR_SUFFIX = "_DIR";
+
+}  // namespace
+
+std::size_t PackageDirResolver::UpperHash::operator()(std::string_view str) const noexcept {
+    std::size_t hash = 14695981039346656037ULL;  // FNV-1a
+    for (char c : str) {
+        hash = (hash ^ static_cast<unsigned char>(toUpper(c)))*1099511628211ULL;
+    }
+    return hash;
+}
+
+bool PackageDirResolver::UpperEqual::operator()(std::string_view a, std::string_view b) const noexcept {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return toUpper(x) == toUpper(y); });
+}
+
+PackageDirResolver::PackageDirResolver() : _current(nullptr) { refresh(); }
+
+PackageDirResolver& PackageDirResolver::get() {
+    static PackageDirResolver resolver;
+    return resolver;
+}
+
+void PackageDirResolver::refresh() {
+    auto snapshot = std::make_unique<Snapshot>();
+    for (char **env = environ; env && *env; ++env) {
+        std::string_view const entry(*env);
+        std::size_t const equals = entry.find('=');
+        if (equals == std::string_view::npos || equals <= DIR_SUFFIX.size() ||
+            entry.substr(equals - DIR_SUFFIX.size(), DIR_SUFFIX.size()) != DIR_SUFFIX) {
+            continue;
+        }
+        // Only upper-case names can be found by upper-casing the package name, as getPackageDir does
+        std::string_view const name = entry.substr(0, equals - DIR_SUFFIX.size());
+        if (std::any_of(name.begin(), name.end(), [](char c) { return c >= 'a' && c <= 'z'; })) {
+            continue;
+        }
+        snapshot->storage.emplace_back(entry);
+    }
+    // The storage is complete, so views into it are stable
+    for (std::string_view entry : snapshot->storage) {
+        std::size_t const equals = entry.find('=');
+        snapshot->dirs.emplace(entry.substr(0, equals - DIR_SUFFIX.size()), entry.substr(equals + 1));
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _current.store(snapshot.get(), std::memory_order_release);
+    _snapshots.push_back(std::move(snapshot));
+}
+
+std::string_view PackageDirResolver::find(std::string_view packageName) const noexcept {
+    Snapshot const* snapshot = _current.load(std::memory_order_acquire);
+    auto const iter = snapshot->dirs.find(packageName);
+    return iter == snapshot->dirs.end() ? std::string_view() : iter->second;
+}
+
+std::string PackageDirResolver::getPackageDir(std::string_view packageName) const {
+    Snapshot const* snapshot = _current.load(std::memory_order_acquire);
+    auto const iter = snapshot->dirs.find(packageName);
+    if (iter == snapshot->dirs.end()) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::NotFoundError,
+                          "Package " + std::string(packageName) + " not found");
+    }
+    return std::string(iter->second);
+}
+
+std::vector<std::string> PackageDirResolver::getPackageDirs(
+        std::vector<std::string> const& packageNames) const {
+    Snapshot const* snapshot = _current.load(std::memory_order_acquire);
+    std::vector<std::string> result;
+    result.reserve(packageNames.size());
+    std::string missing;
+    for (auto const& name : packageNames) {
+        auto const iter = snapshot->dirs.find(name);
+        if (iter == snapshot->dirs.end()) {
+            missing += (missing.empty() ? "" : ", ") + name;
+        } else {
+            result.emplace_back(iter->second);
+        }
+    }
+    if (!missing.empty()) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::NotFoundError, "Packages not found: " + missing);
+    }
+    return result;
+}
+
 }} // namespace lsst::cpputils
@@ -0,0 +1,103 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "lsst/cpputils/Cache.h"
+#include "lsst/cpputils/python.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace cpputils {
+namespace python {
+
+namespace {
+
+using Buffer = std::vector<double>;
+
+// Buffers wrapped by makeArray, which must live as long as the arrays
+Cache<int, std::shared_ptr<Buffer>> buffers(1);
+std::map<int, std::weak_ptr<Buffer>> created;  // Most recent buffer created for each key
+
+std::shared_ptr<Buffer> getBuffer(int key) {
+    return buffers(key, [](int key) {
+        auto buffer = std::make_shared<Buffer>(6);
+        for (std::size_t i = 0; i < buffer->size(); ++i) {
+            (*buffer)[i] = key + i;
+        }
+        created[key] = buffer;
+        return buffer;
+    });
+}
+
+}  // anonymous namespace
+
+PYBIND11_MODULE(_arrayView, mod) {
+    // Sum of each row of a 2-d array, read through a strided view
+    mod.def("sumRows", [](py::array const & array) {
+        return applyArrayView<2>([](auto view) {
+            std::vector<double> sums(view.shape(0), 0.0);
+            for (std::ptrdiff_t i = 0; i < view.shape(0); ++i) {
+                for (std::ptrdiff_t j = 0; j < view.shape(1); ++j) {
+                    sums[i] += view(i, j);
+                }
+            }
+            return sums;
+        }, array, TemplateInvoker::Tag<std::int32_t, float, double>());
+    }, "array"_a);
+    mod.def("sumContiguous", [](py::array const & array) {
+        double sum = 0.0;
+        for (double value : makeSpan<double const>(array)) {
+            sum += value;
+        }
+        return sum;
+    }, "array"_a);
+    mod.def("fill", [](py::array & array, double value, bool contiguous) {
+        auto view = makeArrayView<double, 1>(
+                array, contiguous ? ArrayLayout::C_CONTIGUOUS : ArrayLayout::STRIDED);
+        for (std::ptrdiff_t i = 0; i < view.shape(0); ++i) {
+            view(i) = value;
+        }
+    }, "array"_a, "value"_a, "contiguous"_a=false);
+    // Arrays of the Cache buffer for a key, as rows of 3
+    mod.def("getBuffer", [](int key, bool writeable) {
+        std::shared_ptr<Buffer> buffer = getBuffer(key);
+        ArrayView<double, 2> view(buffer->data(), {2, 3}, {3, 1});
+        return writeable ? makeArray(view, buffer) : makeArray(ArrayView<double const, 2>(view), buffer);
+    }, "key"_a, "writeable"_a=false);
+    mod.def("getBufferTranspose", [](int key) {
+        std::shared_ptr<Buffer> buffer = getBuffer(key);
+        return makeArray(ArrayView<double const, 2>(buffer->data(), {3, 2}, {1, 3}), buffer);
+    }, "key"_a);
+    mod.def("isBufferAlive", [](int key) { return !created[key].expired(); }, "key"_a);
+}
+
+}  // python
+}  // utils
+}  // lsst
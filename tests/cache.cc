@@ -24,4 +24,14 @@
 PYBIND11_MODULE(_cache, mod) {
     lsst::cpputils::Cache<int, std::string> cache;
     lsst::cpputils::python::declareCache<int, std::string>(mod, "NumbersCache");
+    lsst::cpputils::python::declareCache<int, std::string, boost::hash<int>, std::equal_to<int>,
+                                         lsst::cpputils::SlruPolicy>(mod, "NumbersSlruCache");
+    lsst::cpputils::python::declareCache<int, std::string, boost::hash<int>, std::equal_to<int>,
+                                         lsst::cpputils::TinyLfuPolicy>(mod, "NumbersTinyLfuCache");
+    lsst::cpputils::python::declareConcurrentCache<int, std::string>(mod, "NumbersConcurrentCache");
+    lsst::cpputils::python::declareConcurrentCache<int, std::string, boost::hash<int>, std::equal_to<int>,
+                                                   lsst::cpputils::SlruPolicy>(mod, "NumbersConcurrentSlruCache");
+    lsst::cpputils::python::declareConcurrentCache<int, std::string, boost::hash<int>, std::equal_to<int>,
+                                                   lsst::cpputils::TinyLfuPolicy>(
+        mod, "NumbersConcurrentTinyLfuCache");
 }
@@ -109,9 +109,9 @@ TypeHolder<T> returnTypeHolder() {
 }
 
 void wrapExample(lsst::cpputils::python::WrapperCollection & wrappers) {
-    wrappers.wrapType(
+    auto cls = wrappers.wrapType(
         py::class_<Example>(wrappers.module, "Example"),
-        [](auto & mod, auto & cls) {
+        [getValue=wrappers.timed("example.Example.getValue", &Example::getValue)](auto & mod, auto & cls) {
             cls.def(py::init<std::string const &>());
             cls.def(py::init<bool>());
             cls.def(py::init<Example const &>());
@@ -120,7 +120,7 @@ void wrapExample(lsst::cpputils::python::WrapperCollection & wrappers) {
             cls.def("get2", &Example::get1);
             cls.def("get3", &Example::get1);
 
-            cls.def("getValue", &Example::getValue);
+            cls.def("getValue", getValue);
             cls.def("setValue", &Example::setValue);
 
             cls.def(py::self == py::self);
@@ -130,11 +130,13 @@ void wrapExample(lsst::cpputils::python::WrapperCollection & wrappers) {
             lsst::cpputils::python::addOutputOp(cls, "__repr__");
         }
     );
+    wrappers.instrument(cls, "getValue");
 }
 
 
 PYBIND11_MODULE(_example, mod) {
     lsst::cpputils::python::WrapperCollection wrappers(mod, "example");
+    wrappers.enableInstrumentation();
     wrapExample(wrappers);
     wrappers.wrap(
         [](auto & mod) {
@@ -186,5 +188,22 @@ PYBIND11_MODULE(_example, mod) {
             );
         }
     );
+    wrappers.instrument(mod, "getName");
+    auto lazy = wrappers.makeSubmodule("lazy", true);
+    lazy.wrap(
+        [](auto & mod) {
+            mod.def("getAnswer", []() { return 42; });
+        },
+        "getAnswer"
+    );
+    wrappers.collectSubmodule(std::move(lazy));
+    auto lazyImport = wrappers.makeSubmodule("lazyImport", true);
+    lazyImport.wrap(
+        [](auto & mod) {
+            mod.def("getQuestion", []() { return std::string("six times nine"); });
+        },
+        "getQuestion"
+    );
+    wrappers.collectSubmodule(std::move(lazyImport));
     wrappers.finish();
 }
@@ -0,0 +1,101 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import gc
+import unittest
+
+import numpy as np
+
+import lsst.pex.exceptions
+import _arrayView
+
+
+class ArrayViewTestCase(unittest.TestCase):
+    """Tests of the NumPy array views in python.h"""
+
+    def testStridedViews(self):
+        array = np.arange(12, dtype=np.float64).reshape(3, 4)
+        expected = array.sum(axis=1)
+        np.testing.assert_array_equal(_arrayView.sumRows(array), expected)
+        np.testing.assert_array_equal(_arrayView.sumRows(array.astype(np.float32)), expected)
+        np.testing.assert_array_equal(_arrayView.sumRows(array.astype(np.int32)), expected)
+        np.testing.assert_array_equal(_arrayView.sumRows(array.T), array.sum(axis=0))
+        np.testing.assert_array_equal(_arrayView.sumRows(array[::-2, 1::2]), array[::-2, 1::2].sum(axis=1))
+        with self.assertRaises(TypeError):
+            _arrayView.sumRows(array.astype(np.int64))
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            _arrayView.sumRows(array.ravel())
+
+    def testSpan(self):
+        array = np.arange(24, dtype=np.float64).reshape(2, 3, 4)
+        self.assertEqual(_arrayView.sumContiguous(array), array.sum())
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            _arrayView.sumContiguous(array.T)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            _arrayView.sumContiguous(array.astype(np.float32))
+
+    def testWriteable(self):
+        array = np.zeros(10)
+        _arrayView.fill(array[::2], 3.0)
+        np.testing.assert_array_equal(array, [3.0, 0.0]*5)
+        _arrayView.fill(array, 1.0, contiguous=True)
+        np.testing.assert_array_equal(array, 1.0)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            _arrayView.fill(array[::2], 1.0, contiguous=True)
+        array.flags.writeable = False
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            _arrayView.fill(array, 2.0)
+
+    def testAlignment(self):
+        buffer = np.zeros(10*8 + 1, dtype=np.uint8)
+        unaligned = buffer[1:].view(np.float64)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            _arrayView.fill(unaligned, 1.0)
+
+    def testMakeArray(self):
+        array = _arrayView.getBuffer(10)
+        np.testing.assert_array_equal(array, [[10, 11, 12], [13, 14, 15]])
+        self.assertFalse(array.flags.writeable)
+        with self.assertRaises(ValueError):
+            array[0, 0] = 0.0
+        np.testing.assert_array_equal(_arrayView.getBufferTranspose(10), array.T)
+
+        # No copy is made
+        writeable = _arrayView.getBuffer(10, writeable=True)
+        self.assertTrue(writeable.flags.writeable)
+        writeable[1, 2] = -1.0
+        self.assertEqual(array[1, 2], -1.0)
+
+        # Evicting the buffer from the cache leaves the arrays valid, until they are deleted
+        _arrayView.getBuffer(20)
+        self.assertTrue(_arrayView.isBufferAlive(10))
+        view = array[1]
+        del array, writeable
+        gc.collect()
+        self.assertTrue(_arrayView.isBufferAlive(10))
+        np.testing.assert_array_equal(view, [13, 14, -1])
+        del view
+        gc.collect()
+        self.assertFalse(_arrayView.isBufferAlive(10))
+        self.assertTrue(_arrayView.isBufferAlive(20))
+
+if __name__ == "__main__":
+    unittest.main()
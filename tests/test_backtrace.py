@@ -23,6 +23,8 @@ import os
 import sys
 import unittest
 import subprocess
+import threading
+import time
 
 from lsst.cpputils import backtrace
 
@@ -43,6 +45,47 @@ class BacktraceTestCase(unittest.TestCase):
             print(output)
             self.assertIn("backtrace follows", output)
 
+    def test_profiler(self):
+        if not backtrace.isProfilerSupported():
+            self.skipTest("Sampling profiler is not supported")
+        backtrace.startProfiler(interval=0.001)
+        self.assertTrue(backtrace.isProfiling())
+        start = time.process_time()
+        total = 0
+        while time.process_time() - start < 0.5:
+            total += sum(range(1000))
+        folded = backtrace.stopProfiler()
+        self.assertFalse(backtrace.isProfiling())
+        lines = folded.splitlines()
+        self.assertGreater(len(lines), 0)
+        for line in lines:
+            self.assertRegex(line, r"^\S.* \d+$")
+        self.assertEqual(backtrace.stopProfiler(), folded)
+
+    def test_profiler_restart(self):
+        """Signals still pending when the profiler stops must not kill the process"""
+        if not backtrace.isProfilerSupported():
+            self.skipTest("Sampling profiler is not supported")
+        done = threading.Event()
+
+        def burn():
+            total = 0
+            while not done.is_set():
+                total += sum(range(1000))
+
+        threads = [threading.Thread(target=burn) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        try:
+            for _ in range(200):
+                backtrace.startProfiler(interval=0.00001)
+                backtrace.stopProfiler()
+        finally:
+            done.set()
+            for thread in threads:
+                thread.join()
+        self.assertFalse(backtrace.isProfiling())
+
 
 if __name__ == "__main__":
     unittest.main()
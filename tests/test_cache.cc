@@ -0,0 +1,462 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lsst/cpputils/Cache.h"
+#include "lsst/cpputils/CacheSpill.h"
+#include "lsst/cpputils/ConcurrentCache.h"
+#include "lsst/cpputils/NodePool.h"
+
+#define BOOST_TEST_MODULE cache
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lsst/pex/exceptions.h"
+
+using namespace lsst::cpputils;
+
+namespace {
+
+std::atomic<std::size_t> numAllocations{0};  // Number of calls to the global operator new
+
+}  // anonymous namespace
+
+// The replacements are a matched set, but GCC sees free() called on memory from operator new
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    ++numAllocations;
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+#pragma GCC diagnostic pop
+
+namespace {
+
+// Value that counts how often it is copied
+struct Counted {
+    explicit Counted(int value_=0) : value(value_) {}
+    Counted(Counted const& other) : value(other.value) { ++copies; }
+    Counted(Counted && other) = default;
+    Counted & operator=(Counted const& other) { value = other.value; ++copies; return *this; }
+    Counted & operator=(Counted && other) = default;
+
+    int value;
+    static int copies;
+};
+
+int Counted::copies = 0;
+
+// Temporary directory, removed (with its contents) on destruction
+struct TemporaryDirectory {
+    TemporaryDirectory() {
+        char name[] = "/tmp/test_cache-XXXXXX";
+        BOOST_REQUIRE(mkdtemp(name));
+        path = name;
+    }
+    ~TemporaryDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+        BOOST_CHECK_MESSAGE(!error, "Unable to remove " + path + ": " + error.message());
+    }
+
+    std::string path;
+};
+
+// Spill store of strings; the values are copied out of the mapping
+using StringSpillStore = DirectorySpillStore<int, std::string>;
+
+std::shared_ptr<StringSpillStore> makeStringSpillStore(std::string const& directory, std::size_t maxBytes) {
+    return std::make_shared<StringSpillStore>(
+        directory, maxBytes,
+        [](std::string const& value, std::ostream& output) { output << value; },
+        [](std::shared_ptr<MappedFile const> const& mapping) {
+            return std::string(static_cast<char const*>(mapping->data()), mapping->size());
+        });
+}
+
+}  // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(CacheSuite)
+
+BOOST_AUTO_TEST_CASE(MoveAndReference) {
+    Cache<int, Counted> cache(2);
+    Counted::copies = 0;
+    cache.add(1, Counted(1));
+    BOOST_CHECK(cache.emplace(2, 2));
+    BOOST_CHECK(!cache.emplace(2, 3));
+    BOOST_CHECK_EQUAL(cache.getRef(2).value, 2);
+    int visited = 0;
+    BOOST_CHECK(cache.visit(1, [&visited](Counted const& value) { visited = value.value; }));
+    BOOST_CHECK_EQUAL(visited, 1);
+    BOOST_CHECK(!cache.visit(3, [](Counted const&) {}));
+    BOOST_CHECK_EQUAL(Counted::copies, 0);
+    BOOST_CHECK_THROW(cache.getRef(3), lsst::pex::exceptions::NotFoundError);
+
+    // Generated values are moved into the cache, and copied only to be returned
+    BOOST_CHECK_EQUAL(cache(4, [](int key) { return Counted(key); }).value, 4);
+    BOOST_CHECK_EQUAL(Counted::copies, 1);
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK(!cache.contains(2));
+}
+
+BOOST_AUTO_TEST_CASE(MoveRejected) {
+    // A generated value that is too heavy to retain is still returned intact
+    Cache<int, std::vector<int>> cache(
+        0, [](int, std::vector<int> const& value) { return value.size(); }, 3);
+    auto const result = cache(1, [](int key) { return std::vector<int>(5, key); });
+    BOOST_CHECK_EQUAL(result.size(), 5u);
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentVisit) {
+    ConcurrentCache<int, std::string> cache(4, 2);
+    cache.add(1, std::string("one"));
+    BOOST_CHECK(cache.emplace(2, 3, 'x'));
+    std::string visited;
+    BOOST_CHECK(cache.visit(2, [&visited](std::string const& value) { visited = value; }));
+    BOOST_CHECK_EQUAL(visited, "xxx");
+    BOOST_CHECK_EQUAL(cache[1], "one");
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentBatch) {
+    ConcurrentCache<int, int> cache(100, 8);
+    std::vector<int> keys;
+    for (int ii = 0; ii < 50; ++ii) {
+        keys.push_back(ii);
+    }
+    int calls = 0;
+    auto square = [&calls](std::vector<int> const& missing) {
+        ++calls;
+        std::vector<int> result;
+        for (int key : missing) {
+            result.push_back(key*key);
+        }
+        return result;
+    };
+    auto const values = cache.computeMany(keys, square);
+    BOOST_CHECK_EQUAL(values.size(), keys.size());
+    for (std::size_t ii = 0; ii < keys.size(); ++ii) {
+        BOOST_CHECK_EQUAL(values[ii], keys[ii]*keys[ii]);
+    }
+    BOOST_CHECK_EQUAL(cache.size(), keys.size());
+    keys.push_back(50);
+    auto const found = cache.getMany(keys);
+    BOOST_CHECK(found[7] && *found[7] == 49);
+    BOOST_CHECK(!found.back());
+    cache.computeMany(keys, square);
+    BOOST_CHECK_EQUAL(calls, 2);
+    BOOST_CHECK_THROW(cache.addMany(keys, values), lsst::pex::exceptions::LengthError);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentPolicy) {
+    // A hit protects a value from a scan only if the policy has a protected segment
+    auto const identity = [](int key) { return key; };
+    for (double fraction : {0.8, 0.0}) {
+        ConcurrentCache<int, int, std::hash<int>, std::equal_to<int>, SlruPolicy> cache(
+            4, 1, false, SlruPolicy(fraction));
+        for (int key = 1; key <= 4; ++key) {
+            cache(key, identity);
+        }
+        cache(1, identity);
+        cache(2, identity);
+        for (int key = 5; key <= 7; ++key) {
+            cache(key, identity);
+        }
+        BOOST_CHECK_EQUAL(cache.contains(1), fraction > 0.0);
+        BOOST_CHECK(cache.contains(2));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Spill) {
+    TemporaryDirectory directory;
+    auto store = makeStringSpillStore(directory.path, 0);
+    Cache<int, std::string> cache(2);
+    cache.setSpillStore(store);
+    int calls = 0;
+    auto generate = [&calls](int key) { ++calls; return std::string(key, 'x'); };
+    for (int key = 1; key <= 4; ++key) {
+        cache(key, generate);
+    }
+    BOOST_CHECK_EQUAL(store->size(), 2u);
+    BOOST_CHECK_EQUAL(store->bytes(), 3u);
+
+    // Evicted values come back from the spill tier, not the generator
+    BOOST_CHECK_EQUAL(cache(1, generate), "x");
+    BOOST_CHECK_EQUAL(calls, 4);
+    BOOST_CHECK(cache.contains(1));
+    BOOST_CHECK_EQUAL(store->size(), 2u);  // Value 1 came back; value 3 was spilled to make room
+    auto const values = cache.computeMany({2, 2, 5}, [&calls](std::vector<int> const& missing) {
+        std::vector<std::string> result;
+        for (int key : missing) {
+            result.push_back(std::string(key, 'y'));
+            ++calls;
+        }
+        return result;
+    });
+    BOOST_CHECK_EQUAL(values[0], "xx");
+    BOOST_CHECK_EQUAL(values[1], "xx");
+    BOOST_CHECK_EQUAL(values[2], "yyyyy");
+    BOOST_CHECK_EQUAL(calls, 5);
+    auto const stats = cache.stats();
+    BOOST_CHECK_EQUAL(stats.spillHits, 2u);
+    BOOST_CHECK_EQUAL(stats.spills, 5u);
+
+    // Erasing removes the value from both tiers
+    BOOST_CHECK(cache.erase(3));
+    BOOST_CHECK(!store->erase(3));
+    BOOST_CHECK(!cache.erase(3));
+    cache.setSpillStore(nullptr);
+    cache.flush();
+    BOOST_CHECK_EQUAL(store->size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(SpillBudget) {
+    TemporaryDirectory directory;
+    auto store = makeStringSpillStore(directory.path, 10);
+    store->put(1, std::string(4, 'a'));
+    store->put(2, std::string(4, 'b'));
+    store->put(3, std::string(20, 'c'));  // Too large to store
+    BOOST_CHECK_EQUAL(store->size(), 2u);
+    store->put(1, std::string(3, 'a'));  // Replaces the value
+    BOOST_CHECK_EQUAL(store->bytes(), 7u);
+    store->put(4, std::string(4, 'd'));  // Evicts the oldest spilled value
+    BOOST_CHECK(!store->take(2));
+    BOOST_CHECK_EQUAL(*store->take(1), "aaa");
+    BOOST_CHECK(!store->take(1));
+    BOOST_CHECK_EQUAL(store->bytes(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(SpillZeroCopy) {
+    // Values refer to the mapped file, which outlives its removal from the spill tier
+    using Array = std::shared_ptr<double const>;
+    TemporaryDirectory directory;
+    auto store = std::make_shared<DirectorySpillStore<int, Array>>(
+        directory.path, 0,
+        [](Array const& value, std::ostream& output) {
+            output.write(reinterpret_cast<char const*>(value.get()), 4*sizeof(double));
+        },
+        [](std::shared_ptr<MappedFile const> const& mapping) {
+            BOOST_REQUIRE_EQUAL(mapping->size(), 4*sizeof(double));
+            return Array(mapping, static_cast<double const*>(mapping->data()));
+        });
+    Cache<int, Array> cache(1);
+    cache.setSpillStore(store);
+    auto generate = [](int key) {
+        return Array(new double[4]{1.0*key, 2.0*key, 3.0*key, 4.0*key}, std::default_delete<double[]>());
+    };
+    cache(1, generate);
+    cache(2, generate);
+    Array const promoted = cache(1, [](int) -> Array { throw std::runtime_error("Not spilled"); });
+    BOOST_CHECK_EQUAL(promoted.get()[3], 4.0);
+    BOOST_CHECK_EQUAL(store->size(), 1u);
+    BOOST_CHECK_THROW(MappedFile::open(directory.path + "/nonexistent"), lsst::pex::exceptions::IoError);
+}
+
+BOOST_AUTO_TEST_CASE(SpillSharedDirectory) {
+    // Stores sharing a directory must not overwrite each other's files
+    TemporaryDirectory directory;
+    auto first = makeStringSpillStore(directory.path, 0);
+    auto second = makeStringSpillStore(directory.path, 0);
+    first->put(1, "first");
+    second->put(1, "second");
+    BOOST_CHECK_EQUAL(*first->take(1), "first");
+    BOOST_CHECK_EQUAL(*second->take(1), "second");
+}
+
+BOOST_AUTO_TEST_CASE(SpillErrors) {
+    // Errors in the spill tier leave the cache within its capacity, and fall back to the generator
+    TemporaryDirectory directory;
+    bool failWrite = false;
+    bool failRead = false;
+    auto store = std::make_shared<StringSpillStore>(
+        directory.path, 0,
+        [&failWrite](std::string const& value, std::ostream& output) {
+            if (failWrite) {
+                throw std::runtime_error("Cannot serialize");
+            }
+            output << value;
+        },
+        [&failRead](std::shared_ptr<MappedFile const> const& mapping) {
+            if (failRead) {
+                throw std::runtime_error("Cannot deserialize");
+            }
+            return std::string(static_cast<char const*>(mapping->data()), mapping->size());
+        });
+    Cache<int, std::string> cache(2);
+    cache.setSpillStore(store);
+    int calls = 0;
+    auto generate = [&calls](int key) { ++calls; return std::string(key, 'x'); };
+    failWrite = true;
+    for (int key = 1; key <= 4; ++key) {
+        cache(key, generate);
+    }
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK_EQUAL(store->size(), 0u);
+    BOOST_CHECK_EQUAL(cache.stats().spills, 0u);
+
+    failWrite = false;
+    cache(5, generate);
+    BOOST_CHECK_EQUAL(store->size(), 1u);
+    failRead = true;
+    BOOST_CHECK_EQUAL(cache(3, generate), "xxx");
+    BOOST_CHECK_EQUAL(calls, 6);
+    BOOST_CHECK_EQUAL(store->size(), 1u);  // Value 3 was dropped; value 4 was spilled to make room
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(Prefetch) {
+    ConcurrentCache<int, int> cache(100, 4);
+    std::vector<std::function<void()>> tasks;
+    auto executor = [&tasks](std::function<void()> task) { tasks.push_back(std::move(task)); };
+    std::atomic<int> calls{0};
+    auto square = [&calls](int key) {
+        ++calls;
+        if (key < 0) {
+            throw std::runtime_error("Negative key");
+        }
+        return key*key;
+    };
+    auto unexpected = [](int) { return 0; };  // Generator for keys that should have been prefetched
+
+    cache.add(1, 1);
+    BOOST_CHECK_EQUAL(cache.prefetch({1, 2, 3, 2, -1}, square, executor), 3u);
+    BOOST_CHECK_EQUAL(cache.prefetch({2, 3}, square, executor), 0u);  // Already pending
+    BOOST_CHECK_EQUAL(cache.numPrefetching(), 3u);
+    BOOST_CHECK_EQUAL(cache.stats().hits + cache.stats().misses, 0u);
+
+    // Requests for pending keys wait for the prefetched value (or exception), which arrives later
+    std::thread worker([&tasks]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (auto & task : tasks) {
+            task();
+        }
+    });
+    BOOST_CHECK_THROW(cache(-1, unexpected), std::runtime_error);
+    int const waited = cache(3, unexpected);
+    worker.join();
+    BOOST_CHECK_EQUAL(waited, 9);
+    BOOST_CHECK_EQUAL(calls, 3);
+    BOOST_CHECK_EQUAL(cache.numPrefetching(), 0u);
+    BOOST_CHECK_EQUAL(cache[2], 4);
+    BOOST_CHECK(!cache.contains(-1));
+
+    // A failing executor releases the keys
+    auto broken = [](std::function<void()>) { throw std::runtime_error("Executor shut down"); };
+    BOOST_CHECK_THROW(cache.prefetch({5, 6}, square, broken), std::runtime_error);
+    BOOST_CHECK_EQUAL(cache.numPrefetching(), 0u);
+    BOOST_CHECK_EQUAL(cache(5, square), 25);
+
+    // Without an executor, the keys are generated one after another on a single thread
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto recordThread = [&mutex, &threads, &square](int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+        return square(key);
+    };
+    std::vector<int> keys;
+    for (int ii = 7; ii < 100; ++ii) {
+        keys.push_back(ii);
+    }
+    BOOST_CHECK_EQUAL(cache.prefetch(keys, recordThread), keys.size());
+    for (int key : keys) {
+        BOOST_CHECK_EQUAL(cache(key, unexpected), key*key);
+    }
+    BOOST_CHECK_EQUAL(threads.size(), 1u);
+    BOOST_CHECK(threads.count(std::this_thread::get_id()) == 0);
+}
+
+template <typename Policy>
+void checkNodePool() {
+    using PooledCache = Cache<int, int, std::hash<int>, std::equal_to<int>, Policy, NodePoolAllocator<void>>;
+    auto generate = [](int key) { return 2*key; };
+    PooledCache(1, typename PooledCache::Weigher(), 0)(0, generate);  // Register the instrumentation counters
+    PooledCache cache(100, typename PooledCache::Weigher(), 0);
+    // Filling the cache, and the steady state with insertions and evictions, don't allocate
+    std::size_t const before = numAllocations;
+    for (int key = 0; key < 100000; ++key) {
+        BOOST_CHECK_EQUAL(cache(key % 5000, generate), 2*(key % 5000));
+    }
+    BOOST_CHECK_EQUAL(numAllocations - before, 0u);
+    BOOST_CHECK_EQUAL(cache.size(), 100u);
+
+    // Copies have their own pool
+    PooledCache copy(cache);
+    BOOST_CHECK(copy.keys() == cache.keys());
+    copy.flush();
+    BOOST_CHECK_EQUAL(cache.size(), 100u);
+    BOOST_CHECK_EQUAL(cache[cache.keys().front()], 2*cache.keys().front());
+}
+
+BOOST_AUTO_TEST_CASE(NodePoolLru) { checkNodePool<LruPolicy>(); }
+
+BOOST_AUTO_TEST_CASE(NodePoolTinyLfu) { checkNodePool<TinyLfuPolicy>(); }
+
+BOOST_AUTO_TEST_CASE(NodePoolReuse) {
+    NodePoolAllocator<double> allocator;
+    NodePool const& pool = *allocator.getPool();
+    allocator.reserve(100);
+    std::vector<double*> blocks;
+    for (int ii = 0; ii < 100; ++ii) {
+        blocks.push_back(allocator.allocate(1));
+        *blocks.back() = ii;
+    }
+    BOOST_CHECK_EQUAL(pool.getNumBlocks(), 100u);
+    BOOST_CHECK_EQUAL(pool.getNumSlabs(), 1u);
+    double* array = allocator.allocate(10);  // Not from the pool
+    BOOST_CHECK_EQUAL(pool.getNumUsed(), 100u);
+    allocator.deallocate(array, 10);
+    blocks.push_back(allocator.allocate(1));  // Grows the pool
+    BOOST_CHECK_EQUAL(pool.getNumSlabs(), 2u);
+    for (double* block : blocks) {
+        allocator.deallocate(block, 1);
+    }
+    BOOST_CHECK_EQUAL(pool.getNumUsed(), 0u);
+    NodePoolAllocator<int> rebound(allocator);
+    BOOST_CHECK(rebound == allocator);
+    BOOST_CHECK(NodePoolAllocator<double>() != allocator);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
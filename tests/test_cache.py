@@ -19,9 +19,14 @@
 # along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #
 
+import datetime
+import threading
+import time
 import unittest
 
-from _cache import NumbersCache
+from lsst.pex.exceptions import LengthError
+from _cache import (NumbersCache, NumbersConcurrentCache, NumbersConcurrentSlruCache,
+                    NumbersConcurrentTinyLfuCache, NumbersSlruCache, NumbersTinyLfuCache)
 
 
 def numberToWords(value):
@@ -71,6 +76,10 @@ def numberToWords(value):
 
 class CacheTestCase(unittest.TestCase):
     """Tests of lsst.cpputils.Cache"""
+    def makeCache(self, capacity):
+        """Construct the cache under test"""
+        return NumbersCache(capacity)
+
     def check(self, addFunction):
         """Exercise the Cache
 
@@ -79,7 +88,7 @@ class CacheTestCase(unittest.TestCase):
         into the cache.
         """
         capacity = 10
-        cache = NumbersCache(capacity)
+        cache = self.makeCache(capacity)
         self.assertEqual(cache.size(), 0, "Starts empty")
         self.assertEqual(cache.capacity(), capacity, "Capacity as requested")
         maximum = 20
@@ -136,6 +145,284 @@ class CacheTestCase(unittest.TestCase):
         with self.assertRaises(AssertionError):
             cache(999, trap)
 
+    def testWeight(self):
+        """Exercise eviction by total weight"""
+        cache = NumbersCache(0, weigher=lambda key, value: len(value), maxWeight=20)
+        self.assertEqual(cache.maxWeight(), 20)
+        for ii in range(20):
+            cache.add(ii, numberToWords(ii))
+            self.assertLessEqual(cache.weight(), cache.maxWeight())
+        self.assertEqual(cache.weight(), sum(len(cache[key]) for key in cache.keys()))
+        # Most recent retained: ["nineteen", "eighteen"] fit, adding "seventeen" would not
+        self.assertListEqual(cache.keys(), [19, 18])
+        cache.reserveWeight(10)
+        self.assertListEqual(cache.keys(), [19])
+        cache.flush()
+        self.assertEqual(cache.weight(), 0)
+
+        # Without a weigher, each value has unit weight
+        cache = self.makeCache(5)
+        for ii in range(10):
+            cache.add(ii, numberToWords(ii))
+        self.assertEqual(cache.weight(), cache.size())
+
+    def testStats(self):
+        """Exercise the statistics and key sampling"""
+        cache = self.makeCache(3)
+        cache.enableSampling(4, 2)
+        for ii in range(5):
+            cache(ii, numberToWords)
+        for ii in range(5):
+            cache.get(ii)
+        stats = cache.stats()
+        self.assertEqual(stats["misses"], 5 + 2)
+        self.assertEqual(stats["hits"], 3)
+        self.assertEqual(stats["insertions"], 5)
+        self.assertEqual(stats["evictions"], 2)
+        self.assertEqual(stats["generations"], 5)
+        self.assertGreaterEqual(stats["generatorTime"], 0.0)
+        self.assertAlmostEqual(stats["hitRate"], 0.3)
+        # Every second request (0, 2, 4, 1, 3), keeping the last four
+        self.assertListEqual(cache.sampledKeys(), [2, 4, 1, 3])
+        cache.resetStats()
+        self.assertEqual(cache.stats()["hits"], 0)
+
+    def testBatch(self):
+        """Exercise the batch methods getMany, addMany and computeMany"""
+        cache = self.makeCache(10)
+        cache.addMany([1, 2, 3], [numberToWords(ii) for ii in (1, 2, 3)])
+        self.assertEqual(cache.getMany([3, 4, 1]), ["three", None, "one"])
+        with self.assertRaises(LengthError):
+            cache.addMany([4, 5], ["four"])
+
+        calls = []
+
+        def generate(keys):
+            calls.append(list(keys))
+            return [numberToWords(key) for key in keys]
+
+        keys = [2, 5, 6, 5, 1]
+        self.assertEqual(cache.computeMany(keys, generate), [numberToWords(key) for key in keys])
+        self.assertEqual(calls, [[5, 6]], "Generator called once, with each missing key once")
+        self.assertEqual(cache.computeMany(keys, generate), [numberToWords(key) for key in keys])
+        self.assertEqual(len(calls), 1, "Generator not called when all keys are present")
+        self.assertEqual(cache.stats()["generations"], 1)
+
+        with self.assertRaises(LengthError):
+            cache.computeMany([7, 8], lambda keys: ["seven"])
+
+    def testExpiry(self):
+        """Exercise the time to live of values"""
+        cache = self.makeCache(10)
+        self.assertEqual(cache.timeToLive(), datetime.timedelta(0))
+        cache.add(1, "one")
+        cache.add(2, "two", timeToLive=0.05)
+        self.assertIsNone(cache.timeRemaining(1), "Never expires")
+        self.assertGreater(cache.timeRemaining(2), datetime.timedelta(0))
+        cache.setTimeToLive(datetime.timedelta(seconds=0.05))
+        cache(3, numberToWords)
+        time.sleep(0.1)
+        self.assertEqual(cache.size(), 3, "Expired values are removed lazily")
+        self.assertEqual(cache.get(1), "one")
+        self.assertIsNone(cache.get(2))
+        self.assertNotIn(3, cache)
+        self.assertEqual(cache.size(), 1)
+        self.assertEqual(cache.stats()["expirations"], 2)
+        self.assertTrue(cache.erase(1))
+        self.assertFalse(cache.erase(1))
+        self.assertEqual(cache.size(), 0)
+
+    def checkScan(self, cacheClass, resistant):
+        """Request a hot set of keys twice, then sweep over many other keys
+
+        Parameters
+        ----------
+        cacheClass : `type`
+            Class of cache to test.
+        resistant : `bool`
+            Should the hot set survive the sweep?
+        """
+        capacity = 10
+        cache = cacheClass(capacity)
+        hot = list(range(5))
+        for _ in range(2):
+            for key in hot:
+                cache(key, numberToWords)
+        for key in range(100, 200):
+            self.assertEqual(cache(key, numberToWords), numberToWords(key))
+        self.assertLessEqual(cache.size(), capacity)
+        for key in hot:
+            if resistant:
+                self.assertIn(key, cache)
+            else:
+                self.assertNotIn(key, cache)
+
+    def policyCaches(self):
+        """Return factories, taking the capacity, for LRU, segmented LRU and TinyLFU caches"""
+        return NumbersCache, NumbersSlruCache, NumbersTinyLfuCache
+
+    def testPolicies(self):
+        """Segmented LRU and TinyLFU should survive a sweep; LRU should not"""
+        lru, slru, tinyLfu = self.policyCaches()
+        self.checkScan(lru, False)
+        self.checkScan(slru, True)
+        self.checkScan(tinyLfu, True)
+
+
+class ConcurrentCacheTestCase(CacheTestCase):
+    """Tests of lsst.cpputils.ConcurrentCache
+
+    With a single shard, the behaviour should be identical to Cache.
+    """
+    def makeCache(self, capacity):
+        return NumbersConcurrentCache(capacity, 1)
+
+    def policyCaches(self):
+        return tuple(lambda capacity, cls=cls: cls(capacity, 1) for cls in
+                     (NumbersConcurrentCache, NumbersConcurrentSlruCache, NumbersConcurrentTinyLfuCache))
+
+    def testWeight(self):
+        """Each value has unit weight: Python weighers are not supported, as they would need the GIL
+        while a shard is locked
+        """
+        with self.assertRaises(TypeError):
+            NumbersConcurrentCache(0, lambda key, value: len(value), 20)
+        cache = self.makeCache(0)
+        cache.reserveWeight(3)
+        self.assertEqual(cache.maxWeight(), 3)
+        for ii in range(10):
+            cache.add(ii, numberToWords(ii))
+            self.assertLessEqual(cache.weight(), cache.maxWeight())
+        self.assertEqual(cache.weight(), cache.size())
+        self.assertListEqual(sorted(cache.keys()), [7, 8, 9])
+        cache.flush()
+        self.assertEqual(cache.weight(), 0)
+
+    def testShards(self):
+        """Exercise a sharded cache from multiple threads"""
+        capacity = 100
+        cache = NumbersConcurrentCache(capacity, 8)
+        self.assertEqual(cache.numShards(), 8)
+        self.assertEqual(cache.capacity(), capacity)
+
+        def work():
+            for ii in range(500):
+                self.assertEqual(cache(ii % 150, numberToWords), numberToWords(ii % 150))
+
+        threads = [threading.Thread(target=work) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertLessEqual(cache.size(), capacity)
+        self.assertEqual(len(cache.keys()), cache.size())
+        for key in cache.keys():
+            self.assertEqual(cache[key], numberToWords(key))
+        cache.flush()
+        self.assertEqual(cache.size(), 0)
+
+        # Never more shards than elements
+        self.assertEqual(NumbersConcurrentCache(3, 8).numShards(), 3)
+
+    def testSingleFlight(self):
+        """Concurrent misses on the same key should share one generation"""
+        cache = NumbersConcurrentCache(10, 4, singleFlight=True)
+        self.assertTrue(cache.isSingleFlight())
+        calls = []
+
+        def slow(key):
+            calls.append(key)
+            time.sleep(0.1)
+            return numberToWords(key)
+
+        def fail(key):
+            calls.append(key)
+            time.sleep(0.1)
+            raise RuntimeError("Generator failed")
+
+        results = []
+        errors = []
+
+        def work(func):
+            try:
+                results.append(cache(5, func))
+            except RuntimeError as exc:
+                errors.append(exc)
+
+        def run(func):
+            threads = [threading.Thread(target=work, args=(func,)) for _ in range(4)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+
+        run(slow)
+        self.assertEqual(calls, [5])
+        self.assertEqual(results, [numberToWords(5)]*4)
+        self.assertEqual(errors, [])
+
+        # Failures are reported to all waiters, and nothing is cached
+        cache.flush()
+        calls.clear()
+        results.clear()
+        run(fail)
+        self.assertEqual(calls, [5])
+        self.assertEqual(results, [])
+        self.assertEqual(len(errors), 4)
+        self.assertNotIn(5, cache)
+
+    def testRefreshAhead(self):
+        """Values about to expire should be refreshed in the background"""
+        cache = NumbersConcurrentCache(10, 2)
+        cache.setTimeToLive(1.0, refreshAhead=0.8)
+        self.assertEqual(cache.refreshAhead(), datetime.timedelta(seconds=0.8))
+        calls = []
+
+        def generate(key):
+            calls.append(key)
+            return numberToWords(key)
+
+        self.assertEqual(cache(7, generate), "seven")
+        time.sleep(0.3)
+        self.assertEqual(cache(7, generate), "seven", "Existing value served while refreshing")
+        for _ in range(50):
+            if len(calls) > 1:
+                break
+            time.sleep(0.01)
+        self.assertEqual(calls, [7, 7])
+        time.sleep(0.8)
+        self.assertIn(7, cache, "Refreshed value has a new expiry")
+        del cache
+
+    def testRefreshAheadThreads(self):
+        """Refreshing from several threads should not deadlock with the GIL"""
+        cache = NumbersConcurrentCache(10, 2)
+        cache.setTimeToLive(0.05, refreshAhead=0.04)
+        errors = []
+
+        def generate(key):
+            return numberToWords(key)
+
+        def work(index):
+            try:
+                for ii in range(200):
+                    key = (index + ii) % 5
+                    self.assertEqual(cache(key, generate), numberToWords(key))
+                    cache.contains(key)
+                    if ii % 10 == 0:
+                        time.sleep(0.001)
+            except Exception as exc:
+                errors.append(exc)
+
+        threads = [threading.Thread(target=work, args=(ii,), daemon=True) for ii in range(8)]
+        for tt in threads:
+            tt.start()
+        for tt in threads:
+            tt.join(30)
+            self.assertFalse(tt.is_alive(), "Deadlock refreshing values")
+        self.assertEqual(errors, [])
+        del cache
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,138 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "lsst/cpputils/CacheTrace.h"
+#include "lsst/pex/exceptions.h"
+
+#define BOOST_TEST_MODULE CacheTrace
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lsst::cpputils;
+
+namespace {
+
+// Requests with a skewed distribution of keys, interrupted by sweeps over keys that are never reused
+CacheTrace makeTrace() {
+    std::mt19937 rng(12345);
+    std::geometric_distribution<int> popular(0.02);
+    CacheTraceRecorder<int> recorder;
+    int next = 1000000;
+    for (int i = 0; i < 20000; ++i) {
+        if (i % 1000 < 100) {
+            recorder.record(next++);
+        } else {
+            recorder.record(popular(rng));
+        }
+    }
+    return recorder.getTrace();
+}
+
+}  // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(CacheTraceSuite)
+
+BOOST_AUTO_TEST_CASE(Recorder) {
+    CacheTraceRecorder<std::string> recorder;
+    for (auto const& key : {"a", "b", "a", "c", "b"}) {
+        recorder.record(key);
+    }
+    CacheTrace const& trace = recorder.getTrace();
+    BOOST_CHECK_EQUAL(trace.size(), 5u);
+    BOOST_CHECK_EQUAL(trace.getNumKeys(), 3u);
+    std::vector<CacheTrace::KeyId> const expected = {0, 1, 0, 2, 1};
+    BOOST_CHECK_EQUAL_COLLECTIONS(trace.getRequests().begin(), trace.getRequests().end(),
+                                  expected.begin(), expected.end());
+    BOOST_CHECK_THROW(CacheTrace(expected, 2), lsst::pex::exceptions::InvalidParameterError);
+}
+
+BOOST_AUTO_TEST_CASE(Formats) {
+    std::istringstream text("1 2 3\n4 5 6\r\n1 2 3\n\n");
+    CacheTrace const fromText = CacheTrace::readText(text);
+    BOOST_CHECK_EQUAL(fromText.size(), 4u);
+    BOOST_CHECK_EQUAL(fromText.getNumKeys(), 3u);
+    BOOST_CHECK_EQUAL(fromText.getRequests()[2], 0u);
+
+    CacheTrace const trace = makeTrace();
+    std::stringstream binary;
+    trace.writeBinary(binary);
+    BOOST_CHECK_LT(binary.str().size(), 2*trace.size());
+    CacheTrace const copy = CacheTrace::readBinary(binary);
+    BOOST_CHECK_EQUAL(copy.getNumKeys(), trace.getNumKeys());
+    BOOST_CHECK(copy.getRequests() == trace.getRequests());
+
+    std::string truncated = binary.str();
+    truncated.pop_back();
+    std::istringstream truncatedStream(truncated);
+    BOOST_CHECK_THROW(CacheTrace::readBinary(truncatedStream), lsst::pex::exceptions::IoError);
+    BOOST_CHECK_THROW(CacheTrace::readBinary(text), lsst::pex::exceptions::IoError);
+    BOOST_CHECK_THROW(CacheTrace::read("nonexistent-cache-trace.dat"), lsst::pex::exceptions::IoError);
+}
+
+BOOST_AUTO_TEST_CASE(StackDistanceHistogram) {
+    // a b c a b b d a
+    CacheTrace const trace({0, 1, 2, 0, 1, 1, 3, 0}, 4);
+    StackDistances const distances(trace);
+    BOOST_CHECK_EQUAL(distances.getNumRequests(), 8u);
+    BOOST_CHECK_EQUAL(distances.getNumCompulsoryMisses(), 4u);
+    std::vector<std::uint64_t> const expected = {1, 0, 3, 0};
+    BOOST_CHECK_EQUAL_COLLECTIONS(distances.getHistogram().begin(), distances.getHistogram().end(),
+                                  expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(distances.getHitRate(0), 0.0);
+    BOOST_CHECK_EQUAL(distances.getHitRate(1), 1.0/8);
+    BOOST_CHECK_EQUAL(distances.getHitRate(3), 4.0/8);
+    BOOST_CHECK_EQUAL(distances.getHitRate(100), 4.0/8);
+    BOOST_CHECK_EQUAL(StackDistances(CacheTrace()).getHitRate(10), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(Simulation) {
+    CacheTrace const trace = makeTrace();
+    std::vector<std::size_t> const capacities = {1, 10, 50, 100, 200, 1000};
+    // The stack distances predict the LRU cache exactly
+    std::vector<double> const predicted = StackDistances(trace).getHitRates(capacities);
+    std::vector<double> const simulated = simulateHitRates(trace, capacities, CacheTracePolicy::LRU);
+    BOOST_CHECK_EQUAL_COLLECTIONS(predicted.begin(), predicted.end(), simulated.begin(), simulated.end());
+    for (std::size_t i = 1; i < capacities.size(); ++i) {
+        BOOST_CHECK_GE(predicted[i], predicted[i - 1]);
+    }
+
+    // The sweeps flush a small LRU cache, but not the scan-resistant policies
+    std::vector<double> const slru = simulateHitRates(trace, {50}, CacheTracePolicy::SLRU);
+    std::vector<double> const tinyLfu = simulateHitRates(trace, {50}, CacheTracePolicy::TINY_LFU);
+    BOOST_TEST_MESSAGE("Hit rates at 50: LRU " << predicted[2] << ", SLRU " << slru[0] << ", TinyLFU "
+                       << tinyLfu[0]);
+    BOOST_CHECK_GT(slru[0], predicted[2]);
+    BOOST_CHECK_GT(tinyLfu[0], predicted[2]);
+
+    BOOST_CHECK_THROW(simulateHitRates(trace, {0}, CacheTracePolicy::SLRU),
+                      lsst::pex::exceptions::InvalidParameterError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
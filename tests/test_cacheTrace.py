@@ -0,0 +1,85 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+
+import contextlib
+import io
+import json
+import os
+import tempfile
+import unittest
+
+import lsst.pex.exceptions
+from lsst.cpputils import CacheTrace, CacheTracePolicy, StackDistances, simulateHitRates
+from lsst.cpputils.cacheTraceReplay import defaultCapacities, main
+
+
+class CacheTraceTestCase(unittest.TestCase):
+    """Tests of cache trace replay"""
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+        # Keys as written by a Cache compiled with LSST_CACHE_DEBUG: a cycle of 4, then a sweep
+        self.textFile = os.path.join(self.directory.name, "lsst-cache-Example-0.dat")
+        with open(self.textFile, "w") as stream:
+            for i in range(100):
+                print(f"key{i % 4}", file=stream)
+            for i in range(10):
+                print(f"sweep{i}", file=stream)
+
+    def testTrace(self):
+        trace = CacheTrace.read(self.textFile)
+        self.assertEqual(len(trace), 110)
+        self.assertEqual(trace.getNumKeys(), 14)
+        binaryFile = os.path.join(self.directory.name, "trace.bin")
+        trace.writeBinary(binaryFile)
+        self.assertLess(os.path.getsize(binaryFile), os.path.getsize(self.textFile))
+        self.assertEqual(CacheTrace.read(binaryFile).getRequests(), trace.getRequests())
+        with self.assertRaises(lsst.pex.exceptions.IoError):
+            CacheTrace.readBinary(self.textFile)
+
+    def testHitRates(self):
+        trace = CacheTrace.read(self.textFile)
+        distances = StackDistances(trace)
+        self.assertEqual(distances.getNumCompulsoryMisses(), 14)
+        # A cycle misses every time in an LRU cache that is too small for it
+        self.assertEqual(distances.getHitRate(3), 0.0)
+        self.assertAlmostEqual(distances.getHitRate(4), 96/110)
+        capacities = [1, 2, 4, 8]
+        self.assertEqual(simulateHitRates(trace, capacities, CacheTracePolicy.LRU),
+                         distances.getHitRates(capacities))
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            simulateHitRates(trace, [0], CacheTracePolicy.SLRU)
+
+    def testMain(self):
+        self.assertEqual(defaultCapacities(14), [1, 2, 4, 8, 14])
+        output = io.StringIO()
+        with contextlib.redirect_stdout(output):
+            main([self.textFile, "--json", "--capacities", "2,4", "--policies", "lru,tinylfu"])
+        result = json.loads(output.getvalue())
+        self.assertEqual(result["requests"], 110)
+        self.assertEqual(result["capacities"], [2, 4])
+        self.assertEqual(set(result["hitRates"]), {"lru", "tinylfu"})
+        self.assertAlmostEqual(result["hitRates"]["lru"][1], 96/110)
+
+
+if __name__ == "__main__":
+    unittest.main()
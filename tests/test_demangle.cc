@@ -0,0 +1,94 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lsst/cpputils/Demangle.h"
+
+#define BOOST_TEST_MODULE demangle
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace lsst::cpputils;
+
+namespace {
+
+std::vector<std::pair<std::string, std::string>> const EXAMPLES = {
+    {"i", "int"},
+    {"1XIlE", "X<long>"},
+    {"N4lsst8cpputils5CacheIiiEE", "lsst::cpputils::Cache<int,int>"},
+    {"N4lsst8cpputils5CacheIS1_EE", "lsst::cpputils::Cache<lsst::cpputils::Cache>"},
+    {"N4lsst3map3MapIS1_IS0_ES1_IS0_EEE",
+     "lsst::map::Map<lsst::map::Map<lsst::map>,lsst::map::Map<lsst::map>>"},
+};
+
+// A nested template that repeats its types through substitutions, within namespace `name`
+std::pair<std::string, std::string> makeSubstitutions(std::string const& name) {
+    std::string const mangled = "N4lsst" + std::to_string(name.size()) + name + "3MapIS1_IS0_ES1_IS0_EEE";
+    std::string const ns = "lsst::" + name;
+    std::string const inner = ns + "::Map<" + ns + ">";
+    return {mangled, ns + "::Map<" + inner + "," + inner + ">"};
+}
+
+}  // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(DemangleSuite)
+
+BOOST_AUTO_TEST_CASE(Repeated) {
+    for (int i = 0; i < 3; ++i) {
+        for (auto const& example : EXAMPLES) {
+            BOOST_CHECK_EQUAL(demangleType(example.first), example.second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Concurrent) {
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&failures, t]() {
+            for (std::size_t i = 0; i < 10000; ++i) {
+                // Every name is distinct, so that it is demangled rather than found in the memo
+                auto const example = makeSubstitutions("t" + std::to_string(t) + "n" + std::to_string(i));
+                if (demangleType(example.first) != example.second) {
+                    ++failures;
+                }
+                auto const& fixed = EXAMPLES[i % EXAMPLES.size()];
+                if (demangleType(fixed.first) != fixed.second) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(failures.load(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
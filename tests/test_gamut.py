@@ -0,0 +1,172 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+
+import unittest
+
+import numpy as np
+
+import lsst.pex.exceptions
+from lsst.cpputils import fixGamutOK, linearToDisplayP3
+
+
+class FixGamutTestCase(unittest.TestCase):
+    """Tests of fixGamutOK"""
+    def setUp(self):
+        rng = np.random.default_rng(12345)
+        num = 300000  # Enough to be split between threads
+        self.Lab = np.column_stack([rng.uniform(0.0, 1.0, num),
+                                    rng.uniform(-0.4, 0.4, num),
+                                    rng.uniform(-0.4, 0.4, num)])
+
+    def testBasic(self):
+        result = fixGamutOK(self.Lab)
+        self.assertEqual(result.shape, self.Lab.shape)
+        self.assertEqual(result.dtype, np.float64)
+        self.assertTrue(np.all(np.isfinite(result)))
+        # Chroma is scaled, but hue is preserved
+        np.testing.assert_allclose(np.arctan2(result[:, 2], result[:, 1]),
+                                   np.arctan2(self.Lab[:, 2], self.Lab[:, 1]), atol=1e-5)
+
+    def testGamuts(self):
+        """Each gamut should preserve hue, with more chroma retained by the larger gamuts"""
+        np.testing.assert_array_equal(fixGamutOK(self.Lab, gamut="displayP3"), fixGamutOK(self.Lab))
+        medianChroma = []
+        for gamut in ("sRGB", "displayP3", "rec2020"):
+            result = fixGamutOK(self.Lab, gamut=gamut)
+            self.assertTrue(np.all(np.isfinite(result)))
+            np.testing.assert_allclose(np.arctan2(result[:, 2], result[:, 1]),
+                                       np.arctan2(self.Lab[:, 2], self.Lab[:, 1]), atol=1e-5)
+            approximate = fixGamutOK(self.Lab, useCuspTable=True, gamut=gamut)
+            self.assertLess(np.percentile(np.abs(approximate - result), 99.9), 1e-3)
+            medianChroma.append(np.median(np.hypot(result[:, 1], result[:, 2])))
+        self.assertEqual(medianChroma, sorted(medianChroma))
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            fixGamutOK(self.Lab, gamut="adobeRGB")
+
+    def testSrgbPinned(self):
+        """The sRGB results should not change"""
+        Lab = np.array([[0.5, 0.3, 0.1], [0.9, -0.2, 0.25], [0.2, 0.05, -0.3]])
+        expected = np.array([[0.50908541679382324, 0.193600133061409, 0.064533375203609467],
+                             [0.90032172203063965, -0.14843696355819702, 0.18554618954658508],
+                             [0.24951484799385071, 0.024911550804972649, -0.14946931600570679]])
+        np.testing.assert_array_equal(fixGamutOK(Lab, gamut="sRGB"), expected)
+
+    def testBlocks(self):
+        """Results should not depend on how the pixels are divided"""
+        result = fixGamutOK(self.Lab)
+        for block in (slice(0, 10), slice(1000, 1001), slice(100000, 250000)):
+            np.testing.assert_array_equal(fixGamutOK(self.Lab[block]), result[block])
+
+    def testCuspTable(self):
+        """The cusp table should closely approximate the exact calculation"""
+        exact = fixGamutOK(self.Lab)
+        approximate = fixGamutOK(self.Lab, useCuspTable=True)
+        self.assertEqual(approximate.shape, exact.shape)
+        self.assertLess(np.percentile(np.abs(approximate - exact), 99.9), 1e-3)
+
+    def testFloat32(self):
+        """Float32 input should give (nearly) the same float32 result"""
+        Lab = self.Lab.astype(np.float32)
+        result = fixGamutOK(Lab)
+        self.assertEqual(result.dtype, np.float32)
+        np.testing.assert_allclose(result, fixGamutOK(Lab.astype(np.float64)), atol=1e-6)
+        # Other types are converted to float64
+        self.assertEqual(fixGamutOK(self.Lab[:10].tolist()).dtype, np.float64)
+
+    def testStrided(self):
+        """Non-contiguous views should give the same result as contiguous arrays"""
+        padded = np.zeros((len(self.Lab), 5))
+        padded[:, 1:4] = self.Lab
+        for Lab in (self.Lab[::3], self.Lab[::-2], np.asfortranarray(self.Lab), padded[:, 1:4]):
+            np.testing.assert_array_equal(fixGamutOK(Lab), fixGamutOK(np.ascontiguousarray(Lab)))
+
+    def testOut(self):
+        expected = fixGamutOK(self.Lab)
+        for dtype in (np.float64, np.float32):
+            Lab = self.Lab.astype(dtype)
+            out = np.zeros_like(Lab)
+            self.assertIs(fixGamutOK(Lab, out=out), out)
+            np.testing.assert_allclose(out, expected, atol=1e-6)
+            # In place
+            self.assertIs(fixGamutOK(Lab, out=Lab), Lab)
+            np.testing.assert_array_equal(Lab, out)
+        # Strided output
+        out = np.zeros((len(self.Lab), 3)).T.copy().T
+        fixGamutOK(self.Lab, out=out)
+        np.testing.assert_array_equal(out, expected)
+
+    def testShape(self):
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            fixGamutOK(np.zeros((10, 2)))
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            fixGamutOK(self.Lab, out=np.zeros((10, 3)))
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            fixGamutOK(self.Lab, out=np.zeros(self.Lab.shape, dtype=np.float32))
+        readonly = self.Lab.copy()
+        readonly.flags.writeable = False
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            fixGamutOK(readonly, out=readonly)
+
+
+class LinearToDisplayP3TestCase(unittest.TestCase):
+    """Tests of linearToDisplayP3"""
+    @staticmethod
+    def encode(linear, maximum):
+        """Reference implementation for in-gamut colors"""
+        encoded = np.where(linear <= 0.0031308, 12.92*linear, 1.055*linear**(1/2.4) - 0.055)
+        return np.floor(encoded*maximum + 0.5)
+
+    def testInGamut(self):
+        rng = np.random.default_rng(12345)
+        rgb = rng.uniform(0.01, 0.99, (200, 300, 3))
+        for inType in (np.float32, np.float64):
+            for outType in (np.uint8, np.uint16):
+                out = np.zeros(rgb.shape, dtype=outType)
+                result = linearToDisplayP3(rgb.astype(inType), out)
+                self.assertIs(result, out)
+                expected = self.encode(rgb.astype(inType), np.iinfo(outType).max)
+                np.testing.assert_allclose(out, expected, atol=1)
+
+    def testOutOfGamut(self):
+        rgb = np.array([[2.0, 0.5, 0.5], [-0.5, 0.2, 0.3], [np.nan, 0.5, 0.5]])
+        out = np.zeros(rgb.shape, dtype=np.uint8)
+        linearToDisplayP3(rgb, out)
+        # Clipping preserves hue, so the dominant component remains dominant
+        self.assertEqual(np.argmax(out[0]), 0)
+        self.assertEqual(np.argmin(out[1]), 0)
+        np.testing.assert_array_equal(out[2], [0, 0, 0])
+        exact = out.copy()
+        linearToDisplayP3(rgb, out, useCuspTable=True)
+        np.testing.assert_allclose(out.astype(int), exact.astype(int), atol=1)
+
+    def testErrors(self):
+        rgb = np.zeros((10, 3))
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            linearToDisplayP3(rgb, np.zeros((10, 4), dtype=np.uint8))
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            linearToDisplayP3(rgb, np.zeros((3, 10), dtype=np.uint8).T)
+        with self.assertRaises(TypeError):
+            linearToDisplayP3(rgb, np.zeros((10, 3), dtype=np.float32))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,178 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lsst/cpputils/hashCombine.h"
+#include "lsst/cpputils/Cache.h"
+
+#define BOOST_TEST_MODULE hashCombine
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+using namespace lsst::cpputils;
+
+namespace {
+
+// A (tract, patch, visit, detector) key, as used for many of our maps
+using DataId = std::tuple<int, int, long, int>;
+
+std::vector<DataId> makeDataIds() {
+    std::vector<DataId> ids;
+    for (int tract = 9813; tract < 9817; ++tract) {
+        for (int patch = 0; patch < 16; ++patch) {
+            for (long visit = 1000; visit < 1032; ++visit) {
+                for (int detector = 0; detector < 32; ++detector) {
+                    ids.emplace_back(tract, patch, visit, detector);
+                }
+            }
+        }
+    }
+    return ids;
+}
+
+// Fraction of keys that share a bucket with an earlier key, for a power-of-two table as large as the keys
+template <typename Key, typename Hash>
+double bucketCollisionRate(std::vector<Key> const& keys, Hash const& hash) {
+    std::size_t const mask = keys.size() - 1;
+    std::vector<bool> occupied(keys.size(), false);
+    std::size_t collisions = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& key : keys) {
+        std::size_t const bucket = hash(key) & mask;
+        collisions += occupied[bucket];
+        occupied[bucket] = true;
+    }
+    std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start;
+    double const rate = static_cast<double>(collisions)/keys.size();
+    BOOST_TEST_MESSAGE("collision rate " << rate << ", " << elapsed.count()/keys.size() << " ns/key");
+    return rate;
+}
+
+}  // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(HashCombineSuite)
+
+BOOST_AUTO_TEST_CASE(HashCombine) {
+    std::size_t seed = 42;
+    std::size_t expected = seed ^ (std::hash<int>()(1) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    BOOST_CHECK_EQUAL(hashCombine(seed, 1), expected);
+    std::string const text = "text";
+    BOOST_CHECK_EQUAL(hashCombine(seed, 1, text), hashCombine(expected, text));
+
+    std::vector<int> const values = {1, 2, 3};
+    BOOST_CHECK_EQUAL(hashIterable(seed, values.begin(), values.begin()), seed);
+    BOOST_CHECK_NE(hashIterable(0, values.begin(), values.end()),
+                   hashIterable(1, values.begin(), values.end()));
+    BOOST_CHECK_EQUAL(hashIterable(seed, values.begin(), values.end()), hashCombine(seed, 1, 2, 3));
+}
+
+BOOST_AUTO_TEST_CASE(FastHashConsistency) {
+    // Values that compare equal must have equal hashes
+    BOOST_CHECK_EQUAL(FastHash<double>()(0.0), FastHash<double>()(-0.0));
+    BOOST_CHECK_NE(FastHash<double>()(1.0), FastHash<double>()(-1.0));
+    BOOST_CHECK_EQUAL(FastHash<long double>()(0.5L), FastHash<long double>()(0.5L));
+    BOOST_CHECK_EQUAL(FastHash<std::string>()("abc"), FastHash<std::string_view>()("abc"));
+    std::vector<int> const vector = {1, 2, 3};
+    std::array<int, 3> const array = {1, 2, 3};
+    BOOST_CHECK_EQUAL(FastHash<std::vector<int>>()(vector), (FastHash<std::array<int, 3>>()(array)));
+    BOOST_CHECK_NE(fastHashIterable(7, vector.begin(), vector.end()),
+                   fastHashIterable(7, vector.rbegin(), vector.rend()));
+    BOOST_CHECK_EQUAL(fastHashIterable(7, vector.data(), vector.data() + 3),
+                      fastHashRange(7, vector.data(), 3));
+    BOOST_CHECK_NE(fastHashRange(7, vector.data(), 3), fastHashRange(8, vector.data(), 3));
+
+    DataId const id(9813, 4, 1000L, 12);
+    BOOST_CHECK_EQUAL(FastHash<DataId>()(id), fastHashCombine(0, 9813, 4, 1000L, 12));
+    BOOST_CHECK_NE(FastHash<DataId>()(id), FastHash<DataId>()(DataId(9813, 12, 1000L, 4)));
+    std::vector<std::string> const strings = {"a", "bc"};
+    BOOST_CHECK_NE(FastHash<std::vector<std::string>>()(strings),
+                   FastHash<std::vector<std::string>>()({"ab", "c"}));
+}
+
+BOOST_AUTO_TEST_CASE(HashBytes) {
+    // Buffers of zeros differ only in length
+    std::vector<unsigned char> const zeros(64, 0);
+    std::unordered_set<std::uint64_t> hashes;
+    for (std::size_t size = 0; size <= zeros.size(); ++size) {
+        hashes.insert(hashBytes(zeros.data(), size));
+    }
+    BOOST_CHECK_EQUAL(hashes.size(), zeros.size() + 1);
+
+    // Flipping any bit of the input flips about half of the bits of the hash
+    std::array<unsigned char, 37> buffer = {};
+    std::uint64_t const reference = hashBytes(buffer.data(), buffer.size());
+    double flipped = 0;
+    for (std::size_t bit = 0; bit < 8*buffer.size(); ++bit) {
+        buffer[bit/8] ^= 1 << (bit % 8);
+        flipped += std::bitset<64>(hashBytes(buffer.data(), buffer.size()) ^ reference).count();
+        buffer[bit/8] ^= 1 << (bit % 8);
+    }
+    flipped /= 8*buffer.size();
+    BOOST_CHECK_GT(flipped, 28.0);
+    BOOST_CHECK_LT(flipped, 36.0);
+}
+
+BOOST_AUTO_TEST_CASE(CollisionRate) {
+    // Filling a table with as many buckets as random keys leaves 1/e of the buckets empty, so a fraction
+    // 1/e of the keys collide with an earlier one
+    double const expected = 0.3679;
+
+    std::vector<DataId> const ids = makeDataIds();
+    BOOST_TEST_MESSAGE("hashCombine on data IDs");
+    bucketCollisionRate(ids, [](DataId const& id) {
+        return hashCombine(0, std::get<0>(id), std::get<1>(id), std::get<2>(id), std::get<3>(id));
+    });
+    BOOST_TEST_MESSAGE("FastHash on data IDs");
+    double const fast = bucketCollisionRate(ids, FastHash<DataId>());
+    BOOST_CHECK_CLOSE(fast, expected, 5.0);
+
+    std::vector<long> sequential(1 << 16);
+    for (std::size_t i = 0; i < sequential.size(); ++i) {
+        sequential[i] = 4096*i;  // Sequential, but a multiple of the table size
+    }
+    BOOST_TEST_MESSAGE("std::hash on strided integers");
+    BOOST_CHECK_GT(bucketCollisionRate(sequential, std::hash<long>()), 0.99);
+    BOOST_TEST_MESSAGE("FastHash on strided integers");
+    BOOST_CHECK_CLOSE(bucketCollisionRate(sequential, FastHash<long>()), expected, 5.0);
+}
+
+BOOST_AUTO_TEST_CASE(CacheKeyHash) {
+    Cache<long, int, FastHash<long>> cache(10);
+    for (int i = 0; i < 20; ++i) {
+        cache.add(4096L*i, i);
+    }
+    BOOST_CHECK_EQUAL(cache.size(), 10u);
+    BOOST_CHECK(cache.contains(4096L*19));
+    BOOST_CHECK(!cache.contains(0L));
+    BOOST_CHECK_EQUAL(cache[4096L*15], 15);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lsst/cpputils/Instrumentation.h"
+
+#define BOOST_TEST_MODULE Instrumentation
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsst::cpputils;
+
+namespace {
+
+// Snapshot of a single counter
+CounterSnapshot getCounter(std::string const& name) {
+    for (auto const& entry : CounterRegistry::get().getSnapshot()) {
+        if (entry.name == name) {
+            return entry;
+        }
+    }
+    return {name, 0, std::chrono::nanoseconds(0)};
+}
+
+void timedWork() {
+    LSST_SCOPED_TIMER("test.timedWork");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+}  // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(InstrumentationSuite)
+
+BOOST_AUTO_TEST_CASE(Counters) {
+    Counter counter("test.counter");
+    Counter same("test.counter");
+    BOOST_CHECK_EQUAL(counter.getId(), same.getId());
+    BOOST_CHECK_NE(counter.getId(), Counter("test.other").getId());
+
+    counter.add();
+    same.add(4, std::chrono::microseconds(3));
+    CounterSnapshot snapshot = getCounter("test.counter");
+    BOOST_CHECK_EQUAL(snapshot.count, 5u);
+    BOOST_CHECK_EQUAL(snapshot.time.count(), 3000);
+
+    CounterRegistry::get().reset();
+    BOOST_CHECK_EQUAL(getCounter("test.counter").count, 0u);
+    counter.add(2);
+    BOOST_CHECK_EQUAL(getCounter("test.counter").count, 2u);
+    BOOST_CHECK_EQUAL(getCounter("test.other").count, 0u);
+
+    auto const all = CounterRegistry::get().getSnapshot();
+    for (std::size_t ii = 1; ii < all.size(); ++ii) {
+        BOOST_CHECK_LT(all[ii - 1].name, all[ii].name);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Threads) {
+    CounterRegistry::get().reset();
+    // Threads exit and are replaced, so later ones adopt the counters of earlier ones
+    for (int round = 0; round < 3; ++round) {
+        std::vector<std::thread> threads;
+        for (int ii = 0; ii < 8; ++ii) {
+            threads.emplace_back([]() {
+                for (int jj = 0; jj < 10000; ++jj) {
+                    LSST_COUNTER_ADD("test.threads", 1);
+                }
+                LSST_COUNTER_ADD("test.threads.time", 1, std::chrono::nanoseconds(7));
+            });
+        }
+        for (auto & thread : threads) {
+            thread.join();
+        }
+    }
+    BOOST_CHECK_EQUAL(getCounter("test.threads").count, 3u*8u*10000u);
+    BOOST_CHECK_EQUAL(getCounter("test.threads.time").count, 24u);
+    BOOST_CHECK_EQUAL(getCounter("test.threads.time").time.count(), 24*7);
+}
+
+BOOST_AUTO_TEST_CASE(ManyCounters) {
+    // Counters on several pages
+    std::vector<Counter> counters;
+    for (int ii = 0; ii < 600; ++ii) {
+        counters.emplace_back("test.many." + std::to_string(ii));
+    }
+    std::thread thread([&counters]() {
+        for (std::size_t ii = 0; ii < counters.size(); ii += 7) {
+            counters[ii].add(ii);
+        }
+    });
+    thread.join();
+    BOOST_CHECK_EQUAL(getCounter("test.many.595").count, 595u);
+    BOOST_CHECK_EQUAL(getCounter("test.many.596").count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Timer) {
+    CounterRegistry::get().reset();
+    timedWork();
+    timedWork();
+    CounterSnapshot const snapshot = getCounter("test.timedWork");
+    BOOST_CHECK_EQUAL(snapshot.count, 2u);
+    BOOST_CHECK_GE(snapshot.time.count(), 4000000);
+
+    Counter counter("test.timer");
+    {
+        ScopedTimer timer(counter);
+        BOOST_CHECK_GE(timer.getElapsed().count(), 0);
+    }
+    BOOST_CHECK_EQUAL(getCounter("test.timer").count, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
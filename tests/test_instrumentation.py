@@ -0,0 +1,55 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import unittest
+
+import numpy as np
+
+from lsst.cpputils import fixGamutOK, instrumentation
+
+
+class InstrumentationTestCase(unittest.TestCase):
+    """Tests of the counters exported by lsst.cpputils.instrumentation"""
+
+    def setUp(self):
+        instrumentation.resetCounters()
+
+    def testCounters(self):
+        if not instrumentation.isEnabled():
+            self.skipTest("Instrumentation is compiled out")
+        Lab = np.array([[50.0, 10.0, -10.0]]*10)
+        for _ in range(3):
+            fixGamutOK(Lab)
+        counter = instrumentation.getCounters()["cpputils.fixGamutOK"]
+        self.assertEqual(counter["count"], 3)
+        self.assertGreater(counter["seconds"], 0.0)
+
+        instrumentation.resetCounters()
+        self.assertEqual(instrumentation.getCounters()["cpputils.fixGamutOK"]["count"], 0)
+
+    def testWrapperTimings(self):
+        # The time taken by each definition when importing this package
+        names = [name for name in instrumentation.getCounters() if name.startswith("python.wrappers.")]
+        self.assertTrue(any("_cpputils" in name for name in names))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,93 @@
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import math
+import unittest
+
+import numpy as np
+
+import lsst.pex.exceptions
+from lsst.cpputils import (nanojanskyToABMagnitude, ABMagnitudeToNanojansky,
+                           nanojanskyErrToABMagnitudeErr, ABMagnitudeErrToNanojanskyErr, referenceFlux)
+
+
+class MagnitudeTestCase(unittest.TestCase):
+    """Tests of the magnitude conversions"""
+    def setUp(self):
+        rng = np.random.default_rng(12345)
+        self.flux = rng.uniform(1.0, 1e6, (100, 50))
+        self.fluxErr = 0.1*self.flux*rng.uniform(0.5, 1.5, self.flux.shape)
+
+    def testScalar(self):
+        self.assertAlmostEqual(referenceFlux, 3631e9, delta=1e9)
+        self.assertAlmostEqual(nanojanskyToABMagnitude(referenceFlux), 0.0)
+        self.assertAlmostEqual(nanojanskyToABMagnitude(3631.0), 22.5, places=3)
+        self.assertAlmostEqual(ABMagnitudeToNanojansky(nanojanskyToABMagnitude(1234.5)), 1234.5)
+        self.assertAlmostEqual(nanojanskyErrToABMagnitudeErr(100.0, 1.0), 2.5/math.log(10)/100)
+        self.assertAlmostEqual(nanojanskyErrToABMagnitudeErr(-100.0, 1.0), 2.5/math.log(10)/100)
+        self.assertAlmostEqual(ABMagnitudeErrToNanojanskyErr(nanojanskyToABMagnitude(100.0), 0.01),
+                               100*0.01*math.log(10)/2.5)
+
+    def testArray(self):
+        """Array conversions should match the scalar ones exactly"""
+        magnitude = nanojanskyToABMagnitude(self.flux)
+        self.assertEqual(magnitude.shape, self.flux.shape)
+        np.testing.assert_array_equal(magnitude.ravel(),
+                                      [nanojanskyToABMagnitude(f) for f in self.flux.ravel()])
+        flux = ABMagnitudeToNanojansky(magnitude)
+        np.testing.assert_array_equal(flux.ravel(), [ABMagnitudeToNanojansky(m) for m in magnitude.ravel()])
+        np.testing.assert_allclose(flux, self.flux, rtol=1e-14)
+
+        magnitudeErr = nanojanskyErrToABMagnitudeErr(self.flux, self.fluxErr)
+        np.testing.assert_array_equal(
+            magnitudeErr.ravel(),
+            [nanojanskyErrToABMagnitudeErr(f, e) for f, e in zip(self.flux.ravel(), self.fluxErr.ravel())]
+        )
+        np.testing.assert_allclose(ABMagnitudeErrToNanojanskyErr(magnitude, magnitudeErr), self.fluxErr,
+                                   rtol=1e-13)
+
+        # Other array-like inputs are converted
+        np.testing.assert_array_equal(nanojanskyToABMagnitude(self.flux.astype(np.float32)[0].tolist()),
+                                      nanojanskyToABMagnitude(self.flux.astype(np.float32)[0]))
+
+    def testSmallArray(self):
+        """Arrays of one element (which convert to float) should still give arrays"""
+        for dtype in (np.float64, np.float32):
+            flux = self.flux[:1, :1].astype(dtype)
+            magnitude = nanojanskyToABMagnitude(flux)
+            self.assertIsInstance(magnitude, np.ndarray)
+            self.assertEqual(magnitude.shape, (1, 1))
+            self.assertEqual(magnitude[0, 0], nanojanskyToABMagnitude(float(flux[0, 0])))
+            self.assertIsInstance(ABMagnitudeToNanojansky(magnitude.ravel()), np.ndarray)
+            magnitudeErr = nanojanskyErrToABMagnitudeErr(flux, flux)
+            self.assertIsInstance(magnitudeErr, np.ndarray)
+            self.assertIsInstance(ABMagnitudeErrToNanojanskyErr(magnitude, magnitudeErr), np.ndarray)
+        # Scalars that need conversion are still scalars
+        self.assertIsInstance(nanojanskyToABMagnitude(3631), float)
+        self.assertIsInstance(nanojanskyToABMagnitude(np.float32(3631.0)), float)
+
+    def testShape(self):
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            nanojanskyErrToABMagnitudeErr(self.flux, self.fluxErr[:10])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,174 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lsst/cpputils/_oklabTools.h"
+
+#define BOOST_TEST_MODULE OKLab
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace lsst::cpputils::details;
+
+namespace {
+
+// Clip random OKLab colors to a gamut, convert them back to linear RGB, and check that they are within
+// `outside` of [0, 1], and that those that were out of the gamut are within `boundary` of its surface
+template <typename Gamut, typename CuspProvider>
+void checkClip(CuspProvider const& cusp, double outside, double boundary) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> lightness(0.0, 1.0);
+    std::uniform_real_distribution<double> chroma(-0.4, 0.4);
+    double worstOutside = 0.0;
+    double worstBoundary = 0.0;
+    std::size_t numClipped = 0;
+    for (int ii = 0; ii < 100000; ++ii) {
+        double const L = lightness(rng), a = chroma(rng), b = chroma(rng);
+        RGB const original = oklab_to_linear_rgb<Gamut>({float(L), float(a), float(b)});
+        bool const inGamut = std::min({original.r, original.g, original.b}) >= 0.0f &&
+            std::max({original.r, original.g, original.b}) <= 1.0f;
+        double Lout, aout, bout;
+        gamut_clip_lab_adaptive_L0_L_cusp<double, Gamut>(L, a, b, Lout, aout, bout, 0.5f, cusp);
+        RGB const clipped = oklab_to_linear_rgb<Gamut>({float(Lout), float(aout), float(bout)});
+        double const low = std::min({clipped.r, clipped.g, clipped.b});
+        double const high = std::max({clipped.r, clipped.g, clipped.b});
+        worstOutside = std::max({worstOutside, -low, high - 1.0});
+        if (!inGamut) {
+            ++numClipped;
+            worstBoundary = std::max(worstBoundary, std::min(std::abs(low), std::abs(1.0 - high)));
+        }
+    }
+    BOOST_CHECK_GT(numClipped, 10000u);
+    BOOST_CHECK_LE(worstOutside, outside);
+    BOOST_CHECK_LE(worstBoundary, boundary);
+}
+
+// Convert linear RGB to 8-bit display values, one color at a time
+template <typename Gamut, typename CuspProvider>
+std::vector<std::uint8_t> toDisplay(std::vector<float> const& rgb, CuspProvider const& cusp) {
+    std::vector<std::uint8_t> out(rgb.size());
+    linear_rgb_to_display<Gamut>(rgb.size()/3, rgb.data(), rgb.data() + 1, rgb.data() + 2, 3,
+                                 out.data(), out.data() + 1, out.data() + 2, 3, 0.05f, cusp);
+    return out;
+}
+
+}  // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(OKLabSuite)
+
+BOOST_AUTO_TEST_CASE(ClipSrgb) {
+    checkClip<SrgbGamut>(ExactCusp<SrgbGamut>(), 1e-3, 1e-3);
+    checkClip<SrgbGamut>(CuspTable::srgb(), 1e-3, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(ClipDisplayP3) {
+    checkClip<DisplayP3Gamut>(ExactCusp<DisplayP3Gamut>(), 2.5e-4, 2.5e-4);
+    checkClip<DisplayP3Gamut>(CuspTable::displayP3(), 2.5e-4, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(ClipRec2020) {
+    checkClip<Rec2020Gamut>(ExactCusp<Rec2020Gamut>(), 2.5e-4, 2.5e-4);
+    checkClip<Rec2020Gamut>(CuspTable::rec2020(), 2.5e-4, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(CuspTableNan) {
+    float const nan = std::numeric_limits<float>::quiet_NaN();
+    for (CuspTable const* table : {&CuspTable::srgb(), &CuspTable::displayP3(), &CuspTable::rec2020()}) {
+        for (auto const& ab : {std::make_pair(nan, nan), std::make_pair(nan, 0.0f), std::make_pair(0.0f, nan)}) {
+            LC const cusp = (*table)(ab.first, ab.second);
+            BOOST_CHECK(std::isnan(cusp.L));
+            BOOST_CHECK(std::isnan(cusp.C));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SrgbPinned) {
+    // Results of the sRGB routines before they were templated on the gamut, which they must reproduce
+    struct Cusp { float a, b, L, C, tableL, tableC; };
+    Cusp const cusps[] = {
+        {0x1.e921dep-1f, 0x1.2e9cdap-2f, 0x1.44bee6p-1f, 0x1.040a1ap-2f, 0x1.44bee2p-1f, 0x1.040a1ep-2f},
+        {0x1.de1e5ap-2f, 0x1.c4c36cp-1f, 0x1.8717c6p-1f, 0x1.67797ap-3f, 0x1.8717c6p-1f, 0x1.67797ep-3f},
+        {-0x1.2dd56ep-2f, 0x1.e940aap-1f, 0x1.e68b58p-1f, 0x1.a19252p-3f, 0x1.e68b62p-1f, 0x1.a19266p-3f},
+        {-0x1.c492a4p-1f, 0x1.ded6eep-2f, 0x1.c07684p-1f, 0x1.d6ac7p-3f, 0x1.c07684p-1f, 0x1.d6acacp-3f},
+        {-0x1.e95f64p-1f, -0x1.2d0de8p-2f, 0x1.ca283p-1f, 0x1.37eab4p-3f, 0x1.ca2832p-1f, 0x1.37eab8p-3f},
+        {-0x1.df8f52p-2f, -0x1.c461d4p-1f, 0x1.69fd98p-1f, 0x1.5815fp-3f, 0x1.69fd9cp-1f, 0x1.5815f8p-3f},
+        {0x1.2c4666p-2f, -0x1.e97e08p-1f, 0x1.0485e6p-1f, 0x1.2c36dcp-2f, 0x1.0485eep-1f, 0x1.2c36dcp-2f},
+        {0x1.c430eap-1f, -0x1.e047bp-2f, 0x1.626872p-1f, 0x1.3fcc66p-2f, 0x1.626878p-1f, 0x1.3fcc7p-2f},
+    };
+    for (auto const& cusp : cusps) {
+        LC const exact = find_cusp_srgb(cusp.a, cusp.b);
+        BOOST_CHECK_EQUAL(exact.L, cusp.L);
+        BOOST_CHECK_EQUAL(exact.C, cusp.C);
+        LC const table = CuspTable::srgb()(cusp.a, cusp.b);
+        BOOST_CHECK_EQUAL(table.L, cusp.tableL);
+        BOOST_CHECK_EQUAL(table.C, cusp.tableC);
+    }
+    Lab const lab = linear_srgb_to_oklab({0x1.4cccccp+0f, -0x1.99999ap-4f, 0x1.99999ap-2f});
+    BOOST_CHECK_EQUAL(lab.L, 0x1.54541ep-1f);
+    BOOST_CHECK_EQUAL(lab.a, 0x1.6cdb34p-2f);
+    BOOST_CHECK_EQUAL(lab.b, -0x1.971cap-5f);
+    RGB const rgb = oklab_to_linear_srgb(lab);
+    BOOST_CHECK_EQUAL(rgb.r, 0x1.4ccccap+0f);
+    BOOST_CHECK_EQUAL(rgb.g, -0x1.999994p-4f);
+    BOOST_CHECK_EQUAL(rgb.b, 0x1.999994p-2f);
+}
+
+BOOST_AUTO_TEST_CASE(Rec2020Display) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> component(-0.5f, 1.5f);
+    std::vector<float> rgb(3*10000);
+    for (float & value : rgb) {
+        value = component(rng);
+    }
+    auto const exact = toDisplay<Rec2020Gamut>(rgb, ExactCusp<Rec2020Gamut>());
+    auto const table = toDisplay<Rec2020Gamut>(rgb, CuspTable::rec2020());
+    std::size_t numClipped = 0;
+    for (std::size_t ii = 0; ii < rgb.size(); ii += 3) {
+        RGB const original = {rgb[ii], rgb[ii + 1], rgb[ii + 2]};
+        RGB const clipped = gamut_clip_adaptive_L0_L_cusp<Rec2020Gamut>(original);
+        if (clipped.r != original.r || clipped.g != original.g || clipped.b != original.b) {
+            ++numClipped;
+        }
+        float const expected[3] = {clipped.r, clipped.g, clipped.b};
+        for (std::size_t jj = 0; jj < 3; ++jj) {
+            BOOST_CHECK_EQUAL(int(exact[ii + jj]), int(quantize<std::uint8_t>(
+                Rec2020Gamut::transfer_function(expected[jj]))));
+            BOOST_CHECK_LE(std::abs(int(table[ii + jj]) - int(exact[ii + jj])), 1);
+        }
+    }
+    BOOST_CHECK_GT(numClipped, 1000u);
+    // The ITU-R BT.2020 transfer function is not that of sRGB
+    BOOST_CHECK_EQUAL(int(quantize<std::uint8_t>(Rec2020Gamut::transfer_function(0.01f))), 11);
+    BOOST_CHECK_EQUAL(int(quantize<std::uint8_t>(SrgbGamut::transfer_function(0.01f))), 25);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
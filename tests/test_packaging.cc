@@ -28,6 +28,7 @@
 #include "boost/test/unit_test.hpp"
 #pragma clang diagnostic pop
 
+#include <cstdlib>
 #include <filesystem>
 #include "lsst/pex/exceptions.h"
 
@@ -42,4 +43,28 @@ BOOST_AUTO_TEST_CASE(GetPackage) {
                       lsst::pex::exceptions::NotFoundError);
 }
 
+BOOST_AUTO_TEST_CASE(Resolver) {
+    PackageDirResolver resolver;
+    BOOST_CHECK_EQUAL(resolver.getPackageDir("cpputils"), getPackageDir("cpputils"));
+    BOOST_CHECK_EQUAL(resolver.find("CppUtils"), getPackageDir("cpputils"));
+    BOOST_CHECK(resolver.find("nameOfNonexistendPackage2234q?#!").empty());
+    BOOST_CHECK_THROW(resolver.getPackageDir("nameOfNonexistendPackage2234q?#!"),
+                      lsst::pex::exceptions::NotFoundError);
+
+    std::vector<std::string> dirs = resolver.getPackageDirs({"cpputils", "cpputils"});
+    BOOST_CHECK_EQUAL(dirs.size(), 2u);
+    BOOST_CHECK_EQUAL(dirs[1], getPackageDir("cpputils"));
+    BOOST_CHECK_THROW(resolver.getPackageDirs({"cpputils", "nameOfNonexistendPackage2234q?#!"}),
+                      lsst::pex::exceptions::NotFoundError);
+
+    // Changes to the environment are seen after refresh, and old views remain valid
+    std::string_view const before = resolver.find("cpputils");
+    setenv("CPPUTILS_TEST_RESOLVER_DIR", "/some/where", 1);
+    BOOST_CHECK(resolver.find("cpputils_test_resolver").empty());
+    resolver.refresh();
+    BOOST_CHECK_EQUAL(resolver.find("cpputils_test_resolver"), "/some/where");
+    BOOST_CHECK_EQUAL(before, getPackageDir("cpputils"));
+    unsetenv("CPPUTILS_TEST_RESOLVER_DIR");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
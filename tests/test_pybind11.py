@@ -19,6 +19,8 @@
 # along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #
 
+import importlib
+import sys
 import unittest
 import numpy as np
 
@@ -194,6 +196,68 @@ class Pybind11TestCase(unittest.TestCase):
             a = _example.returnTypeHolder(dtype)
             self.assertEqual(a.dtype, dtype)
         self.assertIsNone(_example.returnTypeHolder(np.dtype(np.float64)))
+        # Repeated calls use the dispatch table built by the first
+        for t in (np.float32, np.uint16, np.float64) * 3:
+            self.assertEqual(_example.returnTypeHolder(np.dtype(t)) is None, t is np.float64)
+        # Aliases of the same C type match, however they are spelled
+        self.assertEqual(_example.returnTypeHolder(np.dtype("i4")).dtype, np.dtype(np.int32))
+        self.assertEqual(_example.returnTypeHolder(np.dtype(np.intc)).dtype, np.dtype(np.int32))
+        # Dtypes outside the table are compared with each type in turn, with the same result
+        self.assertIsNone(_example.returnTypeHolder(np.dtype(np.float32).newbyteorder()))
+        self.assertIsNone(_example.returnTypeHolder(np.dtype([("a", np.float32)])))
+        self.assertIsNone(_example.returnTypeHolder(np.dtype("U4")))
+
+    def testWrapperTimings(self):
+        labels = [label for label, seconds in _example.__wrapper_timings__]
+        self.assertIn("example.Example", labels)
+        self.assertNotIn("getAnswer", labels)
+        for label, seconds in _example.__wrapper_timings__:
+            self.assertGreaterEqual(seconds, 0.0)
+
+    def testInstrumentation(self):
+        before = _example.__wrapper_instrumentation__()
+        self.assertTrue(before["enabled"])
+        self.assertIn("example.Example", [label for label, seconds in before["timings"]])
+        self.assertEqual(_example.getName(1), "int")
+        self.assertEqual(_example.getName(1.5), "double")
+        self.assertEqual(self.example.getValue(), "foo")
+        self.assertEqual(_example.Example.getValue(self.example), "foo")
+        after = _example.__wrapper_instrumentation__()
+        calls = after["calls"]
+        self.assertEqual(calls["example.getName"]["call"]["calls"],
+                         before["calls"]["example.getName"]["call"]["calls"] + 2)
+        # getName is only instrumented through its binding, getValue also in C++
+        self.assertEqual(calls["example.getName"]["body"]["calls"], 0)
+        getValue = calls["example.Example.getValue"]
+        self.assertEqual(getValue["call"]["calls"],
+                         before["calls"]["example.Example.getValue"]["call"]["calls"] + 2)
+        self.assertEqual(getValue["body"]["calls"],
+                         before["calls"]["example.Example.getValue"]["body"]["calls"] + 2)
+        self.assertGreaterEqual(getValue["call"]["seconds"], getValue["body"]["seconds"])
+        self.assertEqual(sum(getValue["call"]["histogram"]), getValue["call"]["calls"])
+
+    def testLazySubmodule(self):
+        self.assertNotIn("_lazy", _example.__dict__)
+        lazy = _example._lazy
+        self.assertIs(_example.__dict__["_lazy"], lazy)
+        self.assertEqual(lazy.getAnswer(), 42)
+        self.assertEqual([label for label, seconds in lazy.__wrapper_timings__], ["getAnswer"])
+        with self.assertRaises(AttributeError):
+            _example._notASubmodule
+
+    def testLazySubmoduleImport(self):
+        # Importing does not materialize the submodule; looking up its contents does
+        lazy = importlib.import_module("_example._lazyImport")
+        self.assertIs(lazy, sys.modules["_example._lazyImport"])
+        self.assertNotIn("getQuestion", lazy.__dict__)
+        self.assertNotIn("_lazyImport", _example.__dict__)
+        namespace = {}
+        exec("from _example._lazyImport import *", namespace)
+        self.assertEqual(namespace["getQuestion"](), "six times nine")
+        self.assertIs(_example.__dict__["_lazyImport"], lazy)
+        self.assertNotIn("__getattr__", lazy.__dict__)
+        with self.assertRaises(AttributeError):
+            lazy.notAFunction
 
 
 if __name__ == "__main__":
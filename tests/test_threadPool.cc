@@ -0,0 +1,194 @@
+/*
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lsst/cpputils/ThreadPool.h"
+#include "lsst/pex/exceptions.h"
+
+#define BOOST_TEST_MODULE ThreadPool
+#define BOOST_TEST_DYN_LINK
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace lsst::cpputils;
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolSuite)
+
+BOOST_AUTO_TEST_CASE(ParallelFor) {
+    ThreadPool pool(4);
+    BOOST_CHECK_EQUAL(pool.getNumThreads(), 4u);
+    for (std::size_t grain : {0, 1, 7, 1000, 100000}) {
+        std::vector<std::atomic<int>> counts(10007);
+        for (auto & count : counts) {
+            count.store(0);
+        }
+        // Boost.Test assertions are not thread-safe, so chunks are checked afterwards
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        std::vector<std::pair<std::size_t, std::size_t>> chunks;
+        parallelFor(3, counts.size(), grain, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t ii = begin; ii < end; ++ii) {
+                ++counts[ii];
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+            chunks.emplace_back(begin, end);
+        }, pool);
+        for (auto const& chunk : chunks) {
+            BOOST_CHECK_LT(chunk.first, chunk.second);
+            if (chunk.second != counts.size()) {
+                BOOST_CHECK_GE(chunk.second - chunk.first, grain);
+            }
+        }
+        for (std::size_t ii = 0; ii < counts.size(); ++ii) {
+            BOOST_REQUIRE_EQUAL(counts[ii].load(), ii < 3 ? 0 : 1);
+        }
+        BOOST_CHECK_LE(threads.size(), 5u);
+        if (grain > counts.size()) {
+            BOOST_CHECK_EQUAL(threads.size(), 1u);
+            BOOST_CHECK(threads.count(std::this_thread::get_id()));
+        }
+    }
+
+    // An empty range calls nothing
+    bool called = false;
+    parallelFor(5, 5, 1, [&called](std::size_t, std::size_t) { called = true; }, pool);
+    BOOST_CHECK(!called);
+}
+
+BOOST_AUTO_TEST_CASE(ParallelForException) {
+    ThreadPool pool(3);
+    std::atomic<int> calls{0};
+    BOOST_CHECK_THROW(parallelFor(0, 1000, 1, [&calls](std::size_t begin, std::size_t) {
+        ++calls;
+        if (begin >= 500) {
+            throw LSST_EXCEPT(lsst::pex::exceptions::InvalidParameterError, "bad chunk");
+        }
+    }, pool), lsst::pex::exceptions::InvalidParameterError);
+    BOOST_CHECK_LT(calls.load(), 12);  // Chunks after the failure are skipped
+
+    // The pool is still usable
+    std::atomic<std::size_t> total{0};
+    parallelFor(0, 1000, 1, [&total](std::size_t begin, std::size_t end) { total += end - begin; }, pool);
+    BOOST_CHECK_EQUAL(total.load(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(NestedParallelFor) {
+    // Every worker blocks in an outer chunk; the inner loops must still complete
+    ThreadPool pool(2);
+    std::atomic<std::size_t> total{0};
+    parallelFor(0, 8, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t ii = begin; ii < end; ++ii) {
+            parallelFor(0, 100, 1, [&total](std::size_t b, std::size_t e) { total += e - b; }, pool);
+        }
+    }, pool);
+    BOOST_CHECK_EQUAL(total.load(), 800u);
+}
+
+BOOST_AUTO_TEST_CASE(Submit) {
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(3);
+        for (int ii = 0; ii < 100; ++ii) {
+            pool.submit([&count, &pool]() {
+                ++count;
+                pool([&count]() { ++count; });  // Submitted from a worker, so runs there or is stolen
+            });
+        }
+        pool([]() { throw std::runtime_error("discarded"); });
+    }  // Queued tasks are run before the destructor returns
+    BOOST_CHECK_EQUAL(count.load(), 200);
+}
+
+BOOST_AUTO_TEST_CASE(DefaultNumThreads) {
+    char const *old = std::getenv("LSST_CPPUTILS_NUM_THREADS");
+    std::string const saved = old ? old : "";
+
+    unsetenv("LSST_CPPUTILS_NUM_THREADS");
+    std::size_t const available = getDefaultNumThreads();
+    BOOST_CHECK_GE(available, 1u);
+    BOOST_CHECK_LE(available, std::max(1u, std::thread::hardware_concurrency()));
+
+    setenv("LSST_CPPUTILS_NUM_THREADS", "3", 1);
+    BOOST_CHECK_EQUAL(getDefaultNumThreads(), 3u);
+    for (char const *invalid : {"0", "-2", "many", ""}) {
+        setenv("LSST_CPPUTILS_NUM_THREADS", invalid, 1);
+        BOOST_CHECK_EQUAL(getDefaultNumThreads(), available);
+    }
+
+    if (old) {
+        setenv("LSST_CPPUTILS_NUM_THREADS", saved.c_str(), 1);
+    } else {
+        unsetenv("LSST_CPPUTILS_NUM_THREADS");
+    }
+    BOOST_CHECK_GE(ThreadPool::getDefault().getNumThreads(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(CgroupCpus) {
+    char root[] = "/tmp/test_threadPool-XXXXXX";
+    BOOST_REQUIRE(mkdtemp(root));
+    std::string const mount = root;
+    auto write = [&mount](std::string const& path, std::string const& contents) {
+        std::filesystem::path const file = mount + path;
+        std::filesystem::create_directories(file.parent_path());
+        std::ofstream(file) << contents;
+    };
+
+    // cgroup v2: the process's own cgroup, limited by an ancestor
+    write("/proc", "0::/batch.slice/job.scope\n");
+    write("/batch.slice/job.scope/cpu.max", "250000 100000\n");
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/proc", mount), 3u);
+    write("/batch.slice/cpu.max", "150000 100000\n");
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/proc", mount), 2u);
+    write("/batch.slice/job.scope/cpu.max", "max 100000\n");
+    write("/batch.slice/cpu.max", "max 100000\n");
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/proc", mount), 0u);
+
+    // cgroup v1, with the cpu controller alongside others
+    write("/proc", "5:memory:/job\n4:cpuacct,cpu:/job\n0::/job\n");
+    write("/cpu,cpuacct/job/cpu.cfs_quota_us", "400000\n");
+    write("/cpu,cpuacct/job/cpu.cfs_period_us", "100000\n");
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/proc", mount), 4u);
+    write("/cpu,cpuacct/job/cpu.cfs_quota_us", "-1\n");
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/proc", mount), 0u);
+
+    // Inside a cgroup namespace, the process's cgroup is the root
+    write("/proc", "0::/\n");
+    write("/cpu.max", "50000 100000\n");
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/proc", mount), 1u);
+
+    BOOST_CHECK_EQUAL(detail::getCgroupCpus(mount + "/nonexistent", mount), 0u);
+    std::filesystem::remove_all(mount);
+}
+
+BOOST_AUTO_TEST_SUITE_END()